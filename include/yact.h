@@ -70,9 +70,28 @@
 /// switchs-impl.cc directly into your project.  This file is automatically
 /// generated by concatenating all private headers and implementation files.
 ///
+#include <stddef.h>
+#include <new>
 #include <string>
 #include <vector>
 #include <map>
+#include <utility>
+
+// Classes which are expensive to copy also take rvalue references when the
+// compiler supports them.  Define YACT_HAS_RVALUE_REFERENCES to 0 to turn
+// this off.
+#if !defined(YACT_HAS_RVALUE_REFERENCES)
+#if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1600)
+#define YACT_HAS_RVALUE_REFERENCES 1
+#else
+#define YACT_HAS_RVALUE_REFERENCES 0
+#endif
+#endif
+
+#if YACT_HAS_RVALUE_REFERENCES
+#include <type_traits>
+#endif
 
 namespace yact {
 
@@ -102,12 +121,52 @@ typedef std::wstring StringType;
 #endif  // defined(YACT_STRING_CHAR)
 
 typedef const CharType * ConstCharArrayType;
+
+// The same type as base's int64, so that either may be passed to Value
+#if defined(__LP64__)
+typedef long Int64Type;
+#else
+typedef long long Int64Type;
+#endif
+
 extern const StringType kEmptyString;
 
+/// Characters which are passed or returned without copying them.  A TextView
+/// points into text owned by whatever produced it, which says for how long it
+/// stays valid.
+class TextView {
+ public:
+  TextView() : data_(NULL), size_(0) {}
+  TextView(const CharType * data, size_t size) : data_(data), size_(size) {}
+
+  const CharType * data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  StringType as_string() const { return StringType(data_, size_); }
+
+  bool operator==(const CharType * other) const;
+  bool operator==(const StringType & other) const;
+  bool operator!=(const CharType * other) const { return !(*this == other); }
+  bool operator!=(const StringType & other) const {
+    return !(*this == other);
+  }
+
+ private:
+  const CharType * data_;
+  size_t size_;
+};
+
 class Value;
 class ValueGroup;
+class ValueHandle;
+class ValueOverlay;
+class ConfigPublisher;
+class ConfigSnapshot;
 class Switch;
 class SwitchValidator;
+class SwitchIndex;
+class ArgumentStorage;
+class ArgumentParser;
 
 /// Describes the value of a switch.
 ///
@@ -147,11 +206,27 @@ class SwitchValidator;
 class Value {
 public:
   Value();
+  Value(const Value & other);
+
+  /// An empty value of the type which `switch_` stores.  The Value keeps a
+  /// reference to the Switch, which switch_() returns.
   Value(const Switch * switch_);
   Value(int value);
   Value(bool value);
   Value(const StringType & value);
   Value(const CharType * value);
+  Value(Int64Type value);
+  Value(double value);
+#if YACT_HAS_RVALUE_REFERENCES
+  Value(Value && other);
+#endif
+  ~Value();
+
+  /// Returns a kTypeDuration value
+  static Value Duration(Int64Type microseconds);
+
+  /// Returns a kTypeByteSize value
+  static Value ByteSize(Int64Type bytes);
   
   enum {
     /// if the type is kTypeAuto then cast to any types are legal,
@@ -160,34 +235,69 @@ public:
     
     kTypeInt,
     kTypeBool,
-    kTypeString
+    kTypeString,
+    kTypeInt64,
+    kTypeDouble,
+
+    /// A span of time in microseconds, written like "250ms" or "1h30m"
+    kTypeDuration,
+
+    /// A number of bytes, written like "4096" or "64MiB"
+    kTypeByteSize
   };
   
   /// Returns the type held
   int type() const;
 
   /// Convert to an int.  Triggers a runtime assertion if the Value holds the
-  /// wrong type.
+  /// wrong type.  A kTypeAuto string is parsed by the first call and the
+  /// result is kept, so later calls do not parse it again.  A string which is
+  /// not an integer converts to 0 when assertions are disabled.
   int AsInt() const;
   
   /// Convert to a bool.  Triggers a runtime assertion if the Value holds the
-  /// wrong type.
+  /// wrong type.  As with AsInt(), kTypeAuto strings are parsed only once.
   bool AsBool() const;
+
+  /// Convert to a 64-bit integer.  Works for kTypeInt and kTypeInt64 values,
+  /// and kTypeAuto strings are parsed only once.
+  Int64Type AsInt64() const;
+
+  /// Convert to a double.  Works for integer and kTypeDouble values, and
+  /// kTypeAuto strings are parsed only once.
+  double AsDouble() const;
+
+  /// Convert to a number of microseconds.  kTypeAuto strings are parsed on
+  /// every call, so give the Switch the kTypeDuration type instead to parse
+  /// the argument only once.
+  Int64Type AsDuration() const;
+
+  /// Convert to a number of bytes.  As with AsDuration(), prefer the
+  /// kTypeByteSize type to kTypeAuto.
+  Int64Type AsByteSize() const;
   
   /// Convert to a string.  Triggers a runtime assertion if the Value holds the
-  /// wrong type.
+  /// wrong type.  The reference is valid until the Value is modified or
+  /// destroyed.  Short strings are stored inside the Value, so the first call
+  /// makes a copy to refer to; operator StringType() and
+  /// operator ConstCharArrayType() read them without one.
   const StringType & AsString() const;
   
   /// Assign a value.  Note that assignment does invoke any validation
-  /// associated with the Switch.
+  /// associated with the Switch.  Assigning a string to a kTypeAuto value
+  /// leaves it kTypeAuto, so that it may still be read as any type.
   void set(const Value & value);
   void set(int value);
   void set(bool value);
   void set(const StringType & value);
   void set(const CharType * value);
+  void set(const CharType * value, size_t size);
+  void set(Int64Type value);
+  void set(double value);
   
   /// Return the associated Switch or NULL.  The returned pointer is valid for
-  /// the lifetime of the Value.
+  /// the lifetime of the Value, or until another Value is assigned to it.
+  /// Setting the contents with set() keeps the Switch.
   const Switch * switch_() const;
   
   /// Implicit cast.  These casts may trigger assertions at runtime if the
@@ -197,27 +307,185 @@ public:
   /// \copydoc Value::operator int()
   operator StringType() const;
   
-  /// \copydoc Value::operator int()
+  /// \copydoc Value::operator int()  The pointer is valid until the Value is
+  /// modified or destroyed.
   operator ConstCharArrayType() const;
   
   /// \copydoc Value::operator int()
   operator bool() const;
   
   Value & operator=(const Value & value);
+#if YACT_HAS_RVALUE_REFERENCES
+  Value & operator=(Value && value);
+#endif
   bool operator==(const Value & other) const;
 
+  /// Exchanges the contents of two values without allocating
+  void swap(Value & other);
+
 private:
-  int type_;
+  class StringBuffer;
+  class SwitchBox;
+
+  // Strings of up to kInlineCapacity - 1 characters (without embedded nuls)
+  // are stored in inline_.  Longer strings live in a reference counted
+  // StringBuffer which is shared between copies, and set kStringBufferFlag.
+  //
+  // The union of a string value holds its StringBuffer or NULL.  A kTypeAuto
+  // string is converted to numbers and booleans when it is first read as one,
+  // and the results are kept in the StringBuffer, which a short string gets
+  // at that point.  Assigning a string only stores it.
+  //
+  // A Value created from a Switch sets kSwitchFlag and nothing else in tag_.
+  // Its union points to a SwitchBox which holds the Switch and a Value with
+  // the contents, and which is shared between copies.
+  enum {
+    kInlineCapacity = 7,
+    kTypeMask = 0x07,
+    kSwitchFlag = 0x08,
+    kStringBufferFlag = 0x10
+  };
+
+  bool is_string() const;
+  const CharType * string_data() const;
+  size_t string_size() const;
+  bool StringEquals(const Value & other) const;
+  void AssignString(int type, const CharType * data, size_t size);
+  StringBuffer * shared_buffer() const;
+  StringBuffer * string_buffer() const;
+  Value * boxed_value();
+  void Release();
+
   union {
     int int_value_;
     bool bool_value_;
+    Int64Type int64_value_;
+    double double_value_;
+    StringBuffer * buffer_;
+    SwitchBox * box_;
   };
-  std::string string_value_;
-  const Switch * switch__;
+  CharType inline_[kInlineCapacity];
+  unsigned char tag_;
 };
 
 std::ostream& operator<< (std::ostream& out, const Value & value);
 
+/// A region of memory for building large ValueGroups.  Allocations are carved
+/// out of a few large blocks which are freed together when the Arena is
+/// destroyed, and freeing an individual allocation does nothing.  An Arena is
+/// not thread-safe, and must outlive everything allocated from it.
+///
+/// \code
+///   Arena arena;
+///   ValueGroup config(kEmptyString, &arena);
+///   // ... fill in config ...
+/// \endcode
+class Arena {
+ public:
+  /// The first block holds `block_size` bytes.  Each later block is twice
+  /// the size of the one before, up to a megabyte.
+  explicit Arena(size_t block_size = 4096);
+  ~Arena();
+
+  /// Returns `size` bytes aligned for any of the types in a ValueGroup.
+  /// Requests larger than a quarter of a block get a block of their own.
+  void * Allocate(size_t size);
+
+  /// The number of bytes handed out by Allocate(), including alignment
+  size_t bytes_used() const;
+
+  /// The number of bytes obtained from the heap for blocks
+  size_t bytes_allocated() const;
+
+ private:
+  struct Block;
+
+  // Allocates a block with room for `size` bytes and links it into blocks_
+  char * NewBlock(size_t size);
+
+  Block * blocks_;
+  char * next_;
+  char * end_;
+  size_t block_size_;
+  size_t bytes_used_;
+  size_t bytes_allocated_;
+
+  // not implemented
+  Arena(const Arena &);
+  void operator=(const Arena &);
+};
+
+/// A standard allocator which allocates from an Arena, or from the heap if it
+/// has none.  Containers exchange their allocators when swapped, so memory
+/// always returns to where it came from, but copying a container uses the
+/// heap.  Compilers without C++11 allocator support ignore the last point and
+/// copy containers into the arena of the original.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef T * pointer;
+  typedef const T * const_pointer;
+  typedef T & reference;
+  typedef const T & const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+#if YACT_HAS_RVALUE_REFERENCES
+  typedef std::true_type propagate_on_container_swap;
+  typedef std::true_type propagate_on_container_move_assignment;
+#endif
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  ArenaAllocator() : arena_(NULL) {}
+  explicit ArenaAllocator(Arena * arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> & other) : arena_(other.arena()) {}
+
+  /// The arena of this allocator, or NULL for the heap
+  Arena * arena() const { return arena_; }
+
+  pointer allocate(size_type n, const void * = NULL) {
+    return static_cast<pointer>(arena_ ? arena_->Allocate(n * sizeof(T))
+      : ::operator new(n * sizeof(T)));
+  }
+  void deallocate(pointer p, size_type) {
+    if (!arena_) {
+      ::operator delete(p);
+    }
+  }
+  void construct(pointer p, const T & value) { new(p) T(value); }
+#if YACT_HAS_RVALUE_REFERENCES
+  void construct(pointer p, T && value) { new(p) T(std::move(value)); }
+#endif
+  void destroy(pointer p) { p->~T(); }
+  pointer address(reference value) const { return &value; }
+  const_pointer address(const_reference value) const { return &value; }
+  size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+
+#if YACT_HAS_RVALUE_REFERENCES
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+#endif
+
+ private:
+  Arena * arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b) {
+  return a.arena() != b.arena();
+}
+
 /// In some cases, switches may be grouped in collections with an arbitrary name,
 /// for example, in the .INI format, you may have a something like this:
 ///
@@ -236,41 +504,110 @@ std::ostream& operator<< (std::ostream& out, const Value & value);
 /// registry and Apache-style, ValueGroup may themselves contain other
 /// ValueGroups.
 ///
+/// Copies of a ValueGroup share their contents, and subgroups are shared the
+/// same way, so copying a group takes constant time however large it is.
+/// Modifying a group copies its own contents first if they are shared, but
+/// its subgroups remain shared.  Changing one value deep in a copy therefore
+/// copies only the groups on the path to it, and keeping several versions of
+/// a configuration costs only their differences.
+///
+/// The references which the accessors return are therefore valid only until
+/// the group they came from is next modified or destroyed.  This is stricter
+/// than for a std::map: once the group has been copied, changing any of its
+/// values moves it onto contents of its own, and references taken from it
+/// before then point into the contents which the copy holds.
+///
+/// \code
+///   const Value & limit = config.value("limit");
+///   ValueGroup backup(config);
+///   config.SetValue("verbose", Value(true));
+///   // `limit` now belongs to `backup`, so read it again from `config`
+/// \endcode
+///
+/// A ValueGroup may be built in an Arena, in which case the nodes, lists and
+/// indexes of it and of the subgroups created in it come from the arena and
+/// are freed all at once with it.  Names and string values short enough to
+/// be stored inline take no memory of their own, but longer ones are still
+/// allocated on the heap.  Groups in an arena are never shared: copies of
+/// them are made in full, on the heap unless an arena is given.
+///
+/// The contents of a group may be filled in by a Loader the first time they
+/// are read, so that a parser can put off the work of parsing a group until
+/// it is used.  Loading is thread safe, as reading a group is.
+///
 class ValueGroup {
  public:
-  typedef std::vector<Value> ValueList;
-  typedef std::map<StringType, ValueList> ValueMap;
-  typedef std::map<StringType, ValueGroup> ValueGroupMap;
+  /// Fills in the contents of a group when they are first needed
+  class Loader {
+   public:
+    virtual ~Loader();
+
+    /// Adds the values and subgroups of the group being loaded to `group`,
+    /// an empty group with the same name and arena
+    virtual void Load(ValueGroup * group) = 0;
+  };
+
+  typedef std::vector<Value, ArenaAllocator<Value> > ValueList;
+  typedef std::map<StringType, ValueList, std::less<StringType>,
+    ArenaAllocator<std::pair<const StringType, ValueList> > > ValueMap;
+  typedef std::map<StringType, ValueGroup, std::less<StringType>,
+    ArenaAllocator<std::pair<const StringType, ValueGroup> > > ValueGroupMap;
 
   explicit ValueGroup(const StringType & name = kEmptyString);
+  ValueGroup(const StringType & name, Arena * arena);
+  ValueGroup(const ValueGroup & other);
+  ValueGroup(const ValueGroup & other, Arena * arena);
+  ~ValueGroup();
+  ValueGroup & operator=(const ValueGroup & other);
+#if YACT_HAS_RVALUE_REFERENCES
+  ValueGroup(ValueGroup && other);
+  ValueGroup & operator=(ValueGroup && other);
+#endif
 
   /// Gets/Sets the name of this ValueGroup.  Relevant only if this group is
-  /// contained by other ValueGroups.
+  /// contained by other ValueGroups.  The reference is valid until the group
+  /// is modified or destroyed.
   const StringType & name() const;
   ValueGroup & name(const StringType & name);
 
-  /// Accessor for the full map of values in this group.
+  /// The arena which holds this group, or NULL if it is on the heap
+  Arena * arena() const;
+
+  /// Accessor for the full map of values in this group, in order of name.
+  /// The lookups below use a hash index instead of searching the map.  The
+  /// reference is valid until the group is modified or destroyed.
   const ValueMap & values() const;
   
   /// Accessor for a single named Value.  If the value occurs more than once,
   /// returns the first element.  DCHECKs if `name` is not a valid value.
+  /// Each of these lookups also takes a nul terminated name, which does not
+  /// construct a StringType.  The reference is valid until the group is
+  /// modified or destroyed.
   const Value & value(const StringType & name) const;
+  const Value & value(const CharType * name) const;
 
   /// Accessor for a named Value.  Returns a list of elements, even if the value
   /// occurs only once.  Returns an empty list if `name` is not a valid value.
+  /// The reference is valid until the group is modified or destroyed.
   const ValueList & repeated_value(const StringType & name) const;
+  const ValueList & repeated_value(const CharType * name) const;
 
-  /// Accessor for mapping of all subgroups
+  /// Accessor for mapping of all subgroups, in order of name.  The reference
+  /// is valid until the group is modified or destroyed.
   const ValueGroupMap & groups() const;
   
-  /// Accessor for a particular named subgroup
+  /// Accessor for a particular named subgroup.  The reference is valid until
+  /// this group is modified or destroyed.
   const ValueGroup & group(const StringType & name) const;
+  const ValueGroup & group(const CharType * name) const;
 
   /// True if the value is present in the group
   bool has_value(const StringType & name) const;
+  bool has_value(const CharType * name) const;
 
   /// True if the group is present in the group
   bool has_group(const StringType & name) const;
+  bool has_group(const CharType * name) const;
 
   /// Set a single value.  Replaces any/all existing values in the group
   void SetValue(const StringType & name, const Value & value);
@@ -281,13 +618,297 @@ class ValueGroup {
   /// Remove all instances of an existing value.
   void ClearValue(const StringType & name);
 
-  /// Add a new group.  Nop if the group already exists.
+  /// Add a new group.  Nop if the group already exists.  This copies the
+  /// whole of `group` into the arena of this group, so prefer CreateGroup()
+  /// when building a tree.
   void AddGroup(const ValueGroup & group);
+
+  /// Add a new, empty group named `name` and return it so that it can be
+  /// filled in place.  Returns the existing group if there is one.  The new
+  /// group uses the arena of this group.  As with group(), the reference is
+  /// valid until this group is next modified or destroyed.
+  ValueGroup & CreateGroup(const StringType & name);
+
+#if YACT_HAS_RVALUE_REFERENCES
+  void SetValue(const StringType & name, Value && value);
+  void AddRepeatedValue(const StringType & name, Value && value);
+  void AddGroup(ValueGroup && group);
+#endif
+
+  /// Exchanges the contents, and arenas, of two groups without copying them.
+  /// Moving a group only avoids a copy if both groups use the same arena.
+  void swap(ValueGroup & other);
+
+  /// Makes `loader` fill in this group, which must be empty, the first time
+  /// it is read or modified, and takes ownership of it.  Copies of the group
+  /// made before then share the loader, and are filled in together.
+  void set_loader(Loader * loader);
   
  private:
-  StringType name_;
-  ValueMap values_;
-  ValueGroupMap groups_;
+  class Internal;
+  friend class Internal;
+
+  // An open addressing hash table over the entries of values_ or groups_.
+  // Map nodes never move, so the index holds pointers to them, and entries
+  // are never erased.  Empty slots have a NULL entry.
+  struct IndexSlot {
+    size_t hash;
+    const void * entry;
+  };
+  typedef std::vector<IndexSlot, ArenaAllocator<IndexSlot> > Index;
+
+  // The name, values, subgroups and indexes of the group, shared with its
+  // copies.  Never NULL.
+  class Data;
+  Data * data_;
+
+  // Returns data_, first copying it if it is shared with other groups
+  Data * MutableData();
+
+  // Returns data_, first filling it in if it has a loader
+  const Data * LoadedData() const;
+
+  // A stamp which changes whenever an entry is added to this group, a value
+  // gains its first element or is cleared, or the contents of the group are
+  // replaced, copied or exchanged with another group.  Stamps come from a
+  // process wide 64-bit counter, which does not wrap, so a group never reuses
+  // the stamp of another.  ValueHandle and ValueOverlay use it to tell when
+  // their cached lookups may be stale.
+  Int64Type generation_;
+  friend class ValueHandle;
+  friend class ValueOverlay;
+};
+
+/// A precompiled path to a value or subgroup nested in a ValueGroup, such as
+/// "cache.l2.size" for root.group("cache").group("l2").value("size").  The
+/// path is split and hashed once, and the first read against a root group
+/// resolves it.  Later reads against the same, unchanged, tree return the
+/// cached result after comparing one integer per level of the path.  If the
+/// tree is modified, replaced or swapped, or a different root is given, the
+/// next read resolves the path again.
+///
+/// \code
+///   static const ValueHandle kCacheSize("cache.l2.size");
+///   Int64Type size = kCacheSize.value(config).AsByteSize();
+/// \endcode
+///
+/// A ValueHandle caches its last lookup, so a handle that is shared between
+/// threads must only be read against trees that none of them modifies.
+class ValueHandle {
+ public:
+  explicit ValueHandle(const StringType & path);
+
+  /// The dotted path which this handle resolves
+  const StringType & path() const;
+
+  /// As the corresponding methods of ValueGroup, applied to the group which
+  /// contains the last element of the path.  Missing intermediate groups
+  /// behave as empty groups.
+  const Value & value(const ValueGroup & root) const;
+  const ValueGroup::ValueList & repeated_value(const ValueGroup & root) const;
+  const ValueGroup & group(const ValueGroup & root) const;
+  bool has_value(const ValueGroup & root) const;
+  bool has_group(const ValueGroup & root) const;
+
+ private:
+  // A group visited while resolving the path, and its stamp at the time
+  struct Level {
+    const ValueGroup * group;
+    Int64Type generation;
+  };
+
+  // Makes the cached lookups below valid for `root`
+  void Resolve(const ValueGroup & root) const;
+
+  StringType path_;
+  std::vector<StringType> names_;
+  std::vector<size_t> hashes_;
+  mutable std::vector<Level> levels_;
+  mutable const ValueGroup::ValueList * values_;
+  mutable const ValueGroup * group_;
+};
+
+/// A read-only view of a stack of ValueGroups, such as the defaults, a system
+/// configuration file, a user configuration file and the command line, in
+/// increasing order of precedence.  Each lookup finds the topmost layer which
+/// has a value of that name.  Nothing is merged or copied, so a change to any
+/// layer is seen by the next lookup.
+///
+/// \code
+///   ValueOverlay config;
+///   config.AddLayer(&defaults).AddLayer(&system_file.values())
+///     .AddLayer(&user_file.values()).AddLayer(&parser.result().values());
+///   int port = config.value("port").AsInt();
+/// \endcode
+///
+/// With cache_lookups(true) the overlay remembers the winning layer of each
+/// name it has looked up, so that looking it up again searches one layer
+/// instead of all of them.  The cache is discarded when a name is added to or
+/// cleared from any layer.  An overlay which caches must not be used by
+/// several threads at once.
+class ValueOverlay {
+ public:
+  ValueOverlay();
+
+  /// Adds `layer` above the existing layers.  The overlay refers to the group
+  /// rather than copying it, so it must outlive the overlay.
+  ValueOverlay & AddLayer(const ValueGroup * layer);
+
+  /// The number of layers, and the layer at `index` counting from the bottom
+  size_t layer_count() const;
+  const ValueGroup & layer(size_t index) const;
+
+  /// Gets/Sets whether to cache the winning layer of each name
+  ValueOverlay & cache_lookups(bool cache_lookups);
+  bool cache_lookups() const;
+
+  /// As the corresponding methods of ValueGroup, applied to the topmost layer
+  /// which has a value named `name`.
+  const Value & value(const StringType & name) const;
+  const Value & value(const CharType * name) const;
+  const ValueGroup::ValueList & repeated_value(const StringType & name) const;
+  const ValueGroup::ValueList & repeated_value(const CharType * name) const;
+  bool has_value(const StringType & name) const;
+  bool has_value(const CharType * name) const;
+
+  /// The index of the topmost layer with a value named `name`, or -1
+  int value_layer(const StringType & name) const;
+
+  /// True if any layer has a subgroup named `name`
+  bool has_group(const StringType & name) const;
+
+  /// An overlay of the subgroups named `name` of the layers which have one.
+  /// Like the reference returned by ValueGroup::group(), it refers to the
+  /// subgroups themselves, so it is only valid while the layers which hold
+  /// them are not modified.
+  ValueOverlay group(const StringType & name) const;
+
+ private:
+  // Returns the entry of the topmost layer with a nonempty value named
+  // `name`, or NULL.  Sets *layer to the index of that layer, if given.
+  const ValueGroup::ValueMap::value_type * Find(const CharType * name,
+    size_t length, int * layer) const;
+
+  std::vector<const ValueGroup *> layers_;
+  bool cache_lookups_;
+
+  // Winning entries, keyed by name, and the stamps of the layers when they
+  // were found.  The entries remain valid while the stamps do.
+  mutable ValueGroup::Index cache_;
+  mutable size_t cache_count_;
+  mutable std::vector<Int64Type> cache_generations_;
+};
+
+/// Publishes immutable snapshots of a configuration to any number of reader
+/// threads, for servers which reload their configuration while running.
+/// Readers never lock or retry: pinning the current snapshot costs two loads,
+/// a store and a memory barrier.  The snapshot replaced by Publish() is
+/// deleted once no reader can still be using it.
+///
+/// \code
+///   ConfigPublisher publisher(LoadConfig());
+///
+///   // once on each reader thread
+///   ConfigPublisher::Reader reader(&publisher);
+///   // and then for each request
+///   {
+///     ConfigSnapshot config(&reader);
+///     Serve(config->group("cache").value("size"));
+///   }
+///
+///   // on the thread which reloads
+///   publisher.Publish(LoadConfig());
+/// \endcode
+///
+/// Reclamation is epoch based.  Each Reader records the epoch in which it
+/// pinned its snapshot, Publish() advances the epoch, and a replaced snapshot
+/// is deleted only when every pinned epoch is later than the one in which it
+/// was replaced.  Publish(), Reclaim() and the creation of Readers take a lock
+/// among themselves but never wait for readers.
+class ConfigPublisher {
+ public:
+  class Reader;
+
+  explicit ConfigPublisher(const ValueGroup & config = ValueGroup());
+
+  /// Deletes every snapshot.  All Readers must have been destroyed.
+  ~ConfigPublisher();
+
+  /// Makes `config` the current snapshot.  Snapshots pinned later see it,
+  /// while those already pinned keep the configuration they had.
+  void Publish(const ValueGroup & config);
+#if YACT_HAS_RVALUE_REFERENCES
+  void Publish(ValueGroup && config);
+#endif
+
+  /// Deletes the replaced snapshots which no reader can still be using.
+  /// Publish() does this too, so call it only to free memory sooner.
+  void Reclaim();
+
+  /// The number of replaced snapshots which have not yet been deleted
+  size_t retired_count() const;
+
+ private:
+  class Data;
+  struct Slot;
+  friend class Reader;
+
+  // Publishes a snapshot which this publisher now owns
+  void PublishSnapshot(const ValueGroup * config);
+
+  Data * data_;
+
+  // not implemented
+  ConfigPublisher(const ConfigPublisher &);
+  void operator=(const ConfigPublisher &);
+};
+
+/// Registers a thread as a reader of a ConfigPublisher.  Create one on each
+/// reader thread and keep it for as long as the thread reads, since creating
+/// one takes the publisher's lock.  A Reader must only be used by one thread
+/// at a time and must not outlive its publisher.
+class ConfigPublisher::Reader {
+ public:
+  explicit Reader(ConfigPublisher * publisher);
+  ~Reader();
+
+ private:
+  friend class ConfigSnapshot;
+
+  // Pins and returns the current snapshot, or nests inside an existing pin
+  const ValueGroup * Pin();
+  void Unpin();
+
+  ConfigPublisher::Data * data_;
+  ConfigPublisher::Slot * slot_;
+  int depth_;
+
+  // not implemented
+  Reader(const Reader &);
+  void operator=(const Reader &);
+};
+
+/// The current configuration of a ConfigPublisher, which stays valid and
+/// unchanged for as long as the ConfigSnapshot exists even if a new one is
+/// published meanwhile.  Snapshots of one Reader may be nested.  Keep them
+/// short lived, because no snapshot published after the oldest one still
+/// pinned can be deleted.
+class ConfigSnapshot {
+ public:
+  explicit ConfigSnapshot(ConfigPublisher::Reader * reader);
+  ~ConfigSnapshot();
+
+  const ValueGroup & config() const { return *config_; }
+  const ValueGroup & operator*() const { return *config_; }
+  const ValueGroup * operator->() const { return config_; }
+
+ private:
+  ConfigPublisher::Reader * reader_;
+  const ValueGroup * config_;
+
+  // not implemented
+  ConfigSnapshot(const ConfigSnapshot &);
+  void operator=(const ConfigSnapshot &);
 };
 
 /// Defines a switch and constrains it's values.  It may specify the
@@ -312,6 +933,9 @@ class ValueGroup {
 ///   parser.add_switch(switch);
 /// \endcode
 ///
+/// Copies of a Switch share one reference counted description, so passing
+/// switches by value and storing them in a SwitchSet does not allocate.  The
+/// description is copied the first time a shared Switch is modified.
 class Switch {
  public:
   enum {
@@ -327,6 +951,13 @@ class Switch {
   Switch(const Switch & other);
   ~Switch();
   Switch& operator=(const Switch& b);
+#if YACT_HAS_RVALUE_REFERENCES
+  Switch(Switch && other);
+  Switch& operator=(Switch && other);
+#endif
+
+  /// Exchanges two switches without allocating
+  void swap(Switch & other);
   
   /// List of all the possible long names for this switch
   const std::vector<StringType> & names() const;
@@ -366,6 +997,14 @@ class Switch {
   const StringType & dest() const;
   Switch & dest(const StringType & dest);
   
+  /// The type of the value of a kActionStore, kActionAppend or
+  /// kActionStoreConstant switch, one of the Value::kType* constants.  The
+  /// argument is converted once, when it is parsed.  The default,
+  /// Value::kTypeAuto, keeps the argument as a string which may be read as
+  /// any type.
+  int type() const;
+  Switch & type(int type);
+
   /// The value of the switch when kActionStoreConstant is specified
   const Value & constant() const;
   Switch & constant(const Value & constant);
@@ -392,20 +1031,66 @@ class Switch {
   SwitchValidator * validator() const;
   
   /// Assign a custom validator.  Ownership of the argument is transferred with
-  /// the call which must be allocated with new.
+  /// the call which must be allocated with new.  Copies of this Switch share
+  /// the validator, so Validate() must not depend on per-copy state.
   Switch & validator(SwitchValidator * validator);
   
 private:
-  std::vector<StringType> names_;
-  CharType short_flag_;
-  int action_;
-  StringType dest_;
-  Value constant_;
-  Value default__;
-  std::vector<StringType> choices_;
-  StringType help_;
-  StringType environment_variable_;
-  SwitchValidator * validator_;
+  class Data;
+  class SharedValidator;
+
+  // Returns data_, first detaching it from any other Switch that shares it
+  Data * MutableData();
+
+  // The description is immutable once shared; copying a Switch copies only
+  // this pointer.
+  Data * data_;
+};
+
+/// A switch description which can be declared as static, constant data.
+/// SwitchSpec is an aggregate of plain pointers and integers, so an array of
+/// them is initialized by the compiler and placed in read-only storage without
+/// running any constructors at startup.  Compile such a table into a
+/// CompiledSwitchSet, and read the results back by the position of each switch
+/// in the table with the typed accessors of ParseResult:
+///
+/// \code
+///   enum { kVerbose, kOutput, kSwitchCount };
+///   static const SwitchSpec kSwitches[kSwitchCount] = {
+///     { "verbose", 'v', Switch::kActionCount, NULL, "Be chatty",
+///       Value::kTypeAuto },
+///     { "output", 'o', Switch::kActionStore, "a.out", "Output file",
+///       Value::kTypeAuto },
+///   };
+///   static const CompiledSwitchSet switches(kSwitches);
+///
+///   ParseResult result;
+///   if (switches.Parse(argc, argv, &result) &&
+///       result.int_value(kVerbose) > 1) {
+///     printf("writing %s\n", result.string_value(kOutput).c_str());
+///   }
+/// \endcode
+struct SwitchSpec {
+  /// The long name of the switch.  Required.
+  const CharType * name;
+
+  /// The short flag, or 0 for none.
+  CharType short_flag;
+
+  /// One of the Switch::kAction* constants.
+  int action;
+
+  /// The default value for kActionStore switches, or NULL.  Other actions use
+  /// the default that Switch::action() implies.
+  const CharType * default_value;
+
+  /// The help text, or NULL.
+  const CharType * help;
+
+  /// The Value::kType* of a kActionStore or kActionAppend switch, or
+  /// Value::kTypeAuto for other actions and untyped arguments.  A
+  /// default_value is converted to this type.
+  int type;
 };
 
 /// An abstract class which is the base for switch validators.  Assign
@@ -435,16 +1120,177 @@ public:
 
   void insert(const Switch & switch_);
   void insert(const StringType & group, const Switch & switch_);
+#if YACT_HAS_RVALUE_REFERENCES
+  void insert(Switch && switch_);
+  void insert(const StringType & group, Switch && switch_);
+#endif
+
+  /// Exchanges the contents of two sets without copying them
+  void swap(SwitchSet & other);
   
   const GroupList & switches() const;
   const List & switches(const StringType & group) const;
   const Switch & switch_(const StringType & group, const StringType & name);
 
-  bool has_switch(const StringType & group, const StringType & name);
+  bool has_switch(const StringType & group, const StringType & name) const;
 private:
+  // Returns the list of switches in `group`, adding it if necessary
+  List & group_list(const StringType & group);
+
   GroupList switches_;
 };
 
+/// The outcome of parsing one command line with a CompiledSwitchSet.  A
+/// ParseResult holds only per-parse state, so it is cheap to create one per
+/// call.
+class ParseResult {
+ public:
+  ParseResult();
+  ParseResult(const ParseResult & other);
+  ParseResult & operator=(const ParseResult & other);
+  ~ParseResult();
+
+  /// The name of the program, taken from the first element of argv.
+  const StringType & program() const;
+
+  /// A text description of the error if Parse() returned false
+  const StringType & error() const;
+
+  /// Returns the free arguments.  They are copied out of argument_views() by
+  /// the first call, so a result which is shared between threads must not
+  /// call this on several of them at once.
+  const std::vector<StringType> & arguments() const;
+
+  /// Returns the free arguments without copying them.  They point into a copy
+  /// of argv made by Parse() and into the response files they were read
+  /// from, which stay mapped for as long as the views need them.  Only
+  /// arguments which had quotes or escapes removed are copied one by one.
+  /// The views remain valid until the result is cleared, parsed into again or
+  /// destroyed, and copies of the result share them.
+  const std::vector<TextView> & argument_views() const;
+
+  /// Returns the named switch value
+  const Value & value(const StringType & name) const;
+  const ValueGroup::ValueList & repeated_value(const StringType & name) const;
+
+  /// Returns all the values
+  const ValueGroup & values() const;
+
+  /// Returns the value of a switch by its position in the CompiledSwitchSet
+  /// which produced this result, i.e. the index of its SwitchSpec or the order
+  /// in which it was inserted into the unnamed group of the SwitchSet.  These
+  /// avoid looking up the name in values().  The typed forms DCHECK that the
+  /// value holds the requested type.
+  const Value & value(int index) const;
+  int int_value(int index) const;
+  bool bool_value(int index) const;
+  StringType string_value(int index) const;
+  Int64Type int64_value(int index) const;
+  double double_value(int index) const;
+  Int64Type duration_value(int index) const;
+  Int64Type byte_size_value(int index) const;
+
+  /// The number of times the switch at `index` (see value(int)) appeared on
+  /// the command line.  For kActionCount switches given without arguments
+  /// this is the same as their value.
+  int count(int index) const;
+
+  /// The candidate switches for a `--complete` command line.  See
+  /// ArgumentParser::enable_completion().
+  const std::vector<StringType> & completions() const;
+
+  /// Reset to the state of a newly constructed ParseResult.
+  void Clear();
+
+ private:
+  StringType program_;
+  StringType error_;
+  std::vector<TextView> argument_views_;
+  mutable std::vector<StringType> arguments_;
+  // The text which argument_views_ point into, shared with copies.  NULL
+  // until the first Parse().
+  ArgumentStorage * storage_;
+  ValueGroup values_;
+  std::vector<const ValueGroup::ValueList *> slots_;
+  std::vector<int> counts_;
+  std::vector<int> tallies_;
+  std::vector<StringType> completions_;
+  friend class CompiledSwitchSet;
+
+  // Points slots_ at the values of this result which correspond to the
+  // slots of `other`, whose values this result holds a copy of.
+  void CopySlots(const ParseResult & other);
+};
+
+/// An immutable, compiled form of a SwitchSet together with the options that
+/// control parsing.  It holds its own copy of the switches and the lookup
+/// structures built from them, and never changes after construction, so a
+/// single instance may be shared by any number of threads which call Parse()
+/// concurrently without locking.  Each thread supplies its own ParseResult.
+///
+/// \code
+///   // once, at startup
+///   static const CompiledSwitchSet * switches =
+///     new CompiledSwitchSet(ArgumentParser().AddSwitch(...).AddSwitch(...));
+///
+///   // on any thread
+///   ParseResult result;
+///   if (!switches->Parse(argc, argv, &result)) {
+///     return Reject(result.error());
+///   }
+/// \endcode
+///
+/// Note that SwitchValidators attached to the switches are invoked from
+/// whichever thread is parsing, and so must themselves be thread-safe.
+class CompiledSwitchSet {
+ public:
+  /// Compiles `switch_set` with the default parsing options.
+  explicit CompiledSwitchSet(const SwitchSet & switch_set);
+
+  /// Compiles the switches and parsing options of `parser`.
+  explicit CompiledSwitchSet(const ArgumentParser & parser);
+
+  /// Compiles a static table of switches with the default parsing options.
+  CompiledSwitchSet(const SwitchSpec * specs, size_t count);
+
+  template <size_t N>
+  explicit CompiledSwitchSet(const SwitchSpec (&specs)[N])
+    : index_(NULL),
+      enable_parse_environment_(true),
+      enable_completion_(false),
+      enable_response_files_(false) {
+    Init(specs, N);
+  }
+  ~CompiledSwitchSet();
+
+  const SwitchSet & switch_set() const;
+
+  /// Parse a command line into `result`, replacing its previous contents.
+  bool Parse(int argc, const CharType ** argv, ParseResult * result) const;
+  bool Parse(const std::vector<StringType> & argv, ParseResult * result) const;
+
+  /// \copydoc ArgumentParser::Complete()
+  void Complete(const StringType & prefix,
+    std::vector<StringType> * completions) const;
+
+ private:
+  class Internal;
+
+  void Init(const SwitchSpec * specs, size_t count);
+
+  SwitchSet switch_set_;
+  SwitchIndex * index_;
+  bool enable_parse_environment_;
+  bool enable_completion_;
+  bool enable_response_files_;
+  StringType environment_prefix_;
+  StringType registry_prefix_;
+
+  // not implemented
+  CompiledSwitchSet(const CompiledSwitchSet &);
+  void operator=(const CompiledSwitchSet &);
+};
+
 /// This class implements the POSIX a standard argument parser with the GNU 
 /// long options extension.
 /// 
@@ -460,6 +1306,9 @@ private:
 class ArgumentParser {
  public:
   ArgumentParser();
+  ArgumentParser(const ArgumentParser & other);
+  ~ArgumentParser();
+  ArgumentParser & operator=(const ArgumentParser & other);
   
   const StringType & program() const;
   ArgumentParser & program(const StringType & program);
@@ -478,8 +1327,33 @@ class ArgumentParser {
   /// switch_set().
   ArgumentParser & AddSwitch(const Switch & switch_);
 
+#if YACT_HAS_RVALUE_REFERENCES
+  ArgumentParser & switch_set(SwitchSet && switch_set);
+  ArgumentParser & AddSwitch(Switch && switch_);
+#endif
+
   /// Flags that control the behavior of the Parse() function
   ArgumentParser & enable_parse_environment(bool enable_parse_environment);
+
+  /// If enabled, a command line of the form `program --complete PREFIX` is
+  /// not parsed as usual.  Instead, Parse() stores the long switches which
+  /// begin with PREFIX in completions().  This is intended to back shell
+  /// completion scripts.
+  ArgumentParser & enable_completion(bool enable_completion);
+
+  /// If enabled, an argument of the form `@FILE` is replaced by the arguments
+  /// listed in FILE, separated by whitespace and quoted as in a POSIX shell.
+  /// This allows command lines longer than the operating system permits.
+  /// The file is memory mapped and read incrementally, so it may be very
+  /// large.  Response files may refer to other response files.
+  ArgumentParser & enable_response_files(bool enable_response_files);
+
+  /// If set, only environment variables whose names begin with this prefix
+  /// (e.g. "MYAPP_") are considered when parsing the environment, and the
+  /// rest are skipped without being copied.  Switches whose
+  /// environment_variable() lacks the prefix are then never read from the
+  /// environment.
+  ArgumentParser & environment_prefix(const StringType & environment_prefix);
   ArgumentParser & registry_prefix(const StringType & registry_prefix);
   // ... nop on platforms other than windos
   
@@ -493,6 +1367,10 @@ class ArgumentParser {
   /// command line '--verbose foo --verbose' is specified, `foo` would be added
   /// to `arguments`
   const std::vector<StringType> & arguments() const;
+
+  /// Returns the free arguments without copying them.  See
+  /// ParseResult::argument_views().
+  const std::vector<TextView> & argument_views() const;
   
   /// Returns the named switch value
   const Value & value(const std::string & name) const;
@@ -501,23 +1379,39 @@ class ArgumentParser {
   /// Returns all the values
   const ValueGroup & values() const;
 
-private:
-  const Switch * GetSwitch(CharType ch) const;
-  const Switch * GetSwitch(const StringType & name) const;
-  bool SetValueWithArgument(const Switch & switch_, const StringType & value);
-  bool SetValueWithoutArgument(const Switch & switch_);
+  /// Appends the long switches (e.g. "--verbose") which begin with `prefix` to
+  /// `completions` in lexicographic order.  `prefix` may be given with or
+  /// without the leading dashes.  A prefix of the form "no-..." also
+  /// completes the negated form of boolean switches.
+  void Complete(const StringType & prefix,
+    std::vector<StringType> * completions);
 
-  class Internal;
+  /// The result of Complete() for the last Parse() of a `--complete` command
+  /// line.  See enable_completion().
+  const std::vector<StringType> & completions() const;
+
+  /// Returns the compiled form of the switches and options configured so far,
+  /// building it if necessary.  The returned object remains valid until the
+  /// switches or options of this parser are modified, and may be shared
+  /// between threads.
+  const CompiledSwitchSet & Compile();
+
+  /// The result of the last Parse()
+  const ParseResult & result() const;
 
+private:
   StringType program_;
   StringType usage_;
   StringType version_;
   SwitchSet switch_set_;
   bool enable_parse_environment_;
+  bool enable_completion_;
+  bool enable_response_files_;
+  StringType environment_prefix_;
   StringType registry_prefix_;
-  std::vector<StringType> arguments_;
-  ValueGroup values_;
-  StringType error_;
+  CompiledSwitchSet * compiled_;
+  ParseResult result_;
+  friend class CompiledSwitchSet;
 };
 
 /// This class encapsulates an error parsing a configuration file.  It 
@@ -533,6 +1427,48 @@ class ConfigError {
   friend class ConfigParser;
 };
 
+/// Receives the contents of a configuration file as a parser finds them, for
+/// callers which filter or aggregate a large file rather than keep all of it
+/// in a ValueGroup.  Pass one to ConfigParser::Parse(filename, handler).
+///
+/// \code
+///   class RouteCounter : public ConfigHandler {
+///    public:
+///     RouteCounter() : routes(0) {}
+///     virtual bool OnKeyValue(const Text & key, const Text & value,
+///         int line) {
+///       if (key == "gateway") {
+///         ++routes;
+///       }
+///       return true;
+///     }
+///     int routes;
+///   };
+/// \endcode
+///
+/// Names, keys and values point into the parser's input and are only valid
+/// during the call, so a handler which keeps them must copy them.
+class ConfigHandler {
+ public:
+  /// Characters of the input which are passed to a handler without copying
+  typedef TextView Text;
+
+  virtual ~ConfigHandler();
+
+  /// Called for each section header, or each subgroup of a format without
+  /// sections, with the name of the section.  `line` counts from one, or is
+  /// zero if the parser does not know it.  Returning false stops the parse.
+  virtual bool OnSection(const Text & name, int line);
+
+  /// Called for each value, which belongs to the section named most recently
+  /// or to the top level if none has been.  Returning false stops the parse.
+  virtual bool OnKeyValue(const Text & key, const Text & value, int line);
+
+  /// Called once if the file cannot be read or is malformed, after which the
+  /// parse stops.  The parser's error() is also set to `message`.
+  virtual void OnError(const StringType & message, int line);
+};
+
 /// This is a base class for the various configuration file formats that we
 /// suppoort.  You should instantiate subclasses of this class such as
 /// ApacheConfigParser, JsonConfigParser or IniConfigParser and use the interface
@@ -541,6 +1477,14 @@ class ConfigParser {
  public:
   virtual ~ConfigParser();
   virtual bool Parse(const StringType & filename) = 0;
+
+  /// Parses `filename`, passing its contents to `handler` as they are found
+  /// instead of storing them in values().  Returns false if the file cannot
+  /// be read or is malformed, but not if the handler stops the parse early.
+  /// Parsers which stream the file, such as IniConfigParser, need memory for
+  /// the longest line rather than for the whole file.  The default parses the
+  /// file into values() and then passes them to the handler.
+  virtual bool Parse(const StringType & filename, ConfigHandler * handler);
   
   const StringType & error() const;
   const ValueGroup & values() const;
@@ -554,6 +1498,12 @@ class ConfigParser {
   /// If true, then groups with no registered switch parser will be rejected.
   ConfigParser & reject_unknown_switches(bool reject_unknown_switches);
   bool reject_unknown_switches() const;
+
+  /// Builds values() in `arena` instead of on the heap, so that a large
+  /// configuration is freed all at once with the arena, which must outlive
+  /// the parser.  Discards any values already parsed.
+  ConfigParser & arena(Arena * arena);
+  Arena * arena() const;
   
  protected:
   ConfigParser();
@@ -563,23 +1513,88 @@ class ConfigParser {
 
   SwitchSet switch_set_;
   bool reject_unknown_switches_;
-  
+
+  // A handler which stores what it is given in values_, so that a parser
+  // which streams its input may implement Parse(filename) with it
+  class Builder;
+  friend class Builder;
 };
 
 class ApacheConfigParser : public ConfigParser {
   virtual bool Parse(const StringType & filename);
 };
 
+/// Parses INI files:
+///
+/// \code
+///   ; a comment
+///   global = value
+///   [section]
+///   key = value  # another comment
+/// \endcode
+///
+/// Keys before the first section header are stored in values(), and keys
+/// after it in the subgroup named by the header.  A key which appears more
+/// than once in a section has a repeated value.  Values are stored as
+/// strings, to be converted by the accessors of Value, except that a key
+/// whose switch in switch_set() has a Switch::type() is converted to that type
+/// once, as it is parsed.  A value which does not convert is an error.
 class IniConfigParser : public ConfigParser {
 public:
   IniConfigParser();
+
+  /// Maps `filename` into memory and parses it in a single pass, replacing
+  /// values().  Keys and values are not copied until they are stored.
   virtual bool Parse(const StringType & filename);
-  
+
+  /// Maps `filename` into memory and passes its sections and keys to
+  /// `handler` in a single pass, without copying them.
+  virtual bool Parse(const StringType & filename, ConfigHandler * handler);
+
+  /// Parses `contents`, the text of an INI file, replacing values() or
+  /// passing it to `handler`
+  bool ParseString(const std::string & contents);
+  bool ParseString(const std::string & contents, ConfigHandler * handler);
+
+  /// Gets/Sets the number of threads which build values(), one by default.
+  /// A large file is split at line boundaries into a part for each thread,
+  /// the parts are parsed side by side, and their values are merged in the
+  /// order of the file, so values() and error() are the same as with one
+  /// thread.  Files of less than 256 KB a thread use fewer threads, and
+  /// parsing into an arena or to a ConfigHandler uses only one.
+  IniConfigParser & threads(int threads);
+  int threads() const;
+
+  /// Gets/Sets whether Parse() and ParseString() put off parsing a section
+  /// until it is first read.  The file is only scanned for section headers,
+  /// and is kept in memory until every section has been read or the values
+  /// are destroyed, so the cost of a parse grows with the number of sections
+  /// used rather than with the size of the file.  A malformed line or an
+  /// unknown switch in a section is only found when the section is read,
+  /// when it is logged and ends the section.  Parsing into an arena or to a
+  /// ConfigHandler is never lazy.
+  IniConfigParser & lazy(bool lazy);
+  bool lazy() const;
+
 private:
-  bool Parse(FILE * fp);
-  bool ParseLine(StringType & line, int line_number);
-  bool AssignValue(const StringType & key, const StringType & value);
-  StringType section_;
+  class Chunk;
+  class Source;
+  class LazySection;
+
+  bool ParseFile(const StringType & filename, ConfigHandler * handler);
+
+  // Passes `data` to `handler`, or builds values() if it is NULL
+  bool ParseBuffer(const char * data, size_t size, ConfigHandler * handler);
+
+  // Builds values() from `count` parts of `data` on as many threads
+  bool ParseChunks(const char * data, size_t size, int count);
+
+  // Builds values() with a loader for each section of `source`, and takes
+  // ownership of it
+  bool ParseLazily(Source * source);
+
+  int threads_;
+  bool lazy_;
 };
 
 class JsonConfigParser : public ConfigParser {
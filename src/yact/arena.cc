@@ -0,0 +1,91 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include <yact.h>
+#include "base/logging.h"
+
+namespace yact {
+
+namespace {
+
+// Enough for the pointers, int64s and doubles in a ValueGroup
+const size_t kAlignment = 8;
+
+// Blocks stop growing at this size
+const size_t kMaxBlockSize = 1 << 20;
+
+size_t Align(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+// The header at the start of each block.  Its size is a multiple of
+// kAlignment on both 32 and 64 bit platforms.
+struct Arena::Block {
+  Block * next;
+  size_t size;
+};
+
+Arena::Arena(size_t block_size)
+  : blocks_(NULL),
+    next_(NULL),
+    end_(NULL),
+    block_size_(Align(block_size)),
+    bytes_used_(0),
+    bytes_allocated_(0) {
+  DCHECK_GT(block_size, 0U);
+}
+
+Arena::~Arena() {
+  while (blocks_) {
+    Block * block = blocks_;
+    blocks_ = block->next;
+    delete[] reinterpret_cast<char *>(block);
+  }
+}
+
+void * Arena::Allocate(size_t size) {
+  size = size ? Align(size) : kAlignment;
+  bytes_used_ += size;
+  if (size <= static_cast<size_t>(end_ - next_)) {
+    char * result = next_;
+    next_ += size;
+    return result;
+  }
+
+  // Large requests get a block of their own, which leaves the rest of the
+  // current block for later requests
+  if (size > block_size_ / 4) {
+    return NewBlock(size);
+  }
+
+  next_ = NewBlock(block_size_);
+  end_ = next_ + block_size_;
+  if (block_size_ < kMaxBlockSize) {
+    block_size_ *= 2;
+  }
+  char * result = next_;
+  next_ += size;
+  return result;
+}
+
+size_t Arena::bytes_used() const {
+  return bytes_used_;
+}
+
+size_t Arena::bytes_allocated() const {
+  return bytes_allocated_;
+}
+
+char * Arena::NewBlock(size_t size) {
+  size_t block_size = sizeof(Block) + size;
+  Block * block = reinterpret_cast<Block *>(new char[block_size]);
+  block->next = blocks_;
+  block->size = size;
+  blocks_ = block;
+  bytes_allocated_ += block_size;
+  return reinterpret_cast<char *>(block + 1);
+}
+
+}  // namespace yact
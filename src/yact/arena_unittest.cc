@@ -0,0 +1,95 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "base/scoped_ptr.h"
+#include "base/string_number_conversions.h"
+
+namespace yact {
+
+class ArenaTest : public BaseTest {
+};
+
+namespace {
+
+// Fills `group` with `count` subgroups of `count` values each
+void FillGroup(ValueGroup * group, int count) {
+  for (int i = 0; i < count; ++i) {
+    ValueGroup & child = group->CreateGroup("g" + base::IntToString(i));
+    for (int j = 0; j < count; ++j) {
+      child.SetValue("v" + base::IntToString(j), Value(j));
+    }
+  }
+}
+
+}  // anonymous namespace
+
+TEST_F(ArenaTest, Allocate) {
+  Arena arena(64);
+  EXPECT_EQ(0, arena.bytes_used());
+  EXPECT_EQ(0, arena.bytes_allocated());
+
+  char * first = static_cast<char *>(arena.Allocate(1));
+  char * second = static_cast<char *>(arena.Allocate(12));
+  char * third = static_cast<char *>(arena.Allocate(8));
+  EXPECT_EQ(0, reinterpret_cast<size_t>(first) % 8);
+  EXPECT_EQ(first + 8, second);
+  EXPECT_EQ(second + 16, third);
+  EXPECT_EQ(32, arena.bytes_used());
+  size_t allocated = arena.bytes_allocated();
+  EXPECT_GT(allocated, 64U);
+
+  // A large request does not use up the current block
+  arena.Allocate(1000);
+  EXPECT_EQ(third + 8, arena.Allocate(8));
+  EXPECT_EQ(1040, arena.bytes_used());
+  EXPECT_GT(arena.bytes_allocated(), allocated + 1000);
+}
+
+TEST_F(ArenaTest, ValueGroup) {
+  int allocations = AllocationCount();
+  {
+    ValueGroup heap;
+    FillGroup(&heap, 20);
+  }
+  int heap_allocations = AllocationCount() - allocations;
+
+  Arena arena;
+  allocations = AllocationCount();
+  scoped_ptr<ValueGroup> root(new ValueGroup(kEmptyString, &arena));
+  FillGroup(root.get(), 20);
+  EXPECT_LT(AllocationCount() - allocations, heap_allocations / 10);
+  EXPECT_EQ(&arena, root->arena());
+  EXPECT_EQ(&arena, root->group("g3").arena());
+  EXPECT_EQ(Value(7), root->group("g3").value("v7"));
+  EXPECT_GT(arena.bytes_used(), 0U);
+  EXPECT_GE(arena.bytes_allocated(), arena.bytes_used());
+
+  // Copies are made on the heap, and so outlive the arena
+  ValueGroup copy(*root);
+  EXPECT_EQ(NULL, copy.arena());
+  EXPECT_EQ(NULL, copy.group("g3").arena());
+
+  // Assignment keeps the arena of the group assigned to
+  ValueGroup other(kEmptyString, &arena);
+  other = copy;
+  EXPECT_EQ(&arena, other.group("g3").arena());
+
+  // Adding a group from elsewhere copies it into the arena
+  ValueGroup extra("extra");
+  extra.SetValue("name", "a string long enough to be on the heap");
+  root->AddGroup(extra);
+#if YACT_HAS_RVALUE_REFERENCES
+  ValueGroup moved("moved");
+  moved.SetValue("name", "Bob");
+  root->AddGroup(std::move(moved));
+  EXPECT_EQ(&arena, root->group("moved").arena());
+#endif
+  EXPECT_EQ(&arena, root->group("extra").arena());
+
+  root.reset();
+  EXPECT_EQ(Value(7), copy.group("g3").value("v7"));
+}
+
+}  // namespace yact
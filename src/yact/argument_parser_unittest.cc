@@ -10,8 +10,12 @@
 #endif  // defined(OS_WIN)
 #include "yact/test_common.h"
 #include "yact/environment.h"
+#include "yact/string.h"
 #include "base/basictypes.h"
+#include "base/file_path.h"
+#include "base/file_util.h"
 #include "base/logging.h"
+#include "base/string_number_conversions.h"
 #if defined(OS_WIN)
 #include "base/registry.h"
 #endif  // defined(OS_WIN)
@@ -258,6 +262,198 @@ TEST_F(ArgumentParserTest, DoubleDashTerminatesOptions) {
   EXPECT_EQ("freearg", parser_.arguments()[1]);
 }
 
+TEST_F(ArgumentParserTest, CanParseVector) {
+  std::vector<StringType> argv;
+  argv.push_back("test.exe");
+  argv.push_back("-BfbarB");
+  for (int i = 0; i < 1000; ++i) {
+    argv.push_back("freearg");
+  }
+  ASSERT_TRUE(parser_.Parse(argv)) << parser_.error();
+  EXPECT_EQ(Value("barB"), parser_.value("foo"));
+  EXPECT_EQ(Value(1), parser_.value("bax"));
+  ASSERT_EQ(1000, parser_.arguments().size());
+  EXPECT_EQ("freearg", parser_.arguments()[999]);
+}
+
+// 18. --fo=bar --qu one (unique abbreviations)
+TEST_F(ArgumentParserTest, CanAbbreviateLongForm) {
+  const char * argv[] = {"test.exe", "--fo=bar", "--qu", "one"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv)) << parser_.error();
+  EXPECT_EQ(Value("bar"), parser_.value("foo"));
+  ASSERT_EQ(1, parser_.repeated_value("qux").size());
+  EXPECT_EQ(Value("one"), parser_.repeated_value("qux")[0]);
+}
+
+// 19. --ba (ERROR, could be --bar or --bax)
+TEST_F(ArgumentParserTest, AmbiguousAbbreviationFails) {
+  const char * argv[] = {"test.exe", "--ba"};
+  EXPECT_FALSE(parser_.Parse(arraysize(argv), argv));
+  EXPECT_EQ("ambiguous switch '--ba' could be --bar --bax", parser_.error());
+}
+
+// 20. --verb (aliases of a single switch are not ambiguous)
+TEST_F(ArgumentParserTest, AbbreviationOfAliasesIsNotAmbiguous) {
+  parser_.AddSwitch(Switch().name("verbose").name("verbosity").count());
+  const char * argv[] = {"test.exe", "--verb", "--verbosi"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv)) << parser_.error();
+  EXPECT_EQ(Value(2), parser_.value("verbose"));
+}
+
+// 21. --no-colo (abbreviated negation)
+TEST_F(ArgumentParserTest, CanAbbreviateNegation) {
+  parser_.AddSwitch(Switch().name("color").store_true());
+  const char * argv[] = {"test.exe", "--no-colo"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv)) << parser_.error();
+  EXPECT_EQ(Value(false), parser_.value("color"));
+}
+
+TEST_F(ArgumentParserTest, Complete) {
+  parser_.AddSwitch(Switch().name("color").store_true());
+  std::vector<StringType> completions;
+  parser_.Complete("--ba", &completions);
+  ASSERT_EQ(2, completions.size());
+  EXPECT_EQ("--bar", completions[0]);
+  EXPECT_EQ("--bax", completions[1]);
+
+  completions.clear();
+  parser_.Complete("no-", &completions);
+  ASSERT_EQ(2, completions.size());
+  EXPECT_EQ("--no-bar", completions[0]);
+  EXPECT_EQ("--no-color", completions[1]);
+
+  completions.clear();
+  parser_.Complete("--zzz", &completions);
+  EXPECT_EQ(0, completions.size());
+}
+
+TEST_F(ArgumentParserTest, CompleteCommandLine) {
+  parser_.enable_completion(true);
+  const char * argv[] = {"test.exe", "--complete", "--f"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv));
+  ASSERT_EQ(1, parser_.completions().size());
+  EXPECT_EQ("--foo", parser_.completions()[0]);
+  EXPECT_EQ(0, parser_.arguments().size());
+}
+
+namespace {
+// Writes `contents` to a new temporary file and returns its name
+StringType WriteResponseFile(const std::string & contents, FilePath * path) {
+  bool ok = file_util::CreateTemporaryFile(path);
+  DCHECK(ok);
+  file_util::WriteFile(*path, contents.data(), contents.size());
+#if defined(OS_WIN)
+  return WideToString(path->value());
+#else  // !OS_WIN
+  return path->value();
+#endif  // !OS_WIN
+}
+}  // anonymous namespace
+
+TEST_F(ArgumentParserTest, ResponseFile) {
+  FilePath inner_path, outer_path;
+  StringType inner = WriteResponseFile("-B 'free arg'\n", &inner_path);
+  StringType outer = WriteResponseFile("--foo \"a b\"\n@" + inner +
+    "\n--qux=x", &outer_path);
+  StringType outer_arg = "@" + outer;
+
+  const char * argv[] = {"test.exe", "-B", outer_arg.c_str(), "--qux", "y"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv));
+  ASSERT_EQ(1, parser_.arguments().size());
+  EXPECT_EQ(outer_arg, parser_.arguments()[0]);
+
+  parser_.enable_response_files(true);
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv));
+  EXPECT_EQ(Value("a b"), parser_.value("foo"));
+  EXPECT_EQ(Value(2), parser_.value("bax"));
+  ASSERT_EQ(2, parser_.repeated_value("qux").size());
+  EXPECT_EQ(Value("x"), parser_.repeated_value("qux")[0]);
+  EXPECT_EQ(Value("y"), parser_.repeated_value("qux")[1]);
+  ASSERT_EQ(1, parser_.arguments().size());
+  EXPECT_EQ("free arg", parser_.arguments()[0]);
+
+  // A switch may take its argument from the next line of the file
+  file_util::WriteFile(inner_path, "--foo", 5);
+  StringType inner_arg = "@" + inner;
+  const char * argv2[] = {"test.exe", inner_arg.c_str(), "bar"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv2), argv2));
+  EXPECT_EQ(Value("bar"), parser_.value("foo"));
+
+  // The last switch in a file is still readable once the file has run out
+  const char * argv4[] = {"test.exe", inner_arg.c_str(), "--bar"};
+  ASSERT_FALSE(parser_.Parse(arraysize(argv4), argv4));
+  EXPECT_EQ("switch --foo requires an argument", parser_.error());
+  file_util::WriteFile(inner_path, "-Bf", 3);
+  ASSERT_FALSE(parser_.Parse(arraysize(argv4), argv4));
+  EXPECT_EQ("switch -f requires an argument", parser_.error());
+
+  const char * argv3[] = {"test.exe", "@/this/file/does/not/exist"};
+  ASSERT_FALSE(parser_.Parse(arraysize(argv3), argv3));
+  EXPECT_EQ("cannot read response file '/this/file/does/not/exist'",
+    parser_.error());
+
+  // A file which includes itself
+  file_util::WriteFile(inner_path, inner_arg.data(), inner_arg.size());
+  ASSERT_FALSE(parser_.Parse(arraysize(argv2), argv2));
+  EXPECT_EQ("response files are nested too deeply", parser_.error());
+
+  file_util::Delete(inner_path, false);
+  file_util::Delete(outer_path, false);
+}
+
+TEST_F(ArgumentParserTest, ArgumentViews) {
+  FilePath path;
+  std::string contents;
+  for (int i = 0; i < 1000; ++i) {
+    contents += "free" + base::IntToString(i) + "\n";
+  }
+  contents += "\"quoted arg\"\n";
+  StringType file_arg = "@" + WriteResponseFile(contents, &path);
+  parser_.enable_response_files(true);
+
+  ParseResult copy;
+  {
+    std::vector<StringType> argv;
+    argv.push_back("test.exe");
+    argv.push_back("first");
+    argv.push_back(file_arg);
+    int allocations = AllocationCount();
+    ASSERT_TRUE(parser_.Compile().Parse(argv, &copy));
+    // The arguments in the file are not copied one by one
+    EXPECT_LT(AllocationCount() - allocations, 100);
+  }
+
+  // The views outlive argv and point into the mapped file
+  const std::vector<TextView> & views = copy.argument_views();
+  ASSERT_EQ(1002, views.size());
+  EXPECT_EQ("first", views[0].as_string());
+  EXPECT_TRUE(views[1] == "free0");
+  EXPECT_EQ(views[1].data() + 6, views[2].data());
+  EXPECT_TRUE(views[1000] == "free999");
+  EXPECT_TRUE(views[1001] == "quoted arg");
+  ASSERT_EQ(1002, copy.arguments().size());
+  EXPECT_EQ("free999", copy.arguments()[1000]);
+
+  // Copies share the views, which stay valid when the original is reused
+  ParseResult other(copy);
+  const char * argv2[] = {"test.exe", "second"};
+  ASSERT_TRUE(parser_.Compile().Parse(arraysize(argv2), argv2, &copy));
+  ASSERT_EQ(1, copy.argument_views().size());
+  EXPECT_TRUE(copy.argument_views()[0] == "second");
+  ASSERT_EQ(1002, other.argument_views().size());
+  EXPECT_TRUE(other.argument_views()[500] == "free499");
+  EXPECT_TRUE(other.argument_views()[1001] == "quoted arg");
+  EXPECT_EQ("first", other.arguments()[0]);
+
+  // ArgumentParser forwards the views of its result
+  const char * argv3[] = {"test.exe", file_arg.c_str()};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv3), argv3));
+  ASSERT_EQ(1001, parser_.argument_views().size());
+  EXPECT_TRUE(parser_.argument_views()[0] == "free0");
+
+  file_util::Delete(path, false);
+}
+
 TEST_F(ArgumentParserTest, Environment1) {
   Environment env;
   env.Set("FOO", "shadowed");
@@ -286,6 +482,41 @@ TEST_F(ArgumentParserTest, Environment2) {
   EXPECT_EQ(0, parser_.arguments().size());
 }
 
+TEST_F(ArgumentParserTest, EnvironmentAppendErrors) {
+  parser_.AddSwitch(Switch().name("port").append().type(Value::kTypeInt));
+  const char * argv[] = {"test.exe", "--port", "x"};
+  ASSERT_FALSE(parser_.Parse(arraysize(argv), argv));
+  StringType command_line_error = parser_.error();
+
+  // A list item which does not convert fails the parse as it would on the
+  // command line
+  Environment env;
+  env.Set("PORT", "80,x,90");
+  const char * argv2[] = {"test.exe"};
+  ASSERT_FALSE(parser_.Parse(arraysize(argv2), argv2));
+  EXPECT_EQ(command_line_error, parser_.error());
+
+  env.Set("PORT", "80,90");
+  ASSERT_TRUE(parser_.Parse(arraysize(argv2), argv2));
+  ASSERT_EQ(2, parser_.repeated_value("port").size());
+  EXPECT_EQ(90, parser_.repeated_value("port")[1].AsInt());
+}
+
+TEST_F(ArgumentParserTest, EnvironmentPrefix) {
+  Environment env;
+  env.Set("FOO", "unprefixed");
+  env.Set("MYAPP_LEVEL", "7");
+  parser_
+    .AddSwitch(Switch().name("level").environment_variable("MYAPP_LEVEL")
+      .store())
+    .environment_prefix("MYAPP_");
+  const char * argv[] = {"test.exe"};
+  ASSERT_TRUE(parser_.Parse(arraysize(argv), argv));
+  EXPECT_EQ(Value("7"), parser_.value("level"));
+  EXPECT_EQ(Value(false), parser_.value("foo"));  // the default
+  env.Unset("MYAPP_LEVEL");
+}
+
 
 #if defined(OS_WIN)
 TEST_F(ArgumentParserTest, Registry1) {
@@ -0,0 +1,823 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "build/build_config.h"  // NOLINT
+#include <yact.h>
+#include "base/string_number_conversions.h"
+#include "base/string_piece.h"
+#include "base/string_util.h"
+#include "base/logging.h"
+#include "yact/string.h"
+#include "yact/environment.h"
+#include "yact/number.h"
+#include "yact/response_file.h"
+#include "yact/switch_index.h"
+#if defined(OS_WIN)
+#include "yact/registry.h"
+#endif  // defined(OS_WIN)
+
+namespace yact {
+
+// This helper class defines additional private functions and implementation
+// that we don't want to declare in yact.h
+class CompiledSwitchSet::Internal {
+ public:
+  static const Switch * GetSwitch(const CompiledSwitchSet * this_,
+    const base::StringPiece & name, bool * ambiguous);
+  static bool SetValueWithArgument(ParseResult * result,
+    const Switch & switch_, const base::StringPiece & value);
+  static bool SetValueWithoutArgument(const CompiledSwitchSet * this_,
+    ParseResult * result, const Switch & switch_);
+  static bool CountSwitch(const CompiledSwitchSet * this_,
+    ParseResult * result, const Switch & switch_);
+  static void SetDefaults(const CompiledSwitchSet * this_,
+    ParseResult * result);
+#if defined(OS_WIN)
+  static bool ParseFromRegistry(const CompiledSwitchSet * this_,
+    ParseResult * result, RegistryKey * key);
+#endif  // defined(OS_WIN)
+};
+
+CompiledSwitchSet::CompiledSwitchSet(const SwitchSet & switch_set)
+  : switch_set_(switch_set),
+    index_(NULL),
+    enable_parse_environment_(true),
+    enable_completion_(false),
+    enable_response_files_(false) {
+  index_ = new SwitchIndex(SwitchIndex::GlobalSwitches(switch_set_));
+}
+
+CompiledSwitchSet::CompiledSwitchSet(const ArgumentParser & parser)
+  : switch_set_(parser.switch_set()),
+    index_(NULL),
+    enable_parse_environment_(parser.enable_parse_environment_),
+    enable_completion_(parser.enable_completion_),
+    enable_response_files_(parser.enable_response_files_),
+    environment_prefix_(parser.environment_prefix_),
+    registry_prefix_(parser.registry_prefix_) {
+  index_ = new SwitchIndex(SwitchIndex::GlobalSwitches(switch_set_));
+}
+
+CompiledSwitchSet::CompiledSwitchSet(const SwitchSpec * specs, size_t count)
+  : index_(NULL),
+    enable_parse_environment_(true),
+    enable_completion_(false),
+    enable_response_files_(false) {
+  Init(specs, count);
+}
+
+void CompiledSwitchSet::Init(const SwitchSpec * specs, size_t count) {
+  DCHECK(!index_);
+  for (size_t i = 0; i < count; ++i) {
+    const SwitchSpec & spec = specs[i];
+    DCHECK(spec.name) << "SwitchSpec " << i << " has no name";
+    Switch switch_;
+    switch_.name(spec.name).short_flag(spec.short_flag).action(spec.action)
+      .type(spec.type);
+    if (spec.default_value) {
+      Value default_value(spec.default_value);
+      if (spec.type != Value::kTypeAuto) {
+        default_value = Value(&switch_);
+        bool ok = ParseValue(spec.default_value, &default_value);
+        DCHECK(ok) << "SwitchSpec " << i << " has an invalid default";
+      }
+      switch_.default_(default_value);
+    }
+    if (spec.help) {
+      switch_.help(spec.help);
+    }
+    switch_set_.insert(switch_);
+  }
+  index_ = new SwitchIndex(SwitchIndex::GlobalSwitches(switch_set_), specs,
+    count);
+}
+
+CompiledSwitchSet::~CompiledSwitchSet() {
+  delete index_;
+}
+
+const SwitchSet & CompiledSwitchSet::switch_set() const {
+  return switch_set_;
+}
+
+// static
+const Switch * CompiledSwitchSet::Internal::GetSwitch(
+    const CompiledSwitchSet * this_, const base::StringPiece & name,
+    bool * ambiguous) {
+  const SwitchIndex * switch_index = this_->index_;
+  *ambiguous = false;
+  if (const Switch * switch_ = switch_index->Find(name)) {
+    return switch_;
+  }
+
+  // According to http://go.kndr.org/uobty, "Users can abbreviate the option
+  // names as long as the abbreviations are unique."
+  const Switch * switch_ = NULL;
+  switch (switch_index->trie().Match(name, &switch_)) {
+    case SwitchTrie::kMatch:
+      return switch_;
+    case SwitchTrie::kAmbiguous:
+      *ambiguous = true;
+      return NULL;
+    case SwitchTrie::kNoMatch:
+      return NULL;
+  }
+  NOTREACHED();
+  return NULL;
+}
+
+void CompiledSwitchSet::Complete(const StringType & prefix,
+    std::vector<StringType> * completions) const {
+  StringType name = prefix;
+  if (StartsWithASCII(name, "--", true)) {
+    name.erase(0, 2);
+  }
+
+  std::vector<StringType> names;
+  index_->trie().Complete(name, &names);
+  for (size_t i = 0; i < names.size(); ++i) {
+    completions->push_back("--" + names[i]);
+  }
+
+  if (StartsWithASCII(name, "no-", true)) {
+    names.clear();
+    index_->trie().Complete(name.substr(3), &names);
+    for (size_t i = 0; i < names.size(); ++i) {
+      const Switch * switch_ = index_->Find(names[i]);
+      if (switch_->action() == Switch::kActionStoreTrue ||
+          switch_->action() == Switch::kActionStoreFalse) {
+        completions->push_back("--no-" + names[i]);
+      }
+    }
+  }
+}
+
+namespace {
+bool SwitchRequiresArgument(const Switch & switch_) {
+  switch (switch_.action()) {
+    case Switch::kActionStore:
+    case Switch::kActionAppend:
+      return true;
+    case Switch::kActionStoreTrue:
+    case Switch::kActionStoreFalse:
+    case Switch::kActionStoreConstant:
+    case Switch::kActionCount:
+      return false;
+  }
+  NOTREACHED();
+  return false;
+}
+
+bool SwitchAcceptsArgument(const Switch & switch_) {
+  switch (switch_.action()) {
+    case Switch::kActionStore:
+    case Switch::kActionAppend:
+    case Switch::kActionStoreTrue:
+    case Switch::kActionStoreFalse:
+    case Switch::kActionCount:
+      return true;
+    case Switch::kActionStoreConstant:
+      return false;
+  }
+  NOTREACHED();
+  return false;
+}
+
+bool IsDuplicateSwitchAllowed(const Switch & switch_) {
+  switch (switch_.action()) {
+    case Switch::kActionStore:
+    case Switch::kActionStoreTrue:
+    case Switch::kActionStoreFalse:
+    case Switch::kActionStoreConstant:
+      return false;
+    case Switch::kActionAppend:
+    case Switch::kActionCount:
+      return true;
+  }
+  NOTREACHED();
+  return false;
+}
+
+// returns true if `arg` is a switch, like:
+//    "--foo=bar" -> true
+//    "-Fbar"     -> true
+//    "bar"       -> false
+//    "-"         -> true (special case)
+bool IsSwitch(const base::StringPiece & arg) {
+  if (arg.size() == 1 && arg[0] == '-') {
+    return false;
+  }
+  return !arg.empty() && arg[0] == '-';
+}
+
+// Produces the arguments of a command line one at a time.  If response files
+// are enabled, an argument of the form "@file" is replaced by the arguments
+// read from `file`, which may itself refer to further response files.
+//
+// Arguments are read from a copy of argv in `storage`, and Keep() makes an
+// argument last as long as the storage, so that free arguments need not be
+// copied one by one.
+class ArgumentReader {
+ public:
+  ArgumentReader(int argc, const CharType ** argv, int arg_index,
+      bool expand_response_files, ArgumentStorage * storage,
+      StringType * error)
+    : argc_(argc),
+      arg_index_(arg_index),
+      argv_(storage->CopyArgv(argc - arg_index, argv + arg_index)),
+      expand_response_files_(expand_response_files),
+      storage_(storage),
+      error_(error),
+      last_file_(NULL) {
+  }
+
+  ~ArgumentReader() {
+    for (size_t i = 0; i < response_files_.size(); ++i) {
+      if (kept_[i]) {
+        storage_->Keep(response_files_[i]);
+      } else {
+        delete response_files_[i];
+      }
+    }
+    ReleaseExhausted();
+  }
+
+  // Stores the next argument in `arg`.  Returns false when there are no more
+  // arguments, or if a response file cannot be read, in which case `error`
+  // is set.  `arg` remains valid until the second following call, unless it
+  // is passed to Keep().
+  bool Next(base::StringPiece * arg) {
+    // The argument returned by the previous call may point into a file which
+    // ran out during that call, so files are only unmapped one call later.
+    ReleaseExhausted();
+    for (;;) {
+      if (!NextUnexpanded(arg)) {
+        return false;
+      }
+      if (!expand_response_files_ || arg->size() < 2 || (*arg)[0] != '@') {
+        return true;
+      }
+      if (response_files_.size() == kMaxResponseFileDepth) {
+        *error_ = "response files are nested too deeply";
+        return false;
+      }
+      ResponseFile * response_file = new ResponseFile;
+      response_files_.push_back(response_file);
+      kept_.push_back(false);
+      if (!response_file->Open(arg->substr(1).as_string())) {
+        *error_ = response_file->error();
+        return false;
+      }
+    }
+  }
+
+  // Returns `arg`, the result of the last call to Next(), in a form which
+  // remains valid for as long as the storage.  Arguments from argv, and those
+  // read in place from a response file, are returned as they are, and the
+  // file is kept mapped.  Others are copied.
+  base::StringPiece Keep(const base::StringPiece & arg) {
+    if (!last_file_) {
+      return arg;
+    }
+    if (!last_file_->Contains(arg)) {
+      return storage_->Copy(arg);
+    }
+    if (!response_files_.empty() && response_files_.back() == last_file_) {
+      kept_.back() = true;
+    } else {
+      // The file ran out while the argument was read, and is waiting in
+      // exhausted_ to be closed
+      for (size_t i = 0; i < exhausted_.size(); ++i) {
+        if (exhausted_[i] == last_file_) {
+          storage_->Keep(last_file_);
+          exhausted_.erase(exhausted_.begin() + i);
+          break;
+        }
+      }
+    }
+    return arg;
+  }
+
+ private:
+  enum { kMaxResponseFileDepth = 32 };
+
+  bool NextUnexpanded(base::StringPiece * arg) {
+    while (!response_files_.empty()) {
+      ResponseFile * response_file = response_files_.back();
+      if (response_file->Next(arg)) {
+        last_file_ = response_file;
+        return true;
+      }
+      if (!response_file->error().empty()) {
+        *error_ = response_file->error();
+        return false;
+      }
+      if (kept_.back()) {
+        storage_->Keep(response_file);
+      } else {
+        exhausted_.push_back(response_file);
+      }
+      response_files_.pop_back();
+      kept_.pop_back();
+    }
+    last_file_ = NULL;
+    if (arg_index_ < argc_) {
+      size_t size = std::char_traits<CharType>::length(argv_);
+      arg->set(argv_, size);
+      argv_ += size + 1;
+      ++arg_index_;
+      return true;
+    }
+    return false;
+  }
+
+  void ReleaseExhausted() {
+    for (size_t i = 0; i < exhausted_.size(); ++i) {
+      delete exhausted_[i];
+    }
+    exhausted_.clear();
+  }
+
+  int argc_;
+  int arg_index_;
+  const CharType * argv_;
+  bool expand_response_files_;
+  ArgumentStorage * storage_;
+  StringType * error_;
+  std::vector<ResponseFile *> response_files_;
+  // Whether an argument was kept from each of response_files_
+  std::vector<bool> kept_;
+  std::vector<ResponseFile *> exhausted_;
+  ResponseFile * last_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArgumentReader);
+};
+
+}  // anonymous namespace
+
+// static
+bool CompiledSwitchSet::Internal::SetValueWithArgument(ParseResult * result,
+    const Switch & switch_, const base::StringPiece & value_str) {
+  StringType & error_ = result->error_;
+  Value value(&switch_);
+  switch (value.type()) {
+    case Value::kTypeBool:
+      {
+        DCHECK(switch_.action() == Switch::kActionStoreTrue ||
+          switch_.action() == Switch::kActionStoreFalse);
+        bool value_bool;
+        if (!StringToBool(value_str, &value_bool)) {
+          error_ = StringPrintf("Cannot convert '%s' to a boolean",
+            value_str.as_string().c_str());
+          return false;
+        }
+        if (switch_.action() == Switch::kActionStoreTrue) {
+          value.set(value_bool);
+        } else {
+          value.set(!value_bool);
+        }
+        break;
+      }
+      break;
+    default:
+      if (!ParseValue(value_str, &value)) {
+        error_ = StringPrintf("Cannot convert '%s' to %s",
+          value_str.as_string().c_str(), DescribeType(value.type()));
+        return false;
+      }
+      break;
+  }
+  if (switch_.validator()) {
+    if (!switch_.validator()->Validate(value)) {
+      error_ = StringPrintf("Invalid value for %s: %s", switch_.dest().c_str(),
+        value_str.as_string().c_str());
+      return false;
+    }
+  }
+
+  if (switch_.action() == Switch::kActionAppend) {
+    result->values_.AddRepeatedValue(switch_.dest(), value);
+  } else {
+    result->values_.SetValue(switch_.dest(), value);
+  }
+  return true;
+}
+
+// static
+bool CompiledSwitchSet::Internal::SetValueWithoutArgument(
+    const CompiledSwitchSet * this_, ParseResult * result,
+    const Switch & switch_) {
+  StringType & error_ = result->error_;
+  Value value(&switch_);
+  switch (switch_.action()) {
+    case Switch::kActionStoreTrue:
+      value.set(true);
+      break;
+    case Switch::kActionStoreFalse:
+      value.set(false);
+      break;
+    case Switch::kActionStoreConstant:
+      value.set(switch_.constant());
+      break;
+    case Switch::kActionCount:
+      // The count is kept in tallies_ and only stored in values_ once the
+      // command line has been read.
+      value.set(++result->tallies_[this_->index_->Ordinal(&switch_)]);
+      break;
+    default:
+      NOTREACHED();
+      return false;
+  }
+  if (switch_.validator()) {
+    if (!switch_.validator()->Validate(value)) {
+      error_ = StringPrintf("Invalid value for %s", switch_.dest().c_str());
+      return false;
+    }
+  }
+  if (switch_.action() != Switch::kActionCount) {
+    result->values_.SetValue(switch_.dest(), value);
+  }
+  return true;
+}
+
+// Records an occurrence of `switch_` on the command line.  Returns false if
+// the switch may not be repeated and has already been seen.  Note that
+// providing a default, reading from the environment or registry are all
+// allowed, while providing the same option multiple times on the command
+// line is forbidden.
+// static
+bool CompiledSwitchSet::Internal::CountSwitch(const CompiledSwitchSet * this_,
+    ParseResult * result, const Switch & switch_) {
+  int & count = result->counts_[this_->index_->Ordinal(&switch_)];
+  ++count;
+  return count == 1 || IsDuplicateSwitchAllowed(switch_);
+}
+
+bool CompiledSwitchSet::Parse(const std::vector<StringType> & argv,
+    ParseResult * result) const {
+  std::vector<const CharType *> args;
+  args.reserve(argv.size());
+  for (size_t i = 0; i < argv.size(); ++i) {
+    args.push_back(argv[i].c_str());
+  }
+  return Parse(static_cast<int>(args.size()), args.empty() ? NULL : &args[0],
+    result);
+}
+
+bool CompiledSwitchSet::Parse(int argc, const CharType ** argv,
+    ParseResult * result) const {
+  // 1. Parse from registry
+  // 2. Parse from environment
+  // 3. Parse command line
+  // 4. Set defaults for any missing values
+  //
+  // The command line is examined through StringPieces that point into `argv`
+  // (or into the mapping of a response file) so that nothing is copied until
+  // a value or free argument is stored.
+
+  result->Clear();
+  if (!result->storage_) {
+    result->storage_ = new ArgumentStorage;
+  }
+  StringType & error_ = result->error_;
+  ValueGroup & values_ = result->values_;
+  const SwitchSet::List & switches = SwitchIndex::GlobalSwitches(switch_set_);
+
+  // Per-switch state is kept in arrays indexed by SwitchIndex::Ordinal().
+  // Clear() keeps their storage, so parsing again with the same result does
+  // not allocate.
+  result->counts_.assign(switches.size(), 0);
+  result->tallies_.assign(switches.size(), 0);
+
+  int arg_index = 0;
+  if (argc > 0) {
+    result->program_ = argv[0];
+  }
+  ++arg_index;
+
+  if (enable_completion_ && arg_index < argc &&
+      base::StringPiece(argv[arg_index]) == "--complete") {
+    Complete(arg_index + 1 < argc ? argv[arg_index + 1] : kEmptyString,
+      &result->completions_);
+    // The rest of the command line is not parsed, but every switch still has
+    // its default so that the result may be read by index.
+    Internal::SetDefaults(this, result);
+    return true;
+  }
+
+  ArgumentReader reader(argc, argv, arg_index, enable_response_files_,
+    result->storage_, &error_);
+  base::StringPiece arg;
+  while (reader.Next(&arg)) {
+    // If the argument starts with anything other than '-' then it is a free
+    // argument.  Except for the special case of '-' which is also a free
+    // argument
+    if (!IsSwitch(arg)) {
+      arg = reader.Keep(arg);
+      result->argument_views_.push_back(TextView(arg.data(), arg.size()));
+      continue;
+    }
+
+    // If the argument is '--' then all remaining arguments are free arguments
+    if (arg == "--") {
+      while (reader.Next(&arg)) {
+        arg = reader.Keep(arg);
+        result->argument_views_.push_back(TextView(arg.data(), arg.size()));
+      }
+      break;
+    }
+
+    // If the argument starts with a single dash, then it is a short form, e.g
+    // tar -xvzf foo
+    if (arg[0] == '-' && arg[1] != '-') {
+      for (size_t offset = 1; offset < arg.size(); ++offset) {
+        const Switch * switch_ = index_->Find(arg[offset]);
+        if (!switch_) {
+          error_= StringPrintf("invalid switch '-%c'", arg[offset]);
+          return false;
+        }
+        if (!Internal::CountSwitch(this, result, *switch_)) {
+          error_ = StringPrintf("duplicate switch '-%c'", arg[offset]);
+          return false;
+        }
+        if (!SwitchRequiresArgument(*switch_)) {
+          if (!Internal::SetValueWithoutArgument(this, result, *switch_)) {
+            DCHECK(!error_.empty());
+            return false;
+          }
+        } else {
+          base::StringPiece argument;
+          if (offset != arg.size() - 1) {
+            // Assume "-xvzfbar", if -f expects an argument, then the argument
+            // is bar.  Annoying.
+            argument = arg.substr(offset + 1);
+            offset = arg.size();
+          } else {
+            // Assume ["-vxzf", "bar"], if -f expects an argument, then the
+            // argument is 'bar'.  Less annoying.
+            if (!reader.Next(&argument) || IsSwitch(argument)) {
+              if (error_.empty()) {
+                error_ = StringPrintf("switch -%c requires an argument",
+                  arg[offset]);
+              }
+              return false;
+            }
+          }
+          if (!Internal::SetValueWithArgument(result, *switch_, argument)) {
+            DCHECK(!error_.empty());
+            return false;
+          }
+        }
+      }
+      continue;
+    }
+
+    // If we get here the argument must start with "--"
+    {
+      DCHECK(arg[0] == '-' && arg[1] == '-');
+      base::StringPiece argument;
+
+      // Split off the argument if present
+      size_t equals_sign_index = arg.find('=');
+      if (equals_sign_index != base::StringPiece::npos) {
+        argument = arg.substr(equals_sign_index + 1);
+        arg = arg.substr(2, equals_sign_index - 2);
+      } else {
+        arg.remove_prefix(2);
+      }
+
+      bool ambiguous = false;
+      const Switch * switch_ = Internal::GetSwitch(this, arg, &ambiguous);
+      if (!switch_ && !ambiguous) {
+        // perhaps the user provided e.g. --no-???
+        if (arg.starts_with("no-") && argument.empty()) {
+          arg.remove_prefix(3);
+          argument = "no";
+          switch_ = Internal::GetSwitch(this, arg, &ambiguous);
+        }
+      }
+
+      if (ambiguous) {
+        std::vector<StringType> candidates;
+        Complete(arg.as_string(), &candidates);
+        error_ = StringPrintf("ambiguous switch '--%s' could be %s",
+          arg.as_string().c_str(), JoinString(candidates, ' ').c_str());
+        return false;
+      }
+      if (!switch_) {
+        error_ = StringPrintf("invalid switch '--%s'", arg.as_string().c_str());
+        return false;
+      }
+      if (!Internal::CountSwitch(this, result, *switch_)) {
+        error_ = StringPrintf("duplicate switch '--%s'",
+          arg.as_string().c_str());
+        return false;
+      }
+      if (!argument.empty()) {
+        if (SwitchAcceptsArgument(*switch_)) {
+          if (!Internal::SetValueWithArgument(result, *switch_, argument)) {
+            DCHECK(!error_.empty());
+            return false;
+          }
+          if (switch_->action() == Switch::kActionCount) {
+            // Later occurrences count up from the explicit value
+            result->tallies_[index_->Ordinal(switch_)] =
+              values_.value(switch_->dest()).AsInt();
+          }
+        } else {
+          error_ = StringPrintf("unexpected argument for switch '--%s'",
+            arg.as_string().c_str());
+          return false;
+        }
+      } else if (SwitchRequiresArgument(*switch_)) {
+        // The switch
+        if (!reader.Next(&argument) || IsSwitch(argument)) {
+          if (error_.empty()) {
+            error_ = StringPrintf("switch --%s requires an argument",
+              arg.as_string().c_str());
+          }
+          return false;
+        }
+        if (!Internal::SetValueWithArgument(result, *switch_, argument)) {
+          DCHECK(!error_.empty());
+          return false;
+        }
+      } else {
+        if (!Internal::SetValueWithoutArgument(this, result, *switch_)) {
+          DCHECK(!error_.empty());
+          return false;
+        }
+      }
+      continue;
+    }
+
+    NOTREACHED();
+  }
+  if (!error_.empty()) {
+    return false;
+  }
+
+  // Store the final value of each counter which appeared
+  for (size_t i = 0; i < switches.size(); ++i) {
+    if (switches[i].action() == Switch::kActionCount &&
+        result->counts_[i] != 0) {
+      Value value(&switches[i]);
+      value.set(result->tallies_[i]);
+      values_.SetValue(switches[i].dest(), value);
+    }
+  }
+
+  // Fill in from the registry
+#if defined(OS_WIN)
+  if (!registry_prefix_.empty()) {
+    RegistryKey machine_key(HKEY_LOCAL_MACHINE, registry_prefix_);
+    if (machine_key.Valid()) {
+      if (!Internal::ParseFromRegistry(this, result, &machine_key)) {
+        return false;
+      }
+    }
+
+    RegistryKey user_key(HKEY_CURRENT_USER, registry_prefix_);
+    if (user_key.Valid()) {
+      if (!Internal::ParseFromRegistry(this, result, &user_key)) {
+        return false;
+      }
+    }
+  }
+#endif  // defined(OS_WIN)
+
+  // Fill in environment
+  if (enable_parse_environment_) {
+    // Walking the environment once up front makes each lookup O(1), rather
+    // than a getenv() scan of the whole environment per switch.
+    EnvironmentSnapshot env(environment_prefix_);
+    for (SwitchSet::List::const_iterator switch_ = switches.begin();
+        switch_ != switches.end() && env.size(); ++switch_) {
+      if (switch_->environment_variable().empty()) {
+        continue;
+      }
+
+      base::StringPiece value_str;
+      if (!env.Get(switch_->environment_variable(), &value_str)) {
+        continue;
+      }
+      if (values_.has_value(switch_->dest())) {
+        continue;
+      }
+
+      // special case: An `append` argument is a comma separated list, but only
+      // in the environment
+      if (switch_->action() == Switch::kActionAppend) {
+        std::vector<StringType> values;
+        SplitString(value_str.as_string(), ',', &values);
+        for (size_t i = 0; i < values.size(); ++i) {
+          if (!Internal::SetValueWithArgument(result, *switch_, values[i])) {
+            DCHECK(!error_.empty());
+            return false;
+          }
+        }
+      } else {
+        if (!Internal::SetValueWithArgument(result, *switch_, value_str)) {
+          DCHECK(!error_.empty());
+          return false;
+        }
+      }
+    }
+  }
+
+  Internal::SetDefaults(this, result);
+  return true;
+}
+
+// Fills in defaults for the switches which have no value, and remembers where
+// each switch's value ended up so that it can be read back by index.
+// static
+void CompiledSwitchSet::Internal::SetDefaults(const CompiledSwitchSet * this_,
+    ParseResult * result) {
+  ValueGroup & values_ = result->values_;
+  const SwitchSet::List & switches =
+    SwitchIndex::GlobalSwitches(this_->switch_set_);
+  result->slots_.reserve(switches.size());
+  for (SwitchSet::List::const_iterator switch_ = switches.begin();
+      switch_ != switches.end(); ++switch_) {
+    if (!values_.has_value(switch_->dest())) {
+      // special case: An `append` argument with null default is an empty list
+      if (switch_->action() == Switch::kActionAppend &&
+          switch_->default_() == Value()) {
+        values_.ClearValue(switch_->dest());
+      } else {
+        values_.SetValue(switch_->dest(), switch_->default_());
+      }
+    }
+    result->slots_.push_back(&values_.repeated_value(switch_->dest()));
+  }
+}
+
+#if defined(OS_WIN)
+
+// static
+bool CompiledSwitchSet::Internal::ParseFromRegistry(
+    const CompiledSwitchSet * this_, ParseResult * result, RegistryKey * key) {
+  if (!key->Valid()) {
+    return false;
+  }
+
+  for (SwitchSet::List::const_iterator switch_ =
+      SwitchIndex::GlobalSwitches(this_->switch_set_).begin();
+      switch_ != SwitchIndex::GlobalSwitches(this_->switch_set_).end();
+      ++switch_) {
+    if (result->values_.has_value(switch_->dest())) {
+      continue;
+    }
+
+    for (size_t i = 0; i < switch_->names().size(); ++i) {
+      StringType name = switch_->names()[i];
+      DWORD type;
+      if (!key->ValueType(name, &type)) {
+        continue;
+      }
+
+      if (type == REG_MULTI_SZ) {
+        std::vector<StringType> array_value;
+        bool ok = key->ReadValueArray(name, &array_value);
+        DCHECK(ok);
+        for (size_t i = 0; i < array_value.size(); ++i) {
+          Value value(&*switch_);
+          value.set(array_value[i]);
+          if (switch_->validator() && !switch_->validator()->Validate(value)) {
+            result->error_ = StringPrintf("Invalid value for %s in registry",
+              name.c_str());
+            return false;
+          }
+          result->values_.AddRepeatedValue(name, value);
+        }
+        continue;
+      }
+
+      Value value(&*switch_);
+      if (type == REG_SZ) {
+        std::string string_value;
+        bool ok = key->ReadValueString(name, &string_value);
+        DCHECK(ok);
+        value.set(string_value);
+      } else if (type == REG_DWORD) {
+        DWORD int_value;
+        bool ok = key->ReadValueDword(name, &int_value);
+        DCHECK(ok);
+        value.set(static_cast<int>(int_value));
+      }
+      if (switch_->validator()) {
+        if (!switch_->validator()->Validate(value)) {
+          result->error_ = StringPrintf("Invalid value for %s in registry",
+            name.c_str());
+          return false;
+        }
+      }
+      result->values_.SetValue(switch_->dest(), value);
+    }
+  }
+  return true;
+}
+#endif  // defined(OS_WIN)
+
+}  // namespace yact
@@ -0,0 +1,256 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/platform_thread.h"
+#include "base/string_number_conversions.h"
+
+namespace yact {
+
+class CompiledSwitchSetTest : public BaseTest {
+ public:
+  void SetUp() {
+    switch_set_.insert(Switch().name("foo").short_flag('f').store());
+    switch_set_.insert(Switch().name("bar"));
+    switch_set_.insert(Switch().name("bax").short_flag('B').count());
+    switch_set_.insert(Switch().name("qux").append());
+  }
+
+  SwitchSet switch_set_;
+};
+
+TEST_F(CompiledSwitchSetTest, Basics) {
+  CompiledSwitchSet compiled(switch_set_);
+  EXPECT_EQ(4, compiled.switch_set().switches("").size());
+
+  const char * argv[] = {"test.exe", "--foo=bar", "-BB", "freearg"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  EXPECT_EQ("test.exe", result.program());
+  EXPECT_EQ(Value("bar"), result.value("foo"));
+  EXPECT_EQ(Value(2), result.value("bax"));
+  EXPECT_EQ(Value(false), result.value("bar"));
+  ASSERT_EQ(1, result.arguments().size());
+  EXPECT_EQ("freearg", result.arguments()[0]);
+
+  // Parsing again replaces the previous result
+  const char * argv2[] = {"other.exe", "--bar"};
+  ASSERT_TRUE(compiled.Parse(arraysize(argv2), argv2, &result));
+  EXPECT_EQ("other.exe", result.program());
+  EXPECT_EQ(Value(true), result.value("bar"));
+  EXPECT_EQ(Value(0), result.value("bax"));
+  EXPECT_EQ(0, result.arguments().size());
+
+  const char * argv3[] = {"test.exe", "--nope"};
+  EXPECT_FALSE(compiled.Parse(arraysize(argv3), argv3, &result));
+  EXPECT_EQ("invalid switch '--nope'", result.error());
+}
+
+TEST_F(CompiledSwitchSetTest, CompleteSetsDefaults) {
+  ArgumentParser parser;
+  parser.switch_set(switch_set_).enable_completion(true);
+  const CompiledSwitchSet & compiled = parser.Compile();
+
+  const char * argv[] = {"test.exe", "--complete", "--b", "--foo=x"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  ASSERT_EQ(2, result.completions().size());
+
+  // The switches hold their defaults, as if none had been given
+  const char * argv2[] = {"test.exe"};
+  ParseResult defaults;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv2), argv2, &defaults));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(defaults.value(i), result.value(i)) << i;
+    EXPECT_EQ(0, result.count(i)) << i;
+  }
+  EXPECT_FALSE(result.bool_value(1));
+  EXPECT_EQ(0, result.int_value(2));
+  EXPECT_EQ(0, result.repeated_value("qux").size());
+  EXPECT_EQ(0, result.count(3));
+}
+
+TEST_F(CompiledSwitchSetTest, ArgumentParserDoesNotChangeProgram) {
+  ArgumentParser parser;
+  parser.switch_set(switch_set_);
+  const char * argv[] = {"test.exe"};
+  ASSERT_TRUE(parser.Parse(arraysize(argv), argv));
+  EXPECT_EQ("test.exe", parser.program());
+  const char * argv2[] = {"other.exe"};
+  ASSERT_TRUE(parser.Parse(arraysize(argv2), argv2));
+  EXPECT_EQ("other.exe", parser.program());
+}
+
+namespace {
+
+enum { kVerbose, kOutput, kForce, kSwitchCount };
+const SwitchSpec kSwitches[kSwitchCount] = {
+  { "verbose", 'v', Switch::kActionCount, NULL, "Be chatty",
+    Value::kTypeAuto },
+  { "output", 'o', Switch::kActionStore, "a.out", "Output file",
+    Value::kTypeAuto },
+  { "force", 0, Switch::kActionStoreTrue, NULL, NULL, Value::kTypeAuto },
+};
+
+}  // anonymous namespace
+
+TEST_F(CompiledSwitchSetTest, StaticTable) {
+  const CompiledSwitchSet compiled(kSwitches);
+  ASSERT_EQ(3, compiled.switch_set().switches("").size());
+  EXPECT_EQ("Output file", compiled.switch_set().switches("")[1].help());
+
+  const char * argv[] = {"test.exe", "-vv", "--force", "free"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  EXPECT_EQ(2, result.int_value(kVerbose));
+  EXPECT_EQ("a.out", result.string_value(kOutput));
+  EXPECT_TRUE(result.bool_value(kForce));
+  EXPECT_EQ(Value(2), result.value("verbose"));
+
+  const char * argv2[] = {"test.exe", "-o", "b.out"};
+  ASSERT_TRUE(compiled.Parse(arraysize(argv2), argv2, &result));
+  EXPECT_EQ(0, result.int_value(kVerbose));
+  EXPECT_EQ("b.out", result.string_value(kOutput));
+  EXPECT_FALSE(result.bool_value(kForce));
+}
+
+namespace {
+
+enum { kTimeout, kCacheSize, kRate, kLimit, kTypedSwitchCount };
+const SwitchSpec kTypedSwitches[kTypedSwitchCount] = {
+  { "timeout", 't', Switch::kActionStore, "250ms", NULL, Value::kTypeDuration },
+  { "cache-size", 0, Switch::kActionStore, "64MiB", NULL,
+    Value::kTypeByteSize },
+  { "rate", 0, Switch::kActionStore, "1.5e6", NULL, Value::kTypeDouble },
+  { "limit", 0, Switch::kActionStore, "0", NULL, Value::kTypeInt64 },
+};
+
+}  // anonymous namespace
+
+TEST_F(CompiledSwitchSetTest, TypedValues) {
+  const CompiledSwitchSet compiled(kTypedSwitches);
+  const char * argv[] = {"test.exe"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  EXPECT_EQ(250000, result.duration_value(kTimeout));
+  EXPECT_EQ(64 << 20, result.byte_size_value(kCacheSize));
+  EXPECT_EQ(1.5e6, result.double_value(kRate));
+  EXPECT_EQ(0, result.int64_value(kLimit));
+
+  const char * argv2[] = {"test.exe", "-t", "1h30m", "--cache-size=1G",
+    "--rate=-2.5", "--limit=10000000000"};
+  ASSERT_TRUE(compiled.Parse(arraysize(argv2), argv2, &result));
+  EXPECT_EQ(Value::kTypeDuration, result.value(kTimeout).type());
+  EXPECT_EQ(GG_INT64_C(5400000000), result.duration_value(kTimeout));
+  EXPECT_EQ(GG_INT64_C(1) << 30, result.byte_size_value(kCacheSize));
+  EXPECT_EQ(-2.5, result.double_value(kRate));
+  EXPECT_EQ(GG_INT64_C(10000000000), result.int64_value(kLimit));
+
+  const char * argv3[] = {"test.exe", "--timeout=soon"};
+  EXPECT_FALSE(compiled.Parse(arraysize(argv3), argv3, &result));
+  EXPECT_EQ("Cannot convert 'soon' to a duration", result.error());
+  const char * argv4[] = {"test.exe", "--cache-size=lots"};
+  EXPECT_FALSE(compiled.Parse(arraysize(argv4), argv4, &result));
+  EXPECT_EQ("Cannot convert 'lots' to a byte size", result.error());
+}
+
+TEST_F(CompiledSwitchSetTest, ValueByIndex) {
+  const CompiledSwitchSet compiled(switch_set_);
+  const char * argv[] = {"test.exe", "--foo=x", "--qux=a", "--qux=b"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  EXPECT_EQ(Value("x"), result.value(0));
+  EXPECT_FALSE(result.bool_value(1));
+  EXPECT_EQ(0, result.int_value(2));
+  EXPECT_EQ(Value("a"), result.value(3));
+
+  // A copy reads by index from its own values
+  ParseResult copy(result);
+  result.Clear();
+  EXPECT_EQ(Value("x"), copy.value(0));
+  EXPECT_EQ(2, copy.repeated_value("qux").size());
+  EXPECT_EQ(Value("a"), copy.value(3));
+}
+
+TEST_F(CompiledSwitchSetTest, Counts) {
+  const CompiledSwitchSet compiled(switch_set_);
+  const char * argv[] = {"test.exe", "-BB", "--qux=a", "--bax", "--qux=b",
+    "--foo", "x"};
+  ParseResult result;
+  ASSERT_TRUE(compiled.Parse(arraysize(argv), argv, &result));
+  EXPECT_EQ(1, result.count(0));
+  EXPECT_EQ(0, result.count(1));
+  EXPECT_EQ(3, result.count(2));
+  EXPECT_EQ(2, result.count(3));
+  EXPECT_EQ(Value(3), result.value("bax"));
+
+  // An explicit value for a counter is counted up from
+  const char * argv2[] = {"test.exe", "--bax=5", "-B"};
+  ASSERT_TRUE(compiled.Parse(arraysize(argv2), argv2, &result));
+  EXPECT_EQ(2, result.count(2));
+  EXPECT_EQ(6, result.int_value(2));
+
+  const char * argv3[] = {"test.exe", "--bar", "--bar"};
+  EXPECT_FALSE(compiled.Parse(arraysize(argv3), argv3, &result));
+  EXPECT_EQ("duplicate switch '--bar'", result.error());
+
+  const char * argv4[] = {"test.exe", "-f", "x", "--foo=y"};
+  EXPECT_FALSE(compiled.Parse(arraysize(argv4), argv4, &result));
+  EXPECT_EQ("duplicate switch '--foo'", result.error());
+}
+
+namespace {
+
+class ParseThread : public PlatformThread::Delegate {
+ public:
+  ParseThread() : compiled_(NULL), id_(0), failures_(0) {}
+
+  void Init(const CompiledSwitchSet * compiled, int id) {
+    compiled_ = compiled;
+    id_ = id;
+  }
+
+  virtual void ThreadMain() {
+    std::string value = base::IntToString(id_);
+    for (int i = 0; i < 1000; ++i) {
+      const char * argv[] = {"test.exe", "--foo", value.c_str(), "-B",
+        "--qux=a", "--qux=b", value.c_str()};
+      ParseResult result;
+      if (!compiled_->Parse(arraysize(argv), argv, &result) ||
+          !(result.value("foo") == Value(value)) ||
+          !(result.value("bax") == Value(1)) ||
+          result.repeated_value("qux").size() != 2 ||
+          result.arguments().size() != 1) {
+        ++failures_;
+      }
+    }
+  }
+
+  int failures() const { return failures_; }
+
+ private:
+  const CompiledSwitchSet * compiled_;
+  int id_;
+  int failures_;
+};
+
+}  // anonymous namespace
+
+TEST_F(CompiledSwitchSetTest, ConcurrentParse) {
+  const CompiledSwitchSet compiled(switch_set_);
+  const int kThreadCount = 8;
+  ParseThread threads[kThreadCount];
+  PlatformThreadHandle handles[kThreadCount];
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads[i].Init(&compiled, i);
+    ASSERT_TRUE(PlatformThread::Create(0, &threads[i], &handles[i]));
+  }
+  for (int i = 0; i < kThreadCount; ++i) {
+    PlatformThread::Join(handles[i]);
+    EXPECT_EQ(0, threads[i].failures());
+  }
+}
+
+}  // namespace yact
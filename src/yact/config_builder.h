@@ -0,0 +1,97 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_CONFIG_BUILDER_H_
+#define YACT_CONFIG_BUILDER_H_
+
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+#include "base/scoped_ptr.h"
+#include "base/string_piece.h"
+
+namespace yact {
+
+// Resolves the keys of a configuration file to the switches of a SwitchSet
+// with a hash lookup in the section of the key and one in __fallback__,
+// rather than a scan of the whole SwitchSet per key.  It is built once per
+// parse and holds pointers into the SwitchSet, which must outlive it and not
+// change.  Lookups do not modify it, so the threads which parse the parts of
+// a file share one.
+class ConfigSwitchIndex {
+ public:
+  // The switches of one section, by name
+  typedef base::hash_map<StringType, const Switch *> Group;
+
+  explicit ConfigSwitchIndex(const SwitchSet & switch_set);
+
+  // Returns the switches of `section`, or NULL if it has none
+  const Group * group(const StringType & section) const;
+
+  // Returns the switch for `key` in `group`, which is the result of group(),
+  // or else in __fallback__, or NULL if it has none
+  const Switch * Find(const Group * group, const StringType & key) const;
+
+ private:
+  base::hash_map<StringType, Group> groups_;
+  const Group * fallback_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConfigSwitchIndex);
+};
+
+// Stores `text` in `value` converted to the type() of `switch_`, or as text
+// which may be read as any type if `switch_` is NULL or has no type.  Returns
+// false if the text does not convert.
+bool ConvertConfigValue(const Switch * switch_, const base::StringPiece & text,
+    Value * value);
+
+// Stores the sections and keys passed to it in the values() of a parser, so
+// that a parser which streams its input implements Parse(filename) as
+// Parse(filename, &builder).  Keys before the first section go in values()
+// itself, and a key which appears more than once gets a repeated value.  A
+// key whose switch, in its section or in __fallback__, has a type() is
+// converted to that type as it is stored, and a value which does not convert
+// stops the parse with an error.  If the parser rejects unknown switches, so
+// does a key without a switch.
+class ConfigParser::Builder : public ConfigHandler {
+ public:
+  // Empties the values and error of `parser`, keeping its arena
+  explicit Builder(ConfigParser * parser);
+
+  // Stores into `values` and `error` instead, for part of a file which is
+  // parsed on its own, with the switches in `index`.  The keys before the
+  // first section header of the part go in `values` itself and belong to
+  // `section`, or to a section which is not known if it is NULL, in which
+  // case they are neither checked nor converted.
+  Builder(const ConfigSwitchIndex * index, bool reject_unknown_switches,
+      ValueGroup * values, StringType * error, const StringType * section);
+
+  virtual bool OnSection(const Text & name, int line);
+  virtual bool OnKeyValue(const Text & key, const Text & value, int line);
+
+  // The name of the last section header, or empty before the first
+  const StringType & section_name() const;
+
+ private:
+  // Built by the first constructor, which owns it
+  scoped_ptr<ConfigSwitchIndex> own_index_;
+  const ConfigSwitchIndex * index_;
+  bool reject_unknown_switches_;
+  ValueGroup * values_;
+  StringType * error_;
+  bool section_known_;
+
+  // The switches of the current section in index_
+  const ConfigSwitchIndex::Group * section_switches_;
+  ValueGroup * section_;
+  StringType section_name_;
+
+  // Reused for every key, so that only ever longer keys allocate
+  StringType key_;
+
+  DISALLOW_COPY_AND_ASSIGN(Builder);
+};
+
+}  // namespace yact
+
+#endif  // YACT_CONFIG_BUILDER_H_
@@ -1,3 +1,237 @@
 // Copyright (c) 2010 Ross Kinder. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+#include <yact.h>
+#include <sstream>
+#include "base/string_util.h"
+#include "yact/config_builder.h"
+#include "yact/number.h"
+#include "yact/string.h"
+
+namespace yact {
+
+namespace {
+
+// Passes the values of `group` and then its subgroups to `handler`, naming
+// nested subgroups by their path from the root.  Returns false if the
+// handler stops.
+bool Replay(const ValueGroup & group, const StringType & path,
+    ConfigHandler * handler) {
+  for (ValueGroup::ValueMap::const_iterator it = group.values().begin();
+      it != group.values().end(); ++it) {
+    ConfigHandler::Text key(it->first.data(), it->first.size());
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      std::ostringstream out;
+      out << it->second[i];
+      StringType text = out.str();
+      if (!handler->OnKeyValue(key, ConfigHandler::Text(text.data(),
+          text.size()), 0)) {
+        return false;
+      }
+    }
+  }
+  for (ValueGroup::ValueGroupMap::const_iterator it = group.groups().begin();
+      it != group.groups().end(); ++it) {
+    StringType name = path.empty() ? it->first : path + "." + it->first;
+    if (!handler->OnSection(ConfigHandler::Text(name.data(), name.size()), 0)
+        || !Replay(it->second, name, handler)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+ConfigHandler::~ConfigHandler() {
+}
+
+bool ConfigHandler::OnSection(const Text & name, int line) {
+  return true;
+}
+
+bool ConfigHandler::OnKeyValue(const Text & key, const Text & value,
+    int line) {
+  return true;
+}
+
+void ConfigHandler::OnError(const StringType & message, int line) {
+}
+
+ConfigSwitchIndex::ConfigSwitchIndex(const SwitchSet & switch_set)
+  : fallback_(NULL) {
+  const SwitchSet::GroupList & groups = switch_set.switches();
+  for (SwitchSet::GroupList::const_iterator it1 = groups.begin();
+      it1 != groups.end(); ++it1) {
+    Group & group = groups_[it1->first];
+    for (SwitchSet::List::const_iterator it2 = it1->second.begin();
+        it2 != it1->second.end(); ++it2) {
+      // The first switch with a name wins, as in SwitchSet::switch_()
+      group.insert(Group::value_type(it2->name(), &*it2));
+    }
+  }
+  fallback_ = group("__fallback__");
+}
+
+const ConfigSwitchIndex::Group * ConfigSwitchIndex::group(
+    const StringType & section) const {
+  base::hash_map<StringType, Group>::const_iterator it =
+    groups_.find(section);
+  return it == groups_.end() ? NULL : &it->second;
+}
+
+const Switch * ConfigSwitchIndex::Find(const Group * group,
+    const StringType & key) const {
+  if (group) {
+    Group::const_iterator it = group->find(key);
+    if (it != group->end()) {
+      return it->second;
+    }
+  }
+  if (fallback_ && fallback_ != group) {
+    Group::const_iterator it = fallback_->find(key);
+    if (it != fallback_->end()) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
+
+bool ConvertConfigValue(const Switch * switch_, const base::StringPiece & text,
+    Value * value) {
+  if (!switch_ || switch_->type() == Value::kTypeAuto) {
+    value->set(text.data(), text.size());
+    return true;
+  }
+  // Config files hold many values, so unlike Value(switch_) they do not keep
+  // the Switch
+  *value = EmptyValue(SwitchValueType(*switch_));
+  if (value->type() != Value::kTypeBool) {
+    return ParseValue(text, value);
+  }
+  bool bool_value;
+  if (!StringToBool(text, &bool_value)) {
+    return false;
+  }
+  value->set(bool_value);
+  return true;
+}
+
+ConfigParser::Builder::Builder(ConfigParser * parser)
+  : own_index_(new ConfigSwitchIndex(parser->switch_set_)),
+    index_(own_index_.get()),
+    reject_unknown_switches_(parser->reject_unknown_switches_),
+    values_(&parser->values_),
+    error_(&parser->error_),
+    section_known_(true),
+    section_switches_(index_->group(kEmptyString)),
+    section_(&parser->values_) {
+  error_->clear();
+  ValueGroup(kEmptyString, values_->arena()).swap(*values_);
+}
+
+ConfigParser::Builder::Builder(const ConfigSwitchIndex * index,
+    bool reject_unknown_switches, ValueGroup * values, StringType * error,
+    const StringType * section)
+  : index_(index),
+    reject_unknown_switches_(reject_unknown_switches),
+    values_(values),
+    error_(error),
+    section_known_(section != NULL),
+    section_switches_(section ? index->group(*section) : NULL),
+    section_(values),
+    section_name_(section ? *section : kEmptyString) {
+}
+
+bool ConfigParser::Builder::OnSection(const Text & name, int line) {
+  section_name_.assign(name.data(), name.size());
+  section_ = &values_->CreateGroup(section_name_);
+  section_known_ = true;
+  section_switches_ = index_->group(section_name_);
+  return true;
+}
+
+bool ConfigParser::Builder::OnKeyValue(const Text & key, const Text & value,
+    int line) {
+  key_.assign(key.data(), key.size());
+  const Switch * switch_ = section_known_ ?
+    index_->Find(section_switches_, key_) : NULL;
+  if (!switch_ && section_known_ && reject_unknown_switches_) {
+    *error_ = StringPrintf("Unknown switch %s.%s on line %d",
+      section_name_.c_str(), key_.c_str(), line);
+    return false;
+  }
+
+  // A typed value is converted once here rather than by every accessor call
+  Value typed_value;
+  base::StringPiece text(value.data(), value.size());
+  if (!ConvertConfigValue(switch_, text, &typed_value)) {
+    *error_ = StringPrintf("Cannot convert '%s' to %s for %s.%s on line %d",
+      text.as_string().c_str(), DescribeType(typed_value.type()),
+      section_name_.c_str(), key_.c_str(), line);
+    return false;
+  }
+  section_->AddRepeatedValue(key_, typed_value);
+  return true;
+}
+
+const StringType & ConfigParser::Builder::section_name() const {
+  return section_name_;
+}
+
+
+ConfigParser::ConfigParser()
+  : reject_unknown_switches_(false) {
+}
+
+ConfigParser::~ConfigParser() {
+}
+
+bool ConfigParser::Parse(const StringType & filename,
+    ConfigHandler * handler) {
+  if (!Parse(filename)) {
+    handler->OnError(error_, 0);
+    return false;
+  }
+  Replay(values_, kEmptyString, handler);
+  return true;
+}
+
+const StringType & ConfigParser::error() const {
+  return error_;
+}
+
+const ValueGroup & ConfigParser::values() const {
+  return values_;
+}
+
+ConfigParser & ConfigParser::switch_set(const SwitchSet & switch_set) {
+  switch_set_ = switch_set;
+  return *this;
+}
+
+const SwitchSet & ConfigParser::switch_set() const {
+  return switch_set_;
+}
+
+ConfigParser & ConfigParser::reject_unknown_switches(
+    bool reject_unknown_switches) {
+  reject_unknown_switches_ = reject_unknown_switches;
+  return *this;
+}
+
+bool ConfigParser::reject_unknown_switches() const {
+  return reject_unknown_switches_;
+}
+
+ConfigParser & ConfigParser::arena(Arena * arena) {
+  // Assigning would keep the current arena, so swap in a new group instead
+  ValueGroup(kEmptyString, arena).swap(values_);
+  return *this;
+}
+
+Arena * ConfigParser::arena() const {
+  return values_.arena();
+}
+
+}  // namespace yact
@@ -1,3 +1,104 @@
 // Copyright (c) 2010 Ross Kinder. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "yact/config_builder.h"
+
+namespace yact {
+
+class ConfigParserTest : public BaseTest {
+};
+
+namespace {
+
+// Records the name of the file it was asked to parse
+class FakeConfigParser : public ConfigParser {
+ public:
+  virtual bool Parse(const StringType & filename) {
+    values_.CreateGroup("file").SetValue("name", Value(filename));
+    return true;
+  }
+};
+
+// Records the events it receives as "[section]" and "key=value"
+class RecordingHandler : public ConfigHandler {
+ public:
+  virtual bool OnSection(const Text & name, int line) {
+    events += "[" + name.as_string() + "]";
+    return true;
+  }
+
+  virtual bool OnKeyValue(const Text & key, const Text & value, int line) {
+    events += key.as_string() + "=" + value.as_string() + ";";
+    return true;
+  }
+
+  std::string events;
+};
+
+}  // anonymous namespace
+
+TEST_F(ConfigParserTest, Arena) {
+  Arena arena;
+  FakeConfigParser parser;
+  EXPECT_EQ(NULL, parser.arena());
+  EXPECT_FALSE(parser.reject_unknown_switches());
+  ASSERT_TRUE(parser.Parse("first.ini"));
+  EXPECT_TRUE(parser.values().has_group("file"));
+
+  // Choosing an arena starts over
+  parser.arena(&arena);
+  EXPECT_EQ(&arena, parser.arena());
+  EXPECT_FALSE(parser.values().has_group("file"));
+  ASSERT_TRUE(parser.Parse("second.ini"));
+  EXPECT_EQ(&arena, parser.values().group("file").arena());
+  EXPECT_EQ(Value("second.ini"), parser.values().group("file").value("name"));
+  EXPECT_GT(arena.bytes_used(), 0U);
+}
+
+TEST_F(ConfigParserTest, ReplayToHandler) {
+  // A parser which does not stream passes on what it parsed
+  FakeConfigParser parser;
+  RecordingHandler handler;
+  ConfigParser & base_parser = parser;
+  ASSERT_TRUE(base_parser.Parse("first.ini", &handler));
+  EXPECT_EQ("[file]name=first.ini;", handler.events);
+
+  ConfigHandler::Text text("abc", 3);
+  EXPECT_TRUE(text == "abc");
+  EXPECT_TRUE(text == StringType("abc"));
+  EXPECT_TRUE(text != "ab");
+  EXPECT_TRUE(text != StringType("abcd"));
+  EXPECT_FALSE(text.empty());
+}
+
+TEST_F(ConfigParserTest, ConfigSwitchIndex) {
+  SwitchSet switch_set;
+  switch_set.insert(Switch().name("verbose"));
+  switch_set.insert("server", Switch().name("port").store());
+  switch_set.insert("server", Switch().name("port").append());
+  switch_set.insert("server", Switch().name("name").store());
+  switch_set.insert("__fallback__", Switch().name("name").append());
+  switch_set.insert("__fallback__", Switch().name("alias").append());
+
+  const SwitchSet & const_set = switch_set;
+  ConfigSwitchIndex index(const_set);
+  EXPECT_TRUE(const_set.has_switch("server", "port"));
+  EXPECT_EQ(&const_set.switches("server")[0],
+    index.Find(index.group("server"), "port"));
+  EXPECT_EQ(&const_set.switches("server")[2],
+    index.Find(index.group("server"), "name"));
+  EXPECT_EQ(&const_set.switches("__fallback__")[1],
+    index.Find(index.group("server"), "alias"));
+  EXPECT_EQ(&const_set.switches("")[0],
+    index.Find(index.group(""), "verbose"));
+
+  EXPECT_TRUE(index.group("client") == NULL);
+  EXPECT_EQ(&const_set.switches("__fallback__")[0],
+    index.Find(index.group("client"), "name"));
+  EXPECT_TRUE(index.Find(index.group("client"), "port") == NULL);
+  EXPECT_TRUE(index.Find(index.group(""), "alias") != NULL);
+}
+
+}  // namespace yact
@@ -0,0 +1,191 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include <yact.h>
+#include <utility>
+#include <vector>
+#include "base/atomicops.h"
+#include "base/lock.h"
+#include "base/logging.h"
+
+namespace yact {
+
+using base::subtle::AtomicWord;
+
+// The state of one Reader.  Slots are created as readers register, reused
+// once their Reader is destroyed and deleted only with the publisher, so
+// the publisher can scan them without coordinating with readers.
+struct ConfigPublisher::Slot {
+  // The epoch in which the reader pinned its snapshot, or zero if it has
+  // none pinned.  Written only by the reader.
+  AtomicWord epoch;
+
+  // Keeps the epochs of different readers on different cache lines, so
+  // that readers on different cores do not contend for them
+  char padding[128 - sizeof(AtomicWord)];
+
+  // Guarded by Data::lock
+  bool in_use;
+  Slot * next;
+};
+
+class ConfigPublisher::Data {
+ public:
+  Data()
+    : current(0),
+      epoch(1),
+      slots(NULL) {
+  }
+
+  // Deletes the retired snapshots which were replaced before the epoch of
+  // every pinned snapshot.  lock must be held.
+  void Reclaim() {
+    // Orders the publication of the current snapshot before the scan of the
+    // slots.  Readers have the matching barrier between recording their
+    // epoch and loading the current snapshot, so either a reader sees the
+    // new snapshot or the scan sees the reader's epoch.
+    base::subtle::MemoryBarrier();
+    AtomicWord oldest = base::subtle::NoBarrier_Load(&epoch);
+    for (Slot * slot = slots; slot; slot = slot->next) {
+      // Acquire orders the reader's use of its snapshot before the delete
+      AtomicWord pinned = base::subtle::Acquire_Load(&slot->epoch);
+      if (pinned && pinned < oldest) {
+        oldest = pinned;
+      }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < retired.size(); ++i) {
+      if (retired[i].first < oldest) {
+        delete retired[i].second;
+      } else {
+        retired[kept++] = retired[i];
+      }
+    }
+    retired.resize(kept);
+  }
+
+  // The current snapshot, a const ValueGroup *
+  AtomicWord current;
+
+  // Advanced by each Publish().  Starts at one so that a slot holding zero
+  // can mean that no snapshot is pinned.
+  AtomicWord epoch;
+
+  Lock lock;
+  Slot * slots;
+
+  // Replaced snapshots with the epoch in which they were replaced.  Readers
+  // which pinned in that epoch or earlier may still be using them.
+  std::vector<std::pair<AtomicWord, const ValueGroup *> > retired;
+};
+
+ConfigPublisher::ConfigPublisher(const ValueGroup & config)
+  : data_(new Data) {
+  data_->current = reinterpret_cast<AtomicWord>(new ValueGroup(config));
+}
+
+ConfigPublisher::~ConfigPublisher() {
+  while (data_->slots) {
+    Slot * slot = data_->slots;
+    DCHECK(!slot->in_use) << "A Reader outlived its ConfigPublisher";
+    data_->slots = slot->next;
+    delete slot;
+  }
+  for (size_t i = 0; i < data_->retired.size(); ++i) {
+    delete data_->retired[i].second;
+  }
+  delete reinterpret_cast<const ValueGroup *>(data_->current);
+  delete data_;
+}
+
+void ConfigPublisher::Publish(const ValueGroup & config) {
+  PublishSnapshot(new ValueGroup(config));
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+void ConfigPublisher::Publish(ValueGroup && config) {
+  ValueGroup * snapshot = new ValueGroup;
+  snapshot->swap(config);
+  PublishSnapshot(snapshot);
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
+void ConfigPublisher::Reclaim() {
+  AutoLock lock(data_->lock);
+  data_->Reclaim();
+}
+
+size_t ConfigPublisher::retired_count() const {
+  AutoLock lock(data_->lock);
+  return data_->retired.size();
+}
+
+void ConfigPublisher::PublishSnapshot(const ValueGroup * config) {
+  AutoLock lock(data_->lock);
+  const ValueGroup * old = reinterpret_cast<const ValueGroup *>(
+    base::subtle::NoBarrier_Load(&data_->current));
+  base::subtle::Release_Store(&data_->current,
+    reinterpret_cast<AtomicWord>(config));
+
+  // Readers which record the new epoch are certain to load the new snapshot
+  AtomicWord epoch = base::subtle::NoBarrier_Load(&data_->epoch);
+  base::subtle::Release_Store(&data_->epoch, epoch + 1);
+  data_->retired.push_back(std::make_pair(epoch, old));
+  data_->Reclaim();
+}
+
+ConfigPublisher::Reader::Reader(ConfigPublisher * publisher)
+  : data_(publisher->data_),
+    slot_(NULL),
+    depth_(0) {
+  AutoLock lock(data_->lock);
+  for (Slot * slot = data_->slots; slot; slot = slot->next) {
+    if (!slot->in_use) {
+      slot_ = slot;
+      break;
+    }
+  }
+  if (!slot_) {
+    slot_ = new Slot;
+    slot_->epoch = 0;
+    slot_->next = data_->slots;
+    data_->slots = slot_;
+  }
+  slot_->in_use = true;
+}
+
+ConfigPublisher::Reader::~Reader() {
+  DCHECK_EQ(0, depth_) << "A ConfigSnapshot outlived its Reader";
+  AutoLock lock(data_->lock);
+  slot_->in_use = false;
+}
+
+const ValueGroup * ConfigPublisher::Reader::Pin() {
+  if (depth_++ == 0) {
+    base::subtle::NoBarrier_Store(&slot_->epoch,
+      base::subtle::Acquire_Load(&data_->epoch));
+    // Pairs with the barrier in Data::Reclaim()
+    base::subtle::MemoryBarrier();
+  }
+  return reinterpret_cast<const ValueGroup *>(
+    base::subtle::Acquire_Load(&data_->current));
+}
+
+void ConfigPublisher::Reader::Unpin() {
+  DCHECK_GT(depth_, 0);
+  if (--depth_ == 0) {
+    base::subtle::Release_Store(&slot_->epoch, 0);
+  }
+}
+
+ConfigSnapshot::ConfigSnapshot(ConfigPublisher::Reader * reader)
+  : reader_(reader),
+    config_(reader->Pin()) {
+}
+
+ConfigSnapshot::~ConfigSnapshot() {
+  reader_->Unpin();
+}
+
+}  // namespace yact
@@ -0,0 +1,118 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "base/atomicops.h"
+#include "base/platform_thread.h"
+
+namespace yact {
+
+class ConfigPublisherTest : public BaseTest {
+};
+
+namespace {
+
+ValueGroup MakeConfig(int generation) {
+  ValueGroup config;
+  config.SetValue("generation", Value(generation));
+  config.CreateGroup("cache").SetValue("generation", Value(generation));
+  return config;
+}
+
+}  // anonymous namespace
+
+TEST_F(ConfigPublisherTest, Basics) {
+  ConfigPublisher publisher(MakeConfig(1));
+  ConfigPublisher::Reader reader(&publisher);
+  {
+    ConfigSnapshot old_config(&reader);
+    EXPECT_EQ(Value(1), old_config->value("generation"));
+
+    // A pinned snapshot survives the publication of a new one
+    publisher.Publish(MakeConfig(2));
+    EXPECT_EQ(1, publisher.retired_count());
+    EXPECT_EQ(Value(1), old_config->value("generation"));
+
+    // Nested snapshots see the new configuration
+    ConfigSnapshot new_config(&reader);
+    EXPECT_EQ(Value(2), new_config.config().value("generation"));
+    EXPECT_EQ(Value(1), (*old_config).group("cache").value("generation"));
+    publisher.Reclaim();
+    EXPECT_EQ(1, publisher.retired_count());
+  }
+  publisher.Reclaim();
+  EXPECT_EQ(0, publisher.retired_count());
+
+  // With nothing pinned a replaced snapshot is deleted immediately, and
+  // pinning does not allocate
+  publisher.Publish(MakeConfig(3));
+  EXPECT_EQ(0, publisher.retired_count());
+  int allocations = AllocationCount();
+  {
+    ConfigSnapshot config(&reader);
+    EXPECT_EQ(Value(3), config->value("generation"));
+  }
+  EXPECT_EQ(0, AllocationCount() - allocations);
+}
+
+namespace {
+
+class ReaderThread : public PlatformThread::Delegate {
+ public:
+  ReaderThread() : publisher_(NULL), done_(NULL), reads_(0), failures_(0) {}
+
+  void Init(ConfigPublisher * publisher, base::subtle::Atomic32 * done) {
+    publisher_ = publisher;
+    done_ = done;
+  }
+
+  virtual void ThreadMain() {
+    ConfigPublisher::Reader reader(publisher_);
+    int last_generation = 0;
+    while (!base::subtle::Acquire_Load(done_) || reads_ < 1000) {
+      ConfigSnapshot config(&reader);
+      int generation = config->value("generation").AsInt();
+      if (generation < last_generation || !(Value(generation) ==
+          config->group("cache").value("generation"))) {
+        ++failures_;
+      }
+      last_generation = generation;
+      ++reads_;
+    }
+  }
+
+  int failures() const { return failures_; }
+
+ private:
+  ConfigPublisher * publisher_;
+  base::subtle::Atomic32 * done_;
+  int reads_;
+  int failures_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ConfigPublisherTest, ConcurrentReload) {
+  ConfigPublisher publisher(MakeConfig(0));
+  base::subtle::Atomic32 done = 0;
+  const int kThreadCount = 8;
+  ReaderThread threads[kThreadCount];
+  PlatformThreadHandle handles[kThreadCount];
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads[i].Init(&publisher, &done);
+    ASSERT_TRUE(PlatformThread::Create(0, &threads[i], &handles[i]));
+  }
+  for (int generation = 1; generation <= 200; ++generation) {
+    publisher.Publish(MakeConfig(generation));
+  }
+  base::subtle::Release_Store(&done, 1);
+  for (int i = 0; i < kThreadCount; ++i) {
+    PlatformThread::Join(handles[i]);
+    EXPECT_EQ(0, threads[i].failures());
+  }
+  publisher.Reclaim();
+  EXPECT_EQ(0, publisher.retired_count());
+}
+
+}  // namespace yact
@@ -3,7 +3,19 @@
 // found in the LICENSE file.
 #include "yact/environment.h"
 #include <stdlib.h>
+#include <string.h>
+#include "build/build_config.h"
 #include "base/logging.h"
+#include "yact/string.h"
+
+#if defined(OS_MACOSX)
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#elif defined(OS_WIN)
+#define environ _environ
+#else  // !OS_MACOSX && !OS_WIN
+extern char ** environ;
+#endif  // !OS_MACOSX && !OS_WIN
 
 namespace yact {
 
@@ -39,4 +51,68 @@ void Environment::Unset(const StringType & name) {
   DCHECK(NULL == getenv(name.c_str()));
 }
 
+EnvironmentSnapshot::EnvironmentSnapshot(const StringType & prefix)
+  : mask_(0),
+    size_(0) {
+  std::vector<Slot> entries;
+  for (char ** it = environ; it && *it; ++it) {
+    const char * entry = *it;
+    if (strncmp(entry, prefix.c_str(), prefix.size()) != 0) {
+      continue;
+    }
+    const char * equals = strchr(entry, '=');
+    if (!equals || equals == entry) {
+      continue;
+    }
+    Slot slot;
+    slot.name_offset = storage_.size();
+    slot.name_size = equals - entry;
+    slot.value_size = strlen(equals + 1);
+    slot.hash = HashString(base::StringPiece(entry, slot.name_size));
+    storage_.append(entry, slot.name_size + 1 + slot.value_size);
+    entries.push_back(slot);
+  }
+
+  // Keep the load factor at or below 1/2 so that probe sequences stay short.
+  size_t capacity = 8;
+  while (capacity < entries.size() * 2) {
+    capacity *= 2;
+  }
+  Slot empty_slot = { 0, 0, 0, 0 };
+  slots_.assign(capacity, empty_slot);
+  mask_ = capacity - 1;
+
+  // The first definition of a name wins, as it does for getenv().
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Slot & entry = entries[i];
+    base::StringPiece name(storage_.data() + entry.name_offset,
+      entry.name_size);
+    size_t j = entry.hash & mask_;
+    while (slots_[j].name_size && !(slots_[j].hash == entry.hash &&
+        base::StringPiece(storage_.data() + slots_[j].name_offset,
+          slots_[j].name_size) == name)) {
+      j = (j + 1) & mask_;
+    }
+    if (!slots_[j].name_size) {
+      slots_[j] = entry;
+      ++size_;
+    }
+  }
+}
+
+bool EnvironmentSnapshot::Get(const base::StringPiece & name,
+    base::StringPiece * value) const {
+  size_t hash = HashString(name);
+  for (size_t i = hash & mask_; slots_[i].name_size; i = (i + 1) & mask_) {
+    const Slot & slot = slots_[i];
+    if (slot.hash == hash && base::StringPiece(storage_.data() +
+        slot.name_offset, slot.name_size) == name) {
+      value->set(storage_.data() + slot.name_offset + slot.name_size + 1,
+        slot.value_size);
+      return true;
+    }
+  }
+  return false;
+}
+
 }  // namespace yact
@@ -5,6 +5,9 @@
 #define YACT_ENVIRONMENT_H_
 
 #include <yact.h>
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
 namespace yact {
 
 class Environment {
@@ -15,6 +18,43 @@ public:
   void Unset(const StringType & name);
 };
 
+// A copy of the environment taken by walking it once, indexed by variable
+// name in an open-addressing hash table.  Looking up many variables in a
+// snapshot costs O(1) each, rather than a scan of the environment per
+// getenv() call.  Later changes to the environment are not reflected.
+class EnvironmentSnapshot {
+ public:
+  // Copies the variables whose names begin with `prefix`, or all of them if
+  // `prefix` is empty.  The others are never looked at again.
+  explicit EnvironmentSnapshot(const StringType & prefix = kEmptyString);
+
+  // Stores the value of the variable `name` in `value`, which points into
+  // the snapshot.  Returns false if the variable was not set (or does not
+  // begin with the prefix).
+  bool Get(const base::StringPiece & name, base::StringPiece * value) const;
+
+  // The number of variables in the snapshot
+  size_t size() const { return size_; }
+
+ private:
+  struct Slot {
+    size_t name_offset;
+    size_t name_size;
+    size_t value_size;
+    size_t hash;
+  };
+
+  // The "NAME=VALUE" strings of the snapshot, end to end
+  std::string storage_;
+
+  // Slots with name_size == 0 are empty.
+  std::vector<Slot> slots_;
+  size_t mask_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(EnvironmentSnapshot);
+};
+
 }
 
 #endif  // YACT_ENVIRONMENT_H_
@@ -0,0 +1,51 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "yact/environment.h"
+
+namespace yact {
+
+class EnvironmentSnapshotTest : public BaseTest {
+ public:
+  void SetUp() {
+    env_.Set("YACT_TEST_ONE", "1");
+    env_.Set("YACT_TEST_EMPTY", "");
+    env_.Set("YACT_TEST_EQUALS", "a=b");
+  }
+  void TearDown() {
+    env_.Unset("YACT_TEST_ONE");
+    env_.Unset("YACT_TEST_EMPTY");
+    env_.Unset("YACT_TEST_EQUALS");
+  }
+  Environment env_;
+};
+
+TEST_F(EnvironmentSnapshotTest, Get) {
+  EnvironmentSnapshot snapshot;
+  base::StringPiece value;
+  ASSERT_TRUE(snapshot.Get("YACT_TEST_ONE", &value));
+  EXPECT_EQ("1", value);
+  ASSERT_TRUE(snapshot.Get("YACT_TEST_EMPTY", &value));
+  EXPECT_EQ("", value);
+  ASSERT_TRUE(snapshot.Get("YACT_TEST_EQUALS", &value));
+  EXPECT_EQ("a=b", value);
+  EXPECT_FALSE(snapshot.Get("YACT_TEST_MISSING", &value));
+  EXPECT_FALSE(snapshot.Get("YACT_TEST_", &value));
+
+  // Changes after the snapshot is taken are not visible
+  env_.Set("YACT_TEST_ONE", "2");
+  ASSERT_TRUE(snapshot.Get("YACT_TEST_ONE", &value));
+  EXPECT_EQ("1", value);
+}
+
+TEST_F(EnvironmentSnapshotTest, Prefix) {
+  EnvironmentSnapshot snapshot("YACT_TEST_E");
+  EXPECT_EQ(2, snapshot.size());
+  base::StringPiece value;
+  EXPECT_TRUE(snapshot.Get("YACT_TEST_EQUALS", &value));
+  EXPECT_FALSE(snapshot.Get("YACT_TEST_ONE", &value));
+}
+
+}  // namespace yact
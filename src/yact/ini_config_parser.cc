@@ -2,133 +2,507 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include <yact.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "base/file_path.h"
+#include "base/atomicops.h"
 #include "base/file_util.h"
+#include "base/hash_tables.h"
+#include "base/logging.h"
+#include "base/platform_thread.h"
+#include "base/scoped_ptr.h"
 #include "base/string_util.h"
+#include "yact/config_builder.h"
+#include "yact/ini_scanner.h"
+#include "yact/string.h"
 
 namespace yact {
 
-IniConfigParser::IniConfigParser() {
+namespace {
+// Parts of a file parsed on threads of their own are at least this long, so
+// that a small file is not split among more threads than it can keep busy
+const size_t kMinChunkSize = 256 * 1024;
 
-}
-
-bool IniConfigParser::Parse(const StringType & filename) {
-  file_util::ScopedFILE fp(file_util::OpenFile(filename, "r"));
-  if (!fp.get()) {
+// Passes the sections and keys of `text`, whose first line is `first_line`,
+// to `handler` until it stops the scan, returning false and setting `error`
+// and `line` on a malformed line
+bool Scan(const base::StringPiece & text, ConfigHandler * handler,
+    StringType * error, int * line, int first_line = 1) {
+  IniScanner scanner(text, first_line);
+  IniToken token;
+  while (scanner.Next(&token)) {
+    ConfigHandler::Text name(token.name.data(), token.name.size());
+    bool more = token.type == IniToken::kSection ?
+      handler->OnSection(name, token.line) :
+      handler->OnKeyValue(name, ConfigHandler::Text(token.value.data(),
+        token.value.size()), token.line);
+    if (!more) {
+      return true;
+    }
+  }
+  if (!scanner.error().empty()) {
+    *error = scanner.error();
+    *line = token.line;
     return false;
   }
-  return Parse(fp.get());
+  return true;
 }
 
-bool IniConfigParser::Parse(FILE * fp) {
-  int line_number = 0;
-  size_t buffer_nchars = 1024;
-  StringType old_buffer;
-  StringType buffer;
-  while (!feof(fp)) {
-    size_t actual_nchars = fread(WriteInto(&buffer, buffer_nchars + 1),
-      sizeof(CharType), buffer_nchars, fp);
-    if (actual_nchars == 0 && ferror(fp)) {
-      error_ = "Cannot read configuration file";
-      return false;
+bool IsSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Returns the offset of the first line at or after `from`, which must start a
+// line, whose first character other than whitespace is '[', or npos.  Only
+// the brackets in the text are examined.
+size_t FindHeader(const base::StringPiece & text, size_t from) {
+  while (from < text.size()) {
+    const char * bracket = static_cast<const char *>(
+      memchr(text.data() + from, '[', text.size() - from));
+    if (!bracket) {
+      break;
+    }
+    const char * start = bracket;
+    while (start != text.data() && IsSpace(start[-1])) {
+      --start;
     }
-    buffer.resize(actual_nchars);
+    if (start == text.data() || start[-1] == '\n') {
+      return start - text.data();
+    }
+    from = bracket + 1 - text.data();
+  }
+  return base::StringPiece::npos;
+}
 
-    std::vector<StringType> lines;
-    buffer = old_buffer + buffer;
-    SplitStringDontTrim(buffer, '\n', &lines);
+// The number of the line at `offset` in `text`, which only errors need
+int LineAt(const base::StringPiece & text, size_t offset) {
+  return 1 + static_cast<int>(
+    std::count(text.data(), text.data() + offset, '\n'));
+}
 
-    for (size_t i = 0; i + 1 < lines.size(); ++i) {
-      if (!ParseLine(lines[i], line_number)) {
+// Appends the values of `from`, but not its subgroups, to `to`
+void AppendValues(const ValueGroup & from, ValueGroup * to) {
+  for (ValueGroup::ValueMap::const_iterator it = from.values().begin();
+      it != from.values().end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      to->AddRepeatedValue(it->first, it->second[i]);
+    }
+  }
+}
+
+// Appends the keys before the first section header of a part after the
+// first to `to`, whose switches in `index` are `section`.  The keys were
+// stored as text, since their section was not known yet.  Returns false if
+// one is unknown or does not convert, for the whole file to be parsed on one
+// thread instead.
+bool AppendLeadingValues(const ValueGroup & from,
+    const ConfigSwitchIndex & index, const ConfigSwitchIndex::Group * section,
+    bool reject_unknown_switches, ValueGroup * to) {
+  for (ValueGroup::ValueMap::const_iterator it = from.values().begin();
+      it != from.values().end(); ++it) {
+    const Switch * switch_ = index.Find(section, it->first);
+    if (!switch_ && reject_unknown_switches) {
+      return false;
+    }
+    if (!switch_ || switch_->type() == Value::kTypeAuto) {
+      for (size_t i = 0; i < it->second.size(); ++i) {
+        to->AddRepeatedValue(it->first, it->second[i]);
+      }
+      continue;
+    }
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      Value value;
+      if (!ConvertConfigValue(switch_, it->second[i].AsString(), &value)) {
         return false;
       }
-      ++line_number;
+      to->AddRepeatedValue(it->first, value);
     }
-    old_buffer = lines.back();
   }
+  return true;
+}
+}  // anonymous namespace
 
-  // TODO(ross): handle continuations ending with \
+// A part of a file, which is parsed on a thread of its own into a group of
+// its own.  The keys before the first section header of the part are stored
+// in the group itself, to be moved to the section they belong to once the
+// parts before it have been merged.
+class IniConfigParser::Chunk : public PlatformThread::Delegate {
+ public:
+  Chunk() : parser_(NULL), index_(NULL), at_start_(false) {}
 
-  // at eof, we are left with the last line of the file to parse
-  if (!ParseLine(old_buffer, line_number)) {
-    return false;
+  void Init(IniConfigParser * parser, const ConfigSwitchIndex * index,
+      const base::StringPiece & text, bool at_start) {
+    parser_ = parser;
+    index_ = index;
+    text_ = text;
+    at_start_ = at_start;
   }
-  return true;
-}
 
-bool IniConfigParser::ParseLine(StringType & line, int line_number) {
-  // strip off comments, shortcut
-  if (line[0] == '#' || line[0] == ';') {
-    return true;
+  virtual void ThreadMain() {
+    Builder builder(index_, parser_->reject_unknown_switches_, &values,
+      &error, at_start_ ? &kEmptyString : NULL);
+    int line;
+    Scan(text_, &builder, &error, &line);
+    last_section = builder.section_name();
   }
 
-  // strip off comment, long cut
-  size_t comment_start_position = line.find('#');
-  if (comment_start_position != std::string::npos) {
-    line = line.substr(0, comment_start_position);
+  ValueGroup values;
+
+  // The name of the last section header in the part, or empty if it has none
+  StringType last_section;
+
+  // Set if the part is malformed or has an unknown switch
+  StringType error;
+
+ private:
+  IniConfigParser * parser_;
+  const ConfigSwitchIndex * index_;
+  base::StringPiece text_;
+  bool at_start_;
+
+  DISALLOW_COPY_AND_ASSIGN(Chunk);
+};
+
+// The text of a lazily parsed file, which the loaders of its sections share
+// and the last of them frees
+class IniConfigParser::Source {
+ public:
+  // Maps `path` into memory, returning NULL if it cannot
+  static Source * Map(const FilePath & path) {
+    Source * source = new Source;
+    if (!source->file_.Initialize(path)) {
+      Release(source);
+      return NULL;
+    }
+    source->text.set(source->file_.data(), source->file_.length());
+    return source;
   }
-  comment_start_position = line.find(';');
-  if (comment_start_position != std::string::npos) {
-    line = line.substr(0, comment_start_position);
+
+  static Source * Copy(const std::string & contents) {
+    Source * source = new Source;
+    source->contents_ = contents;
+    source->text.set(source->contents_.data(), source->contents_.size());
+    return source;
   }
 
-  TrimWhitespace(line, TRIM_ALL, &line);
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
 
-  // section header
-  if (line[0] == '[') {
-    if (line[line.size() - 1] == ']') {
-      error_ = StringPrintf("Invalid section header on line %d",
-        line_number);
-      return false;
+  static void Release(Source * source) {
+    if (base::subtle::Barrier_AtomicIncrement(&source->ref_count_, -1) == 0) {
+      delete source;
     }
-    section_ = line.substr(1, line.size() - 2);
-    return true;
   }
 
-  // key-value assignment
-  size_t equal_sign_position = line.find('=');
-  if (equal_sign_position != std::string::npos) {
-    StringType key = line.substr(0, equal_sign_position);
-    StringType value = line.substr(equal_sign_position + 1);
-    if (!AssignValue(key, value)) {
-      error_ += StringPrintf(" line %d", line_number);
-      return false;
+  base::StringPiece text;
+
+  // Sets the switches which type the keys, and whether keys must have one
+  void set_switch_set(const SwitchSet & switch_set,
+      bool reject_unknown_switches) {
+    switch_set_ = switch_set;
+    index_.reset(new ConfigSwitchIndex(switch_set_));
+    reject_unknown_switches_ = reject_unknown_switches;
+  }
+  const ConfigSwitchIndex * index() const { return index_.get(); }
+  bool reject_unknown_switches() const { return reject_unknown_switches_; }
+
+ private:
+  Source() : ref_count_(1), reject_unknown_switches_(false) {}
+
+  base::subtle::Atomic32 ref_count_;
+  SwitchSet switch_set_;
+  scoped_ptr<ConfigSwitchIndex> index_;
+  bool reject_unknown_switches_;
+  file_util::MemoryMappedFile file_;
+  std::string contents_;
+
+  DISALLOW_COPY_AND_ASSIGN(Source);
+};
+
+// Parses a section, which may appear more than once in the file, the first
+// time it is read
+class IniConfigParser::LazySection : public ValueGroup::Loader {
+ public:
+  explicit LazySection(Source * source) : source_(source) {
+    source_->AddRef();
+  }
+
+  virtual ~LazySection() {
+    Source::Release(source_);
+  }
+
+  // Adds the lines between the offsets `begin` and `end` to the section
+  void AddLines(size_t begin, size_t end) {
+    ranges_.push_back(std::make_pair(begin, end));
+  }
+
+  virtual void Load(ValueGroup * group) {
+    StringType error;
+    if (LoadLines(group, &error, false)) {
+      return;
+    }
+
+    // The lines are numbered only to report an error, which is rare enough
+    // to be worth parsing the section again for
+    ValueGroup(group->name(), group->arena()).swap(*group);
+    LoadLines(group, &error, true);
+    LOG(ERROR) << error;
+  }
+
+ private:
+  // Parses the lines of the section into `group`, returning false at the
+  // first error
+  bool LoadLines(ValueGroup * group, StringType * error, bool number_lines) {
+    Builder builder(source_->index(), source_->reject_unknown_switches(),
+      group, error, &group->name());
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+      size_t begin = ranges_[i].first;
+      int line;
+      if (!Scan(source_->text.substr(begin, ranges_[i].second - begin),
+          &builder, error, &line,
+          number_lines ? LineAt(source_->text, begin) : 1) ||
+          !error->empty()) {
+        return false;
+      }
     }
     return true;
   }
 
-  // unrecognized
-  error_ = StringPrintf("Syntax error line %d", line_number);
-  return false;
+  Source * source_;
+  std::vector<std::pair<size_t, size_t> > ranges_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazySection);
+};
+
+IniConfigParser::IniConfigParser()
+  : threads_(1),
+    lazy_(false) {
+}
+
+bool IniConfigParser::Parse(const StringType & filename) {
+  return ParseFile(filename, NULL);
+}
+
+bool IniConfigParser::Parse(const StringType & filename,
+    ConfigHandler * handler) {
+  return ParseFile(filename, handler);
 }
 
-bool IniConfigParser::AssignValue(const StringType & name, const StringType & value) {
-  const Switch * switch_ = NULL;
-  if (switch_set_.has_switch(section_, name)) {
-    switch_ = &switch_set_.switch_(section_, name);
-  } else if (switch_set_.has_switch("__fallback__", name)) {
-    switch_ = &switch_set_.switch_("__fallback__", name);
+bool IniConfigParser::ParseString(const std::string & contents) {
+  if (lazy_ && !values_.arena()) {
+    return ParseLazily(Source::Copy(contents));
   }
-  if (reject_unknown_switches_) {
-    error_ = StringPrintf("Unknown switch %s.%s", section_.c_str(),
-      name.c_str());
+  return ParseBuffer(contents.data(), contents.size(), NULL);
+}
+
+bool IniConfigParser::ParseString(const std::string & contents,
+    ConfigHandler * handler) {
+  return ParseBuffer(contents.data(), contents.size(), handler);
+}
+
+IniConfigParser & IniConfigParser::threads(int threads) {
+  DCHECK_GE(threads, 1);
+  threads_ = threads;
+  return *this;
+}
+
+int IniConfigParser::threads() const {
+  return threads_;
+}
+
+IniConfigParser & IniConfigParser::lazy(bool lazy) {
+  lazy_ = lazy;
+  return *this;
+}
+
+bool IniConfigParser::lazy() const {
+  return lazy_;
+}
+
+bool IniConfigParser::ParseFile(const StringType & filename,
+    ConfigHandler * handler) {
+#if defined(OS_WIN)
+  FilePath path(StringToWide(filename));
+#else  // !OS_WIN
+  FilePath path(filename);
+#endif  // !OS_WIN
+  if (!handler && lazy_ && !values_.arena()) {
+    // A file which cannot be mapped is handled below, as it is when parsing
+    // eagerly
+    Source * source = Source::Map(path);
+    if (source) {
+      return ParseLazily(source);
+    }
+  }
+  file_util::MemoryMappedFile file;
+  if (!file.Initialize(path)) {
+    // An empty file cannot be mapped, but is a valid (empty) configuration
+    int64 size;
+    if (file_util::GetFileSize(path, &size) && size == 0) {
+      return ParseBuffer(NULL, 0, handler);
+    }
+    if (!handler) {
+      // A failed parse leaves values() empty, as it does any other parse
+      Builder builder(this);
+    }
+    error_ = StringPrintf("Cannot read configuration file '%s'",
+      filename.c_str());
+    if (handler) {
+      handler->OnError(error_, 0);
+    }
     return false;
   }
+  return ParseBuffer(reinterpret_cast<const char *>(file.data()),
+    file.length(), handler);
+}
 
+bool IniConfigParser::ParseBuffer(const char * data, size_t size,
+    ConfigHandler * handler) {
+  if (!handler) {
+    // Each part of the file is parsed on its own heap, since an arena is not
+    // safe to share between threads
+    int chunks = std::min<size_t>(threads_, size / kMinChunkSize);
+    if (chunks > 1 && !values_.arena() && ParseChunks(data, size, chunks)) {
+      return true;
+    }
+    Builder builder(this);
+    return ParseBuffer(data, size, &builder);
+  }
 
-  return true;
+  error_.clear();
+  int line;
+  if (!Scan(base::StringPiece(data, size), handler, &error_, &line)) {
+    handler->OnError(error_, line);
+    return false;
+  }
+  // Stopping early is not an error unless the handler says it is
+  return error_.empty();
+}
+
+bool IniConfigParser::ParseChunks(const char * data, size_t size,
+    int count) {
+  // Each part after the first starts on the line after its share of the file
+  scoped_array<Chunk> chunks(new Chunk[count]);
+  ConfigSwitchIndex index(switch_set_);
+  size_t begin = 0;
+  for (int i = 0; i < count; ++i) {
+    size_t end = size;
+    if (i + 1 < count) {
+      end = std::max(begin, size / count * (i + 1));
+      const void * newline = memchr(data + end, '\n', size - end);
+      end = newline ?
+        static_cast<const char *>(newline) + 1 - data : size;
+    }
+    chunks[i].Init(this, &index, base::StringPiece(data + begin, end - begin),
+      i == 0);
+    begin = end;
+  }
+
+  // The first part is parsed on this thread, and any part whose thread
+  // cannot be started after it
+  std::vector<PlatformThreadHandle> handles(count);
+  std::vector<bool> started(count, false);
+  for (int i = 1; i < count; ++i) {
+    started[i] = PlatformThread::Create(0, &chunks[i], &handles[i]);
+  }
+  for (int i = 0; i < count; ++i) {
+    if (started[i]) {
+      PlatformThread::Join(handles[i]);
+    } else {
+      chunks[i].ThreadMain();
+    }
+  }
+
+  // Merge the parts in order.  A part which is malformed, or which starts
+  // with a key the current section does not allow, makes the caller parse
+  // the whole file on one thread, so that the error and the values before it
+  // are exactly those of a sequential parse.  The first part becomes values()
+  // and the rest are merged into it.
+  for (int i = 0; i < count; ++i) {
+    if (!chunks[i].error.empty()) {
+      return false;
+    }
+  }
+  error_.clear();
+  values_.swap(chunks[0].values);
+  StringType section_name = chunks[0].last_section;
+  ValueGroup * section = section_name.empty() ? &values_ :
+    &values_.CreateGroup(section_name);
+  for (int i = 1; i < count; ++i) {
+    Chunk & chunk = chunks[i];
+    if (!AppendLeadingValues(chunk.values, index, index.group(section_name),
+        reject_unknown_switches_, section)) {
+      return false;
+    }
 
+    // A section seen for the first time is moved rather than copied
+    for (ValueGroup::ValueGroupMap::const_iterator it =
+        chunk.values.groups().begin(); it != chunk.values.groups().end();
+        ++it) {
+      if (values_.has_group(it->first)) {
+        AppendValues(it->second, &values_.CreateGroup(it->first));
+      } else {
+        values_.CreateGroup(it->first).swap(
+          chunk.values.CreateGroup(it->first));
+      }
+    }
+    if (!chunk.last_section.empty()) {
+      section_name = chunk.last_section;
+      section = &values_.CreateGroup(section_name);
+    }
+  }
+  return true;
 }
 
-// # ...
-// ; ...
-// [section]
-// foo = bar
-// bax = bax \
-//  bop \
-//  beep
-// frob = 1,2, 3
-//
-// ; error
-// freak
+bool IniConfigParser::ParseLazily(Source * source) {
+  source->set_switch_set(switch_set_, reject_unknown_switches_);
+  Builder builder(this);
+  const base::StringPiece & text = source->text;
+
+  // The keys before the first header are parsed now, and the lines after
+  // each header are given to the loader of its section
+  base::hash_map<StringType, LazySection *> sections;
+  LazySection * section = NULL;
+  size_t begin = 0;
+  bool ok = true;
+  while (ok) {
+    size_t header = FindHeader(text, begin);
+    size_t end = header == base::StringPiece::npos ? text.size() : header;
+    if (section) {
+      section->AddLines(begin, end);
+    } else {
+      int line;
+      ok = Scan(text.substr(0, end), &builder, &error_, &line) &&
+        error_.empty();
+    }
+    if (!ok || header == base::StringPiece::npos) {
+      break;
+    }
+
+    begin = text.find('\n', header);
+    begin = begin == base::StringPiece::npos ? text.size() : begin + 1;
+    base::StringPiece header_line = text.substr(header, begin - header);
+    IniToken token;
+    if (!IniScanner(header_line).Next(&token)) {
+      IniScanner scanner(header_line, LineAt(text, header));
+      scanner.Next(&token);
+      error_ = scanner.error();
+      ok = false;
+      break;
+    }
+    StringType name(token.name.data(), token.name.size());
+    LazySection *& loader = sections[name];
+    if (!loader) {
+      loader = new LazySection(source);
+      values_.CreateGroup(name).set_loader(loader);
+    }
+    section = loader;
+  }
+  Source::Release(source);
+  return ok;
+}
 
 }  // namespace yact
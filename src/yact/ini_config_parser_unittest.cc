@@ -1,23 +1,419 @@
 // Copyright (c) 2010 Ross Kinder. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
-#include <yact.h>
 #include "yact/test_common.h"
+#include <yact.h>
+#include "base/file_path.h"
+#include "base/file_util.h"
+#include "base/string_number_conversions.h"
+#include "yact/string.h"
 
 namespace yact {
 
-class IniConfigParserUnittest : public BaseTest {
+class IniConfigParserTest : public BaseTest {
+};
+
+namespace {
+const char kConfig[] =
+  "; global settings\n"
+  "verbose = true\n"
+  "\n"
+  "[alice@example.net]\n"
+  "name = Alice   # the full name\n"
+  "port = 8080\n"
+  "\n"
+  "[bob@example.com]\n"
+  "name = Bob\n"
+  "alias = bob\n"
+  "alias = robert\n";
+
+void CheckConfig(const ValueGroup & values) {
+  EXPECT_EQ(1, values.values().size());
+  EXPECT_TRUE(values.value("verbose").AsBool());
+  ASSERT_EQ(2, values.groups().size());
+  const ValueGroup & alice = values.group("alice@example.net");
+  EXPECT_EQ("alice@example.net", alice.name());
+  EXPECT_STREQ("Alice", alice.value("name"));
+  EXPECT_EQ(8080, alice.value("port").AsInt());
+  const ValueGroup & bob = values.group("bob@example.com");
+  EXPECT_STREQ("Bob", bob.value("name"));
+  ASSERT_EQ(2, bob.repeated_value("alias").size());
+  EXPECT_STREQ("robert", bob.repeated_value("alias")[1]);
+}
+
+StringType PathToString(const FilePath & path) {
+#if defined(OS_WIN)
+  return WideToString(path.value());
+#else  // !OS_WIN
+  return path.value();
+#endif  // !OS_WIN
+}
+// Records the events it receives as "line:[section]", "line:key=value" and
+// "line:ERROR message", and stops at the section named `stop_at`
+class RecordingHandler : public ConfigHandler {
+ public:
+  explicit RecordingHandler(const char * stop_at = "") : stop_at_(stop_at) {}
+
+  virtual bool OnSection(const Text & name, int line) {
+    Record(line, "[" + name.as_string() + "]");
+    return name != stop_at_;
+  }
+
+  virtual bool OnKeyValue(const Text & key, const Text & value, int line) {
+    Record(line, key.as_string() + "=" + value.as_string());
+    return true;
+  }
+
+  virtual void OnError(const StringType & message, int line) {
+    Record(line, "ERROR " + message);
+  }
+
+  std::string events;
+
+ private:
+  void Record(int line, const std::string & event) {
+    if (!events.empty()) {
+      events += "|";
+    }
+    events += base::IntToString(line) + ":" + event;
+  }
+
+  const char * stop_at_;
+};
+
+// Counts the aliases of each user, keeping nothing else
+class AliasCounter : public ConfigHandler {
+ public:
+  AliasCounter() : aliases(0) {}
+
+  virtual bool OnKeyValue(const Text & key, const Text & value, int line) {
+    if (key == "alias") {
+      ++aliases;
+    }
+    return true;
+  }
+
+  int aliases;
 };
 
-TEST_F(IniConfigParserUnittest, CanParse) {
+// Expects `a` and `b` to hold the same values, in the same order, and the
+// same subgroups
+void ExpectSameGroups(const ValueGroup & a, const ValueGroup & b) {
+  EXPECT_EQ(a.name(), b.name());
+  ASSERT_EQ(a.values().size(), b.values().size()) << a.name();
+  for (ValueGroup::ValueMap::const_iterator it1 = a.values().begin(),
+      it2 = b.values().begin(); it1 != a.values().end(); ++it1, ++it2) {
+    EXPECT_EQ(it1->first, it2->first);
+    EXPECT_TRUE(it1->second == it2->second) << a.name() << "." << it1->first;
+  }
+  ASSERT_EQ(a.groups().size(), b.groups().size()) << a.name();
+  for (ValueGroup::ValueGroupMap::const_iterator it1 = a.groups().begin(),
+      it2 = b.groups().begin(); it1 != a.groups().end(); ++it1, ++it2) {
+    ExpectSameGroups(it1->second, it2->second);
+  }
+}
+
+// A file of about a megabyte whose sections are long enough to be split
+// between threads, and which come back again later in the file
+std::string MakeLargeConfig() {
+  std::string contents = "; global settings\nverbose = true\n";
+  for (int i = 0; i < 4000; ++i) {
+    contents += "[user" + base::IntToString(i % 700) + "]\n";
+    int keys = i % 50 == 0 ? 1000 : 5;
+    for (int key = 0; key < keys; ++key) {
+      contents += "alias = user" + base::IntToString(i) + "-" +
+        base::IntToString(key) + "  # a comment\n";
+    }
+    contents += "port = " + base::IntToString(i) + "\n";
+  }
+  return contents;
+}
+}  // anonymous namespace
+
+TEST_F(IniConfigParserTest, ParseString) {
+  IniConfigParser parser;
+  ASSERT_TRUE(parser.ParseString(kConfig)) << parser.error();
+  EXPECT_EQ("", parser.error());
+  CheckConfig(parser.values());
+
+  // Parsing again replaces the values
+  ASSERT_TRUE(parser.ParseString("[carol]\nname = Carol\n"));
+  EXPECT_EQ(0, parser.values().values().size());
+  EXPECT_EQ(1, parser.values().groups().size());
+
+  EXPECT_FALSE(parser.ParseString("a = b\n[broken\n"));
+  EXPECT_EQ("Invalid section header on line 2", parser.error());
+}
+
+TEST_F(IniConfigParserTest, ParseFile) {
+  FilePath path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&path));
+  file_util::WriteFile(path, kConfig, sizeof(kConfig) - 1);
+
+  IniConfigParser parser;
+  ASSERT_TRUE(parser.Parse(PathToString(path))) << parser.error();
+  CheckConfig(parser.values());
+
+  // An empty file is an empty configuration
+  file_util::WriteFile(path, "", 0);
+  ASSERT_TRUE(parser.Parse(PathToString(path)));
+  EXPECT_EQ(0, parser.values().values().size());
+  EXPECT_EQ(0, parser.values().groups().size());
+
+  file_util::Delete(path, false);
+  EXPECT_FALSE(parser.Parse(PathToString(path)));
+  EXPECT_FALSE(parser.error().empty());
+}
+
+TEST_F(IniConfigParserTest, Handler) {
+  IniConfigParser parser;
+  RecordingHandler handler;
+  ASSERT_TRUE(parser.ParseString(kConfig, &handler));
+  EXPECT_EQ("2:verbose=true|4:[alice@example.net]|5:name=Alice|6:port=8080|"
+    "8:[bob@example.com]|9:name=Bob|10:alias=bob|11:alias=robert",
+    handler.events);
+  EXPECT_EQ(0, parser.values().groups().size());
+
+  // Stopping early is not an error
+  RecordingHandler stopping("alice@example.net");
+  ASSERT_TRUE(parser.ParseString(kConfig, &stopping));
+  EXPECT_EQ("2:verbose=true|4:[alice@example.net]", stopping.events);
+
+  RecordingHandler failing;
+  EXPECT_FALSE(parser.ParseString("a = b\nfreak\n", &failing));
+  EXPECT_EQ("1:a=b|2:ERROR Syntax error on line 2", failing.events);
+  EXPECT_EQ("Syntax error on line 2", parser.error());
+
+  // Streaming allocates nothing of its own
+  AliasCounter counter;
+  std::string contents(kConfig);
+  int allocations = AllocationCount();
+  ASSERT_TRUE(parser.ParseString(contents, &counter));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ(2, counter.aliases);
+
+  FilePath path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&path));
+  file_util::WriteFile(path, kConfig, sizeof(kConfig) - 1);
+  AliasCounter file_counter;
+  ASSERT_TRUE(parser.Parse(PathToString(path), &file_counter));
+  EXPECT_EQ(2, file_counter.aliases);
+  file_util::Delete(path, false);
+  RecordingHandler missing;
+  EXPECT_FALSE(parser.Parse(PathToString(path), &missing));
+  EXPECT_EQ("0:ERROR " + parser.error(), missing.events);
+}
+
+TEST_F(IniConfigParserTest, RejectUnknownSwitches) {
   SwitchSet switch_set;
-  //switch_set.insert(
+  switch_set.insert(Switch().name("verbose"));
+  switch_set.insert("alice@example.net", Switch().name("name"));
+  switch_set.insert("alice@example.net", Switch().name("port"));
+  switch_set.insert("__fallback__", Switch().name("name"));
+
   IniConfigParser parser;
+  parser.switch_set(switch_set).reject_unknown_switches(true);
+  EXPECT_FALSE(parser.ParseString(kConfig));
+  EXPECT_EQ("Unknown switch bob@example.com.alias on line 10",
+    parser.error());
 
-//  parser.Parse(
+  switch_set.insert("__fallback__", Switch().name("alias"));
+  parser.switch_set(switch_set);
+  ASSERT_TRUE(parser.ParseString(kConfig)) << parser.error();
+  CheckConfig(parser.values());
+}
 
+TEST_F(IniConfigParserTest, TypedSwitches) {
+  SwitchSet switch_set;
+  switch_set.insert("server",
+    Switch().name("timeout").store().type(Value::kTypeDuration));
+  switch_set.insert("__fallback__",
+    Switch().name("cache").store().type(Value::kTypeByteSize));
+  switch_set.insert("server", Switch().name("name"));
 
+  IniConfigParser parser;
+  parser.switch_set(switch_set);
+  ASSERT_TRUE(parser.ParseString(
+    "[server]\ntimeout = 1h30m\ncache = 64MiB\nname = x\nport = 80\n"))
+    << parser.error();
+  const ValueGroup & server = parser.values().group("server");
+  EXPECT_EQ(Value::kTypeDuration, server.value("timeout").type());
+  EXPECT_EQ(GG_INT64_C(5400000000), server.value("timeout").AsDuration());
+  EXPECT_EQ(Value::kTypeByteSize, server.value("cache").type());
+  EXPECT_EQ(64 << 20, server.value("cache").AsByteSize());
+  EXPECT_EQ(Value::kTypeAuto, server.value("name").type());
+  EXPECT_EQ(Value::kTypeAuto, server.value("port").type());
+  EXPECT_EQ(80, server.value("port").AsInt());
+
+  EXPECT_FALSE(parser.ParseString("[server]\nname = x\ntimeout = soon\n"));
+  EXPECT_EQ("Cannot convert 'soon' to a duration for server.timeout on line 3",
+    parser.error());
+  RecordingHandler handler;
+  EXPECT_TRUE(parser.ParseString("[server]\ntimeout = soon\n", &handler));
+
+  parser.lazy(true);
+  ASSERT_TRUE(parser.ParseString("[server]\ntimeout = 250ms\n"));
+  EXPECT_EQ(Value::kTypeDuration,
+    parser.values().group("server").value("timeout").type());
 }
 
-}  // namespace yact
+TEST_F(IniConfigParserTest, Threads) {
+  std::string contents = MakeLargeConfig();
+  IniConfigParser sequential;
+  EXPECT_EQ(1, sequential.threads());
+  ASSERT_TRUE(sequential.ParseString(contents)) << sequential.error();
+  EXPECT_EQ(700, sequential.values().groups().size());
+
+  for (int threads = 2; threads <= 5; ++threads) {
+    IniConfigParser parser;
+    parser.threads(threads);
+    ASSERT_TRUE(parser.ParseString(contents)) << parser.error();
+    ExpectSameGroups(sequential.values(), parser.values());
+  }
+
+  // Errors and the values before them are those of a sequential parse
+  const size_t kBroken[] = {10, contents.size() / 3, contents.size() - 10};
+  for (size_t i = 0; i < arraysize(kBroken); ++i) {
+    std::string broken = contents;
+    broken.insert(broken.find('\n', kBroken[i]) + 1, "freak\n");
+    ASSERT_FALSE(sequential.ParseString(broken));
+    IniConfigParser parser;
+    parser.threads(4);
+    EXPECT_FALSE(parser.ParseString(broken));
+    EXPECT_EQ(sequential.error(), parser.error());
+    ExpectSameGroups(sequential.values(), parser.values());
+  }
+
+  // Keys before the first header of a part are checked against the section
+  // which the part starts in, here the second half of the keys of [a]
+  std::string split = "[a]\n";
+  for (int i = 0; i < 100000; ++i) {
+    split += i < 30000 ? "x = 1\n" : "z = 1\n";
+  }
+  split += "[b]\ny = 1\n";
+  SwitchSet switch_set;
+  switch_set.insert("a", Switch().name("x"));
+  switch_set.insert("b", Switch().name("y"));
+  switch_set.insert("b", Switch().name("z"));
+  IniConfigParser parser;
+  parser.threads(2).switch_set(switch_set).reject_unknown_switches(true);
+  EXPECT_FALSE(parser.ParseString(split));
+  EXPECT_EQ("Unknown switch a.z on line 30002", parser.error());
+  switch_set.insert("a", Switch().name("z"));
+  parser.switch_set(switch_set);
+  ASSERT_TRUE(parser.ParseString(split)) << parser.error();
+  EXPECT_EQ(70000, parser.values().group("a").repeated_value("z").size());
 
+  // and are converted to the type of its switch
+  SwitchSet typed_switch_set;
+  typed_switch_set.insert("a",
+    Switch().name("z").append().type(Value::kTypeInt));
+  parser.switch_set(typed_switch_set).reject_unknown_switches(false);
+  ASSERT_TRUE(parser.ParseString(split)) << parser.error();
+  EXPECT_EQ(Value::kTypeInt,
+    parser.values().group("a").repeated_value("z")[69999].type());
+
+  // Parsing a file splits it in the same way
+  FilePath path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&path));
+  file_util::WriteFile(path, contents.data(), contents.size());
+  IniConfigParser file_parser;
+  file_parser.threads(3);
+  ASSERT_TRUE(file_parser.Parse(PathToString(path))) << file_parser.error();
+  ExpectSameGroups(sequential.values(), file_parser.values());
+  file_util::Delete(path, false);
+}
+
+TEST_F(IniConfigParserTest, Lazy) {
+  IniConfigParser parser;
+  parser.lazy(true);
+  ASSERT_TRUE(parser.ParseString(kConfig)) << parser.error();
+  CheckConfig(parser.values());
+
+  // A section which appears twice is loaded from both places
+  ASSERT_TRUE(parser.ParseString("[a]\nx = 1\n[b]\ny = 2\n [a] \nx = 3\n"));
+  EXPECT_EQ(2, parser.values().groups().size());
+  ASSERT_EQ(2, parser.values().group("a").repeated_value("x").size());
+  EXPECT_EQ(3, parser.values().group("a").repeated_value("x")[1].AsInt());
+
+  // Only the headers and the keys before them are checked up front; a bad
+  // line in a section ends it when it is read.  Brackets elsewhere in a line
+  // do not start a section.
+  const char kBroken[] =
+    "top = [1]\n"
+    "[a]\n"
+    "x = 1\n"
+    "freak\n"
+    "y = 2\n"
+    "; [c]\n"
+    "[b]\n"
+    "z = 3\n";
+  ASSERT_TRUE(parser.ParseString(kBroken)) << parser.error();
+  EXPECT_STREQ("[1]", parser.values().value("top"));
+  EXPECT_EQ(2, parser.values().groups().size());
+  EXPECT_EQ(1, parser.values().group("a").values().size());
+  EXPECT_EQ(3, parser.values().group("b").value("z").AsInt());
+  EXPECT_FALSE(parser.ParseString("a = b\n\n[ok]\n\n  [broken\n[c]\n"));
+  EXPECT_EQ("Invalid section header on line 5", parser.error());
+  EXPECT_TRUE(parser.values().has_group("ok"));
+  EXPECT_FALSE(parser.values().has_group("c"));
+  EXPECT_FALSE(parser.ParseString("a = b\nfreak\n[c]\n"));
+  EXPECT_EQ("Syntax error on line 2", parser.error());
+
+  // Unknown switches are rejected up front before the first header, and
+  // otherwise end their section
+  SwitchSet switch_set;
+  switch_set.insert(Switch().name("verbose"));
+  switch_set.insert("alice@example.net", Switch().name("name"));
+  switch_set.insert("__fallback__", Switch().name("name"));
+  parser.switch_set(switch_set).reject_unknown_switches(true);
+  ASSERT_TRUE(parser.ParseString(kConfig)) << parser.error();
+  EXPECT_EQ(1, parser.values().group("alice@example.net").values().size());
+  EXPECT_EQ(1, parser.values().group("bob@example.com").values().size());
+  EXPECT_FALSE(parser.ParseString("debug = 1\n[alice@example.net]\n"));
+  EXPECT_EQ("Unknown switch .debug on line 1", parser.error());
+  parser.reject_unknown_switches(false);
+
+  // The values outlive the parser and the text they were parsed from
+  ValueGroup values;
+  {
+    IniConfigParser temporary;
+    temporary.lazy(true);
+    ASSERT_TRUE(temporary.ParseString(std::string(kConfig)));
+    values = temporary.values();
+  }
+  CheckConfig(values);
+
+  FilePath path;
+  ASSERT_TRUE(file_util::CreateTemporaryFile(&path));
+  file_util::WriteFile(path, kConfig, sizeof(kConfig) - 1);
+  ASSERT_TRUE(parser.Parse(PathToString(path))) << parser.error();
+  CheckConfig(parser.values());
+  file_util::Delete(path, false);
+
+  // A section which is never read is never parsed
+  std::string contents = MakeLargeConfig();
+  int allocations = AllocationCount();
+  ASSERT_TRUE(parser.ParseString(contents));
+  int lazy_allocations = AllocationCount() - allocations;
+  EXPECT_EQ(700, parser.values().groups().size());
+  EXPECT_EQ(30,
+    parser.values().group("user1").repeated_value("alias").size());
+  IniConfigParser eager;
+  allocations = AllocationCount();
+  ASSERT_TRUE(eager.ParseString(contents));
+  EXPECT_LT(lazy_allocations * 5, AllocationCount() - allocations);
+  EXPECT_EQ(6, eager.values().group("user1").repeated_value("port").size());
+}
+
+TEST_F(IniConfigParserTest, Arena) {
+  Arena arena;
+  IniConfigParser parser;
+  parser.arena(&arena);
+  ASSERT_TRUE(parser.ParseString(kConfig));
+  EXPECT_EQ(&arena, parser.values().arena());
+  EXPECT_EQ(&arena, parser.values().group("bob@example.com").arena());
+  CheckConfig(parser.values());
+}
+
+}  // namespace yact
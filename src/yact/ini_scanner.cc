@@ -0,0 +1,268 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/ini_scanner.h"
+#include <string.h>
+#include "build/build_config.h"
+#include "base/logging.h"
+#include "base/string_util.h"
+
+// SSE2 is part of x86-64, and of 32-bit builds which ask for it.  The AVX2
+// kernel is compiled for its own target and only called once cpuid shows
+// the processor has AVX2, so the rest of the file needs no special flags.
+#if defined(ARCH_CPU_X86_FAMILY) && (defined(__SSE2__) || \
+    defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define YACT_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(YACT_HAS_SSE2) && defined(COMPILER_GCC) && (defined(__clang__) || \
+    __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define YACT_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+namespace yact {
+
+namespace {
+bool IsSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Returns the piece between `begin` and `end` without surrounding whitespace
+base::StringPiece Trim(const char * begin, const char * end) {
+  while (begin != end && IsSpace(*begin)) {
+    ++begin;
+  }
+  while (end != begin && IsSpace(end[-1])) {
+    --end;
+  }
+  return base::StringPiece(begin, end - begin);
+}
+
+// The index of the lowest set bit of `bits`, which must not be zero
+int LowestBit(uint64 bits) {
+#if defined(COMPILER_GCC)
+  return __builtin_ctzll(bits);
+#elif defined(COMPILER_MSVC) && defined(ARCH_CPU_X86_64)
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return index;
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+// Each kernel returns a bitmap of the line ends, comment markers and '=' signs
+// in the 64 bytes at `block`, with bit i set for block[i]
+
+uint64 ClassifyScalar(const char * block) {
+  uint64 bits = 0;
+  for (int i = 0; i < 64; ++i) {
+    char ch = block[i];
+    if (ch == '\n' || ch == '#' || ch == ';' || ch == '=') {
+      bits |= GG_ULONGLONG(1) << i;
+    }
+  }
+  return bits;
+}
+
+#if defined(YACT_HAS_SSE2)
+uint64 ClassifySse2(const char * block) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i hash = _mm_set1_epi8('#');
+  const __m128i semicolon = _mm_set1_epi8(';');
+  const __m128i equals = _mm_set1_epi8('=');
+  uint64 bits = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i chars = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(block + 16 * i));
+    __m128i matches = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(chars, newline),
+        _mm_cmpeq_epi8(chars, hash)),
+      _mm_or_si128(_mm_cmpeq_epi8(chars, semicolon),
+        _mm_cmpeq_epi8(chars, equals)));
+    bits |= static_cast<uint64>(_mm_movemask_epi8(matches)) << (16 * i);
+  }
+  return bits;
+}
+#endif  // YACT_HAS_SSE2
+
+#if defined(YACT_HAS_AVX2)
+__attribute__((target("avx2")))
+uint64 ClassifyAvx2(const char * block) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i hash = _mm256_set1_epi8('#');
+  const __m256i semicolon = _mm256_set1_epi8(';');
+  const __m256i equals = _mm256_set1_epi8('=');
+  uint64 bits = 0;
+  for (int i = 0; i < 2; ++i) {
+    __m256i chars = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i *>(block + 32 * i));
+    __m256i matches = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(chars, newline),
+        _mm256_cmpeq_epi8(chars, hash)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(chars, semicolon),
+        _mm256_cmpeq_epi8(chars, equals)));
+    bits |= static_cast<uint64>(static_cast<uint32>(
+      _mm256_movemask_epi8(matches))) << (32 * i);
+  }
+  return bits;
+}
+#endif  // YACT_HAS_AVX2
+
+typedef uint64 (*ClassifyFunction)(const char * block);
+
+ClassifyFunction GetKernel(IniScanner::Kernel kernel) {
+  switch (kernel) {
+#if defined(YACT_HAS_AVX2)
+    case IniScanner::kKernelAvx2:
+      return ClassifyAvx2;
+#endif
+#if defined(YACT_HAS_SSE2)
+    case IniScanner::kKernelSse2:
+      return ClassifySse2;
+#endif
+    default:
+      return ClassifyScalar;
+  }
+}
+}  // anonymous namespace
+
+IniScanner::IniScanner(const base::StringPiece & contents, int first_line)
+  : position_(contents.data()),
+    end_(contents.data() + contents.size()),
+    line_(first_line),
+    classify_(GetKernel(best_kernel())),
+    block_(NULL),
+    bits_(0) {
+}
+
+bool IniScanner::Next(IniToken * token) {
+  while (position_ != end_) {
+    // The '=' signs before the first line end or comment marker are the only
+    // structural bytes which do not end the content of the line
+    const char * begin = position_;
+    const char * equals = NULL;
+    const char * stop = NextStructural(begin);
+    while (stop != end_ && *stop == '=') {
+      if (!equals) {
+        equals = stop;
+      }
+      stop = NextStructural(stop + 1);
+    }
+    const char * end = stop;
+    if (end != end_ && *end != '\n') {
+      end = static_cast<const char *>(memchr(end, '\n', end_ - end));
+      if (!end) {
+        end = end_;
+      }
+    }
+    position_ = end == end_ ? end_ : end + 1;
+    int line = line_++;
+
+    while (begin != stop && IsSpace(*begin)) {
+      ++begin;
+    }
+    while (stop != begin && IsSpace(stop[-1])) {
+      --stop;
+    }
+    if (stop == begin) {
+      continue;
+    }
+
+    token->line = line;
+    if (*begin == '[') {
+      token->type = IniToken::kSection;
+      token->name.clear();
+      token->value.clear();
+      if (stop - begin >= 2 && stop[-1] == ']') {
+        token->name = Trim(begin + 1, stop - 1);
+      }
+      if (token->name.empty()) {
+        error_ = StringPrintf("Invalid section header on line %d", line);
+        return false;
+      }
+      return true;
+    }
+    if (!equals) {
+      error_ = StringPrintf("Syntax error on line %d", line);
+      return false;
+    }
+    token->type = IniToken::kKeyValue;
+    token->name = Trim(begin, equals);
+    token->value = Trim(equals + 1, stop);
+    if (token->name.empty()) {
+      error_ = StringPrintf("Missing key on line %d", line);
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+const StringType & IniScanner::error() const {
+  return error_;
+}
+
+// static
+IniScanner::Kernel IniScanner::best_kernel() {
+#if defined(YACT_HAS_AVX2)
+  if (__builtin_cpu_supports("avx2")) {
+    return kKernelAvx2;
+  }
+#endif
+#if defined(YACT_HAS_SSE2)
+  return kKernelSse2;
+#else
+  return kKernelScalar;
+#endif
+}
+
+void IniScanner::set_kernel(Kernel kernel) {
+  DCHECK_LE(kernel, best_kernel());
+  classify_ = GetKernel(kernel);
+}
+
+const char * IniScanner::NextStructural(const char * from) {
+  while (from != end_) {
+    if (!block_ || from < block_ || from - block_ >= 64) {
+      Classify(from);
+    }
+    uint64 bits = bits_ & (~GG_ULONGLONG(0) << (from - block_));
+    if (bits) {
+      return block_ + LowestBit(bits);
+    }
+    if (end_ - block_ <= 64) {
+      break;
+    }
+    from = block_ + 64;
+  }
+  return end_;
+}
+
+void IniScanner::Classify(const char * block) {
+  block_ = block;
+  if (end_ - block >= 64) {
+    bits_ = classify_(block);
+    return;
+  }
+
+  // The kernels read whole blocks, so the end of the text is copied into one.
+  // The padding is not structural.
+  char padded[64];
+  memset(padded, 0, sizeof(padded));
+  memcpy(padded, block, end_ - block);
+  bits_ = classify_(padded);
+}
+
+}  // namespace yact
@@ -0,0 +1,97 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_INI_SCANNER_H_
+#define YACT_INI_SCANNER_H_
+
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
+namespace yact {
+
+// A section header or key/value pair of an INI file.  The pieces point into
+// the text being scanned.
+struct IniToken {
+  enum Type {
+    kSection,
+    kKeyValue
+  };
+
+  Type type;
+
+  // The name of the section, or the key
+  base::StringPiece name;
+
+  // The value, or empty for a section
+  base::StringPiece value;
+
+  // The number of the line, counting from one
+  int line;
+};
+
+// Splits the text of an INI file into section headers and key/value pairs in
+// a single pass, without copying or allocating.  The text is classified 64
+// bytes at a time into a bitmap of the line ends, comment markers and '='
+// signs, using SSE2 or AVX2 where the processor has them, and the scanner
+// jumps from one marked byte to the next instead of testing every byte.
+//
+// Lines end with "\n" or "\r\n".  A '#' or ';' starts a comment which runs to
+// the end of the line, wherever it appears.  Section headers are written
+// "[name]" and pairs "key = value".  Whitespace around names, keys and values
+// is ignored, and blank lines are skipped.
+class IniScanner {
+ public:
+  // The ways of classifying a block of text, slowest first
+  enum Kernel {
+    kKernelScalar,
+    kKernelSse2,
+    kKernelAvx2
+  };
+
+  // Scans `contents`, which must outlive this object.  `first_line` is the
+  // number of its first line.
+  explicit IniScanner(const base::StringPiece & contents, int first_line = 1);
+
+  // Stores the next section header or key/value pair in `token` and returns
+  // true, or returns false at the end of the text or if a line is malformed,
+  // in which case error() is set and token->line is that of the bad line.
+  bool Next(IniToken * token);
+
+  // A description of the problem if Next() failed, otherwise empty.
+  const StringType & error() const;
+
+  // The best kernel which this processor supports, which new scanners use
+  static Kernel best_kernel();
+
+  // Selects the kernel to classify blocks with, which must be no better than
+  // best_kernel(), for testing and benchmarking.  Takes effect from the next
+  // block.
+  void set_kernel(Kernel kernel);
+
+ private:
+  // Returns the first line end, comment marker or '=' at or after `from`, or
+  // end_ if there is none
+  const char * NextStructural(const char * from);
+
+  // Classifies the 64 bytes from `block`, or the rest of the text if that is
+  // shorter
+  void Classify(const char * block);
+
+  const char * position_;
+  const char * end_;
+  int line_;
+  StringType error_;
+
+  uint64 (*classify_)(const char * block);
+
+  // The block last classified, and a bit for each structural byte in it
+  const char * block_;
+  uint64 bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(IniScanner);
+};
+
+}  // namespace yact
+
+#endif  // YACT_INI_SCANNER_H_
@@ -0,0 +1,112 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "base/string_number_conversions.h"
+#include "yact/ini_scanner.h"
+
+namespace yact {
+
+class IniScannerTest : public BaseTest {
+ public:
+  // Returns the tokens of `contents` joined by '|', such as "3:[name]" for a
+  // section on line 3 and "4:key=value" for a pair, or "ERROR: ..."
+  std::string Scan(const base::StringPiece & contents,
+      IniScanner::Kernel kernel = IniScanner::best_kernel()) {
+    IniScanner scanner(contents);
+    scanner.set_kernel(kernel);
+    std::string rv;
+    IniToken token;
+    while (scanner.Next(&token)) {
+      if (!rv.empty()) {
+        rv += "|";
+      }
+      rv += base::IntToString(token.line) + ":";
+      if (token.type == IniToken::kSection) {
+        rv += "[" + token.name.as_string() + "]";
+      } else {
+        rv += token.name.as_string() + "=" + token.value.as_string();
+      }
+    }
+    if (!scanner.error().empty()) {
+      return "ERROR: " + scanner.error();
+    }
+    return rv;
+  }
+};
+
+TEST_F(IniScannerTest, Tokens) {
+  EXPECT_EQ("", Scan(""));
+  EXPECT_EQ("", Scan(" \n\t\r\n  "));
+  EXPECT_EQ("1:a=b", Scan("a=b"));
+  EXPECT_EQ("1:a=b|2:[s]|3:c=", Scan("  a =  b \n[ s ]\r\nc=\n"));
+  EXPECT_EQ("1:a=b=c", Scan("a = b=c"));
+  EXPECT_EQ("2:url=http://x", Scan("\nurl = http://x # home"));
+  EXPECT_EQ("3:[s]", Scan("# a = b\n ; [t]\n[s] ; section"));
+}
+
+TEST_F(IniScannerTest, Errors) {
+  EXPECT_EQ("ERROR: Syntax error on line 2", Scan("a=b\nfreak\nc=d"));
+  EXPECT_EQ("ERROR: Missing key on line 1", Scan(" = b"));
+  EXPECT_EQ("ERROR: Invalid section header on line 1", Scan("[s"));
+  EXPECT_EQ("ERROR: Invalid section header on line 1", Scan("["));
+  EXPECT_EQ("ERROR: Invalid section header on line 3", Scan("\n\n[ ]"));
+}
+
+TEST_F(IniScannerTest, LongLines) {
+  std::string key(100, 'k');
+  std::string value(200, 'v');
+  std::string comment(300, '=');
+  EXPECT_EQ("1:" + key + "=" + value + "|2:a=b",
+    Scan(key + " = " + value + " ;" + comment + "\na=b"));
+  EXPECT_EQ("2:a=" + value, Scan(";" + comment + "\na=" + value));
+}
+
+TEST_F(IniScannerTest, KernelsAgree) {
+  // Random lines of every kind and of many lengths, so that tokens start and
+  // end at every offset within a block
+  const char * const kPieces[] = {"a", "key", " ", "\t", "=", "==", "#", ";",
+    "[", "]", "\r", "value with spaces"};
+  srand(1);
+  for (int trial = 0; trial < 200; ++trial) {
+    std::string contents;
+    int lines = rand() % 20;
+    for (int line = 0; line < lines; ++line) {
+      if (rand() % 4 == 0) {
+        contents += "[section " + base::IntToString(rand()) + "]";
+      } else {
+        contents += std::string(rand() % 70, 'k') + "=";
+      }
+      int pieces = rand() % 8;
+      for (int i = 0; i < pieces; ++i) {
+        contents += kPieces[rand() % arraysize(kPieces)];
+      }
+      contents += "\n";
+    }
+    std::string expected = Scan(contents, IniScanner::kKernelScalar);
+    for (int kernel = IniScanner::kKernelScalar + 1;
+        kernel <= IniScanner::best_kernel(); ++kernel) {
+      EXPECT_EQ(expected, Scan(contents,
+        static_cast<IniScanner::Kernel>(kernel))) << contents;
+    }
+  }
+}
+
+TEST_F(IniScannerTest, TokensAreNotCopied) {
+  const char * contents = "[section]\nkey = value";
+  IniScanner scanner(base::StringPiece(contents), 10);
+  IniToken token;
+  ASSERT_TRUE(scanner.Next(&token));
+  EXPECT_EQ(contents + 1, token.name.data());
+  EXPECT_EQ(10, token.line);
+  int allocations = AllocationCount();
+  ASSERT_TRUE(scanner.Next(&token));
+  EXPECT_EQ(contents + 10, token.name.data());
+  EXPECT_EQ(contents + 16, token.value.data());
+  EXPECT_EQ(11, token.line);
+  EXPECT_FALSE(scanner.Next(&token));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+}
+
+}  // namespace yact
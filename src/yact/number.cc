@@ -0,0 +1,580 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/number.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <limits>
+#include "base/logging.h"
+#include "base/port.h"
+#include "base/string_number_conversions.h"
+#include "base/third_party/dmg_fp/dmg_fp.h"
+
+namespace yact {
+namespace {
+
+// Every power of ten which a double represents exactly
+const double kExactPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+  1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Integers up to 2^53 are exact in a double
+const uint64 kMaxExactMantissa = GG_UINT64_C(1) << 53;
+
+struct Unit {
+  const char * name;
+  int64 scale;
+};
+
+// Largest first, which is the order FormatDuration() tries them in
+const Unit kDurationUnits[] = {
+  { "d", GG_INT64_C(86400000000) },
+  { "h", GG_INT64_C(3600000000) },
+  { "m", GG_INT64_C(60000000) },
+  { "s", GG_INT64_C(1000000) },
+  { "ms", GG_INT64_C(1000) },
+  { "us", GG_INT64_C(1) }
+};
+
+// Largest first within the binary and the decimal units, which is the order
+// FormatByteSize() tries them in
+const Unit kByteSizeUnits[] = {
+  { "PiB", GG_INT64_C(1) << 50 },
+  { "TiB", GG_INT64_C(1) << 40 },
+  { "GiB", GG_INT64_C(1) << 30 },
+  { "MiB", GG_INT64_C(1) << 20 },
+  { "KiB", GG_INT64_C(1) << 10 },
+  { "PB", GG_INT64_C(1000000000000000) },
+  { "TB", GG_INT64_C(1000000000000) },
+  { "GB", GG_INT64_C(1000000000) },
+  { "MB", GG_INT64_C(1000000) },
+  { "kB", GG_INT64_C(1000) },
+  { "P", GG_INT64_C(1) << 50 },
+  { "T", GG_INT64_C(1) << 40 },
+  { "G", GG_INT64_C(1) << 30 },
+  { "M", GG_INT64_C(1) << 20 },
+  { "K", GG_INT64_C(1) << 10 },
+  { "B", 1 }
+};
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool UnitEquals(const base::StringPiece & name, const char * unit,
+    bool case_sensitive) {
+  size_t i = 0;
+  for (; i < name.size() && unit[i]; ++i) {
+    char c = name[i];
+    char u = unit[i];
+    if (!case_sensitive) {
+      c = tolower(static_cast<unsigned char>(c));
+      u = tolower(static_cast<unsigned char>(u));
+    }
+    if (c != u) {
+      return false;
+    }
+  }
+  return i == name.size() && !unit[i];
+}
+
+const Unit * FindUnit(const Unit * units, size_t count,
+    const base::StringPiece & name, bool case_sensitive) {
+  for (size_t i = 0; i < count; ++i) {
+    if (UnitEquals(name, units[i].name, case_sensitive)) {
+      return &units[i];
+    }
+  }
+  return NULL;
+}
+
+// Reads digits with an optional fraction from `value` at `*pos`, e.g. "1.5".
+// The fraction is kept as the fraction of the next unit, so "1.5" yields
+// *integer = 1 and *fraction = 0.5.  Digits of the fraction beyond the
+// precision of a double are ignored.
+bool ReadDecimal(const base::StringPiece & value, size_t * pos,
+    uint64 * integer, double * fraction) {
+  size_t i = *pos;
+  bool any_digits = false;
+  uint64 rv = 0;
+  for (; i < value.size() && IsDigit(value[i]); ++i) {
+    unsigned digit = value[i] - '0';
+    if (rv > (kuint64max - digit) / 10) {
+      return false;
+    }
+    rv = rv * 10 + digit;
+    any_digits = true;
+  }
+  uint64 numerator = 0;
+  int fraction_digits = 0;
+  if (i < value.size() && value[i] == '.') {
+    for (++i; i < value.size() && IsDigit(value[i]); ++i) {
+      if (fraction_digits < 18) {
+        numerator = numerator * 10 + (value[i] - '0');
+        ++fraction_digits;
+      }
+      any_digits = true;
+    }
+  }
+  if (!any_digits) {
+    return false;
+  }
+  *pos = i;
+  *integer = rv;
+  *fraction = fraction_digits ?
+    static_cast<double>(numerator) / pow(10.0, fraction_digits) : 0;
+  return true;
+}
+
+// Computes integer * scale + fraction * scale into *total, rounding the
+// fractional part to the nearest unit.  Returns false on overflow.
+bool AddScaled(uint64 integer, double fraction, int64 scale, int64 * total) {
+  if (integer > static_cast<uint64>((kint64max - *total) / scale)) {
+    return false;
+  }
+  *total += static_cast<int64>(integer) * scale;
+  int64 part = static_cast<int64>(fraction * scale + 0.5);
+  if (part > kint64max - *total) {
+    return false;
+  }
+  *total += part;
+  return true;
+}
+
+// Enough significant digits to round any decimal number correctly.  Once
+// this many have been kept, the remaining digits only matter through whether
+// any of them is nonzero.
+const int kMaxSlowDigits = 768;
+
+// Accepts "inf", "infinity" and "nan" in any case, after an optional sign
+bool ParseSpecialDouble(const base::StringPiece & value,
+    double * double_value) {
+  base::StringPiece name(value);
+  bool negative = false;
+  if (!name.empty() && (name[0] == '-' || name[0] == '+')) {
+    negative = name[0] == '-';
+    name.remove_prefix(1);
+  }
+  double rv;
+  if (UnitEquals(name, "inf", false) || UnitEquals(name, "infinity", false)) {
+    rv = std::numeric_limits<double>::infinity();
+  } else if (UnitEquals(name, "nan", false)) {
+    rv = std::numeric_limits<double>::quiet_NaN();
+  } else {
+    return false;
+  }
+  *double_value = negative ? -rv : rv;
+  return true;
+}
+
+// strtod() wants a terminated string.  `value` has already been checked by
+// ParseDouble(), so it is rewritten on the stack as a sign, at most
+// kMaxSlowDigits significant digits and an exponent.  Digits beyond those are
+// replaced by a single '1' if any of them is nonzero, which keeps the
+// rounding direction.
+bool ParseDoubleSlow(const base::StringPiece & value, double * double_value) {
+  char buffer[kMaxSlowDigits + 32];
+  size_t length = 0;
+  size_t i = 0;
+  if (value[i] == '-' || value[i] == '+') {
+    if (value[i] == '-') {
+      buffer[length++] = '-';
+    }
+    ++i;
+  }
+  int digits = 0;
+  int exponent = 0;
+  bool in_fraction = false;
+  bool truncated_nonzero = false;
+  for (; i < value.size(); ++i) {
+    char c = value[i];
+    if (c == '.') {
+      in_fraction = true;
+      continue;
+    }
+    if (!IsDigit(c)) {
+      break;
+    }
+    if (digits == 0 && c == '0') {
+      if (in_fraction) {
+        --exponent;
+      }
+    } else if (digits < kMaxSlowDigits) {
+      buffer[length++] = c;
+      ++digits;
+      if (in_fraction) {
+        --exponent;
+      }
+    } else {
+      truncated_nonzero |= c != '0';
+      if (!in_fraction) {
+        ++exponent;
+      }
+    }
+  }
+  if (digits == 0) {
+    buffer[length++] = '0';
+  }
+  if (truncated_nonzero) {
+    buffer[length++] = '1';
+    --exponent;
+  } else {
+    // dmg_fp::strtod() misrounds halfway cases which are followed by zeros
+    // and an exponent, so they are moved into the exponent
+    for (; digits > 1 && buffer[length - 1] == '0'; --digits) {
+      --length;
+      ++exponent;
+    }
+  }
+  if (i < value.size()) {
+    DCHECK(value[i] == 'e' || value[i] == 'E');
+    ++i;
+    bool negative_exponent = false;
+    if (value[i] == '-' || value[i] == '+') {
+      negative_exponent = value[i] == '-';
+      ++i;
+    }
+    int explicit_exponent = 0;
+    for (; i < value.size(); ++i) {
+      if (explicit_exponent < 100000) {
+        explicit_exponent = explicit_exponent * 10 + (value[i] - '0');
+      }
+    }
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+  snprintf(buffer + length, sizeof(buffer) - length, "e%d", exponent);
+
+  char * end = NULL;
+  errno = 0;
+  *double_value = dmg_fp::strtod(buffer, &end);
+  return errno == 0 && *end == 0;
+}
+
+}  // anonymous namespace
+
+bool ParseInt64(const base::StringPiece & value, int64 * int64_value) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+    negative = value[i] == '-';
+    ++i;
+  }
+  if (i == value.size()) {
+    return false;
+  }
+  uint64 limit = negative ? static_cast<uint64>(kint64max) + 1 : kint64max;
+  uint64 rv = 0;
+  for (; i < value.size(); ++i) {
+    unsigned digit = value[i] - '0';
+    if (digit > 9 || rv > (limit - digit) / 10) {
+      return false;
+    }
+    rv = rv * 10 + digit;
+  }
+  *int64_value = negative ? static_cast<int64>(0 - rv) :
+    static_cast<int64>(rv);
+  return true;
+}
+
+bool ParseInt(const base::StringPiece & value, int * int_value) {
+  int64 rv;
+  if (!ParseInt64(value, &rv) || rv < kint32min || rv > kint32max) {
+    return false;
+  }
+  *int_value = static_cast<int>(rv);
+  return true;
+}
+
+bool ParseDouble(const base::StringPiece & value, double * double_value) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+    negative = value[i] == '-';
+    ++i;
+  }
+
+  // Gather up to 19 significant digits, which always fit in a uint64
+  uint64 mantissa = 0;
+  int significant_digits = 0;
+  int exponent = 0;
+  bool exact = true;
+  bool any_digits = false;
+  bool in_fraction = false;
+  for (; i < value.size(); ++i) {
+    if (value[i] == '.' && !in_fraction) {
+      in_fraction = true;
+      continue;
+    }
+    if (!IsDigit(value[i])) {
+      break;
+    }
+    any_digits = true;
+    if (significant_digits < 19) {
+      mantissa = mantissa * 10 + (value[i] - '0');
+      if (mantissa) {
+        ++significant_digits;
+      }
+      if (in_fraction) {
+        --exponent;
+      }
+    } else {
+      // Left for strtod
+      exact = false;
+    }
+  }
+  if (!any_digits) {
+    // Perhaps "inf" or "nan", but never strtod() for text which has no digits
+    return ParseSpecialDouble(value, double_value);
+  }
+
+  if (i < value.size() && (value[i] == 'e' || value[i] == 'E')) {
+    ++i;
+    bool negative_exponent = false;
+    if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+      negative_exponent = value[i] == '-';
+      ++i;
+    }
+    if (i == value.size() || !IsDigit(value[i])) {
+      return false;
+    }
+    int explicit_exponent = 0;
+    for (; i < value.size() && IsDigit(value[i]); ++i) {
+      if (explicit_exponent < 100000) {
+        explicit_exponent = explicit_exponent * 10 + (value[i] - '0');
+      }
+    }
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+  if (i != value.size()) {
+    return false;
+  }
+
+  // Both the mantissa and the power of ten are exact, so one multiplication
+  // or division rounds correctly.
+  if (!exact || mantissa > kMaxExactMantissa || exponent < -22 ||
+      exponent > 22) {
+    return ParseDoubleSlow(value, double_value);
+  }
+  double rv = static_cast<double>(mantissa);
+  if (exponent < 0) {
+    rv /= kExactPowersOfTen[-exponent];
+  } else {
+    rv *= kExactPowersOfTen[exponent];
+  }
+  *double_value = negative ? -rv : rv;
+  return true;
+}
+
+bool ParseDuration(const base::StringPiece & value, int64 * microseconds) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+    negative = value[i] == '-';
+    ++i;
+  }
+  if (value.substr(i) == "0") {
+    *microseconds = 0;
+    return true;
+  }
+  if (i == value.size()) {
+    return false;
+  }
+
+  int64 total = 0;
+  while (i < value.size()) {
+    uint64 integer;
+    double fraction;
+    if (!ReadDecimal(value, &i, &integer, &fraction)) {
+      return false;
+    }
+    size_t unit_begin = i;
+    while (i < value.size() && !IsDigit(value[i]) && value[i] != '.') {
+      ++i;
+    }
+    const Unit * unit = FindUnit(kDurationUnits, arraysize(kDurationUnits),
+      value.substr(unit_begin, i - unit_begin), true);
+    if (!unit || !AddScaled(integer, fraction, unit->scale, &total)) {
+      return false;
+    }
+  }
+  *microseconds = negative ? -total : total;
+  return true;
+}
+
+bool ParseByteSize(const base::StringPiece & value, int64 * bytes) {
+  size_t i = 0;
+  uint64 integer;
+  double fraction;
+  if (!ReadDecimal(value, &i, &integer, &fraction)) {
+    return false;
+  }
+  int64 scale = 1;
+  if (i < value.size()) {
+    const Unit * unit = FindUnit(kByteSizeUnits, arraysize(kByteSizeUnits),
+      value.substr(i), false);
+    if (!unit) {
+      return false;
+    }
+    scale = unit->scale;
+  }
+  int64 total = 0;
+  if (!AddScaled(integer, fraction, scale, &total)) {
+    return false;
+  }
+  *bytes = total;
+  return true;
+}
+
+bool ParseValue(const base::StringPiece & text, Value * value) {
+  switch (value->type()) {
+    case Value::kTypeAuto:
+    case Value::kTypeString:
+      value->set(text.data(), text.size());
+      return true;
+    case Value::kTypeInt:
+      {
+        int int_value;
+        if (!ParseInt(text, &int_value)) {
+          return false;
+        }
+        value->set(int_value);
+        return true;
+      }
+    case Value::kTypeInt64:
+      {
+        int64 int64_value;
+        if (!ParseInt64(text, &int64_value)) {
+          return false;
+        }
+        value->set(int64_value);
+        return true;
+      }
+    case Value::kTypeDouble:
+      {
+        double double_value;
+        if (!ParseDouble(text, &double_value)) {
+          return false;
+        }
+        value->set(double_value);
+        return true;
+      }
+    case Value::kTypeDuration:
+      {
+        int64 microseconds;
+        if (!ParseDuration(text, &microseconds)) {
+          return false;
+        }
+        *value = Value::Duration(microseconds);
+        return true;
+      }
+    case Value::kTypeByteSize:
+      {
+        int64 bytes;
+        if (!ParseByteSize(text, &bytes)) {
+          return false;
+        }
+        *value = Value::ByteSize(bytes);
+        return true;
+      }
+    default:
+      NOTREACHED();
+      return false;
+  }
+}
+
+int SwitchValueType(const Switch & switch_) {
+  switch (switch_.action()) {
+    case Switch::kActionStore:
+    case Switch::kActionAppend:
+    case Switch::kActionStoreConstant:
+      return switch_.type();
+    case Switch::kActionStoreTrue:
+    case Switch::kActionStoreFalse:
+      return Value::kTypeBool;
+    case Switch::kActionCount:
+      return Value::kTypeInt;
+    default:
+      NOTREACHED();
+      return Value::kTypeAuto;
+  }
+}
+
+Value EmptyValue(int type) {
+  switch (type) {
+    case Value::kTypeAuto:
+      return Value();
+    case Value::kTypeString:
+      return Value(kEmptyString);
+    case Value::kTypeInt:
+      return Value(0);
+    case Value::kTypeBool:
+      return Value(false);
+    case Value::kTypeInt64:
+      return Value(static_cast<int64>(0));
+    case Value::kTypeDouble:
+      return Value(0.0);
+    case Value::kTypeDuration:
+      return Value::Duration(0);
+    case Value::kTypeByteSize:
+      return Value::ByteSize(0);
+    default:
+      NOTREACHED();
+      return Value();
+  }
+}
+
+const char * DescribeType(int type) {
+  switch (type) {
+    case Value::kTypeAuto:
+    case Value::kTypeString:
+      return "a string";
+    case Value::kTypeInt:
+      return "an integer";
+    case Value::kTypeBool:
+      return "a boolean";
+    case Value::kTypeInt64:
+      return "a 64-bit integer";
+    case Value::kTypeDouble:
+      return "a number";
+    case Value::kTypeDuration:
+      return "a duration";
+    case Value::kTypeByteSize:
+      return "a byte size";
+    default:
+      NOTREACHED();
+      return "a value";
+  }
+}
+
+StringType FormatDuration(int64 microseconds) {
+  if (microseconds == 0) {
+    return "0s";
+  }
+  for (size_t i = 0; i < arraysize(kDurationUnits); ++i) {
+    if (microseconds % kDurationUnits[i].scale == 0) {
+      return base::Int64ToString(microseconds / kDurationUnits[i].scale) +
+        kDurationUnits[i].name;
+    }
+  }
+  NOTREACHED();
+  return StringType();
+}
+
+StringType FormatByteSize(int64 bytes) {
+  if (bytes == 0) {
+    return "0B";
+  }
+  for (size_t i = 0; i < arraysize(kByteSizeUnits); ++i) {
+    if (bytes % kByteSizeUnits[i].scale == 0) {
+      return base::Int64ToString(bytes / kByteSizeUnits[i].scale) +
+        kByteSizeUnits[i].name;
+    }
+  }
+  NOTREACHED();
+  return StringType();
+}
+
+}  // namespace yact
@@ -0,0 +1,60 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_NUMBER_H_
+#define YACT_NUMBER_H_
+
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
+namespace yact {
+
+// Parsers for the numeric Value types.  They accept the whole of `value` or
+// fail, never skip whitespace, and never allocate.
+
+// A decimal integer with an optional sign.  Fails on overflow.
+bool ParseInt64(const base::StringPiece & value, int64 * int64_value);
+bool ParseInt(const base::StringPiece & value, int * int_value);
+
+// A decimal floating point number, e.g. "1.5e6", or one of "inf", "infinity"
+// and "nan".  Numbers with at most 19 significant digits and a small exponent
+// are converted exactly with a single multiplication or division, others fall
+// back to strtod.
+bool ParseDouble(const base::StringPiece & value, double * double_value);
+
+// A sequence of decimal numbers, each with a unit, e.g. "250ms", "1.5s" or
+// "1h30m".  The units are us, ms, s, m, h and d.  A lone "0" needs no unit.
+// The result is in microseconds.
+bool ParseDuration(const base::StringPiece & value, int64 * microseconds);
+
+// A decimal number with an optional unit, e.g. "64MiB" or "1.5G".  As in
+// dd(1), the units K, M, G, T, P and their KiB, MiB... forms are powers of
+// 1024 while kB, MB, GB... are powers of 1000.  Units are case insensitive.
+bool ParseByteSize(const base::StringPiece & value, int64 * bytes);
+
+// Converts `text` to the type that *value already has, e.g. the type of the
+// Switch it was created from.  kTypeAuto and kTypeString values take the text
+// as it is.  *value must not be kTypeBool, whose meaning depends on the
+// action of the switch.
+bool ParseValue(const base::StringPiece & text, Value * value);
+
+// The type of the values `switch_` stores, which depends on its action
+int SwitchValueType(const Switch & switch_);
+
+// An empty value of `type`: zero, false or an empty string.  Unlike
+// Value(const Switch *) it keeps no reference to a Switch, and so is stored
+// inline.
+Value EmptyValue(int type);
+
+// Describes a Value::kType* for error messages, e.g. "a duration"
+const char * DescribeType(int type);
+
+// Formats durations and byte sizes using the largest unit which represents
+// them exactly, so that the result parses back to the same value.
+StringType FormatDuration(int64 microseconds);
+StringType FormatByteSize(int64 bytes);
+
+}  // namespace yact
+
+#endif  // YACT_NUMBER_H_
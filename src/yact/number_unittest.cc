@@ -0,0 +1,198 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include <limits>
+#include <string>
+#include "base/string_number_conversions.h"
+#include "yact/number.h"
+
+namespace yact {
+
+class NumberTest : public BaseTest {
+};
+
+TEST_F(NumberTest, ParseInt64) {
+  int64 value;
+  EXPECT_TRUE(ParseInt64("0", &value));
+  EXPECT_EQ(0, value);
+  EXPECT_TRUE(ParseInt64("-42", &value));
+  EXPECT_EQ(-42, value);
+  EXPECT_TRUE(ParseInt64("+42", &value));
+  EXPECT_EQ(42, value);
+  EXPECT_TRUE(ParseInt64("9223372036854775807", &value));
+  EXPECT_EQ(kint64max, value);
+  EXPECT_TRUE(ParseInt64("-9223372036854775808", &value));
+  EXPECT_EQ(kint64min, value);
+  EXPECT_FALSE(ParseInt64("9223372036854775808", &value));
+  EXPECT_FALSE(ParseInt64("", &value));
+  EXPECT_FALSE(ParseInt64("-", &value));
+  EXPECT_FALSE(ParseInt64(" 1", &value));
+  EXPECT_FALSE(ParseInt64("1 ", &value));
+  EXPECT_FALSE(ParseInt64("1.0", &value));
+
+  int int_value;
+  EXPECT_TRUE(ParseInt("-2147483648", &int_value));
+  EXPECT_EQ(kint32min, int_value);
+  EXPECT_FALSE(ParseInt("2147483648", &int_value));
+}
+
+TEST_F(NumberTest, ParseDouble) {
+  const char * const kInputs[] = {
+    "0", "1", "-1.5", "1.5e6", "1E-3", ".5", "5.", "0.1", "3.14159265358979",
+    "123456789012345678901234567890", "1e300", "2.2250738585072014e-308",
+    "0.000000000000000000000000001", "9007199254740993",
+    "0.00000000000000000000000000000000000000000000000000000000000000000001",
+    "1234567890123456789012345678901234567890123456789012345678901234.5e-10",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    double value;
+    double expected;
+    ASSERT_TRUE(ParseDouble(kInputs[i], &value)) << kInputs[i];
+    ASSERT_TRUE(base::StringToDouble(kInputs[i], &expected));
+    EXPECT_EQ(expected, value) << kInputs[i];
+  }
+
+  double value;
+  EXPECT_FALSE(ParseDouble("", &value));
+  EXPECT_FALSE(ParseDouble(".", &value));
+  EXPECT_FALSE(ParseDouble("1e", &value));
+  EXPECT_FALSE(ParseDouble("1.2.3", &value));
+  EXPECT_FALSE(ParseDouble(" 1", &value));
+  EXPECT_FALSE(ParseDouble("1x", &value));
+  EXPECT_FALSE(ParseDouble("1e400", &value));
+  EXPECT_FALSE(ParseDouble("hello", &value));
+  EXPECT_FALSE(ParseDouble("in", &value));
+  EXPECT_FALSE(ParseDouble("0x10", &value));
+
+  ASSERT_TRUE(ParseDouble("inf", &value));
+  EXPECT_EQ(std::numeric_limits<double>::infinity(), value);
+  ASSERT_TRUE(ParseDouble("-Infinity", &value));
+  EXPECT_EQ(-std::numeric_limits<double>::infinity(), value);
+  ASSERT_TRUE(ParseDouble("NaN", &value));
+  EXPECT_NE(value, value);
+
+  // 1 + 2^-53 is halfway between 1 and the next double and rounds to even.
+  // A nonzero digit far beyond those which are kept rounds it up instead.
+  const std::string halfway = "1.00000000000000011102230246251565404236316680"
+    "908203125" + std::string(1000, '0');
+  ASSERT_TRUE(ParseDouble(halfway, &value));
+  EXPECT_EQ(1.0, value);
+  ASSERT_TRUE(ParseDouble(halfway + "1", &value));
+  EXPECT_EQ(1.0000000000000002, value);
+  ASSERT_TRUE(ParseDouble(halfway + "1e2", &value));
+  EXPECT_EQ(100.00000000000002, value);
+}
+
+TEST_F(NumberTest, ParseDuration) {
+  int64 value;
+  EXPECT_TRUE(ParseDuration("250ms", &value));
+  EXPECT_EQ(250000, value);
+  EXPECT_TRUE(ParseDuration("5m", &value));
+  EXPECT_EQ(GG_INT64_C(300000000), value);
+  EXPECT_TRUE(ParseDuration("1h30m", &value));
+  EXPECT_EQ(GG_INT64_C(5400000000), value);
+  EXPECT_TRUE(ParseDuration("1.5s", &value));
+  EXPECT_EQ(1500000, value);
+  EXPECT_TRUE(ParseDuration("-2d", &value));
+  EXPECT_EQ(GG_INT64_C(-172800000000), value);
+  EXPECT_TRUE(ParseDuration("10us", &value));
+  EXPECT_EQ(10, value);
+  EXPECT_TRUE(ParseDuration("0", &value));
+  EXPECT_EQ(0, value);
+
+  EXPECT_FALSE(ParseDuration("", &value));
+  EXPECT_FALSE(ParseDuration("5", &value));
+  EXPECT_FALSE(ParseDuration("5 s", &value));
+  EXPECT_FALSE(ParseDuration("5S", &value));
+  EXPECT_FALSE(ParseDuration("s", &value));
+  EXPECT_FALSE(ParseDuration("1000000000d", &value));
+}
+
+TEST_F(NumberTest, ParseByteSize) {
+  int64 value;
+  EXPECT_TRUE(ParseByteSize("4096", &value));
+  EXPECT_EQ(4096, value);
+  EXPECT_TRUE(ParseByteSize("64MiB", &value));
+  EXPECT_EQ(64 << 20, value);
+  EXPECT_TRUE(ParseByteSize("64m", &value));
+  EXPECT_EQ(64 << 20, value);
+  EXPECT_TRUE(ParseByteSize("64MB", &value));
+  EXPECT_EQ(64000000, value);
+  EXPECT_TRUE(ParseByteSize("1.5K", &value));
+  EXPECT_EQ(1536, value);
+  EXPECT_TRUE(ParseByteSize("2TiB", &value));
+  EXPECT_EQ(GG_INT64_C(2) << 40, value);
+  EXPECT_TRUE(ParseByteSize("10b", &value));
+  EXPECT_EQ(10, value);
+
+  EXPECT_FALSE(ParseByteSize("", &value));
+  EXPECT_FALSE(ParseByteSize("-1", &value));
+  EXPECT_FALSE(ParseByteSize("MiB", &value));
+  EXPECT_FALSE(ParseByteSize("1 MiB", &value));
+  EXPECT_FALSE(ParseByteSize("1XB", &value));
+  EXPECT_FALSE(ParseByteSize("100000PiB", &value));
+}
+
+TEST_F(NumberTest, FormatRoundTrips) {
+  EXPECT_EQ("250ms", FormatDuration(250000));
+  EXPECT_EQ("90s", FormatDuration(90000000));
+  EXPECT_EQ("2h", FormatDuration(GG_INT64_C(7200000000)));
+  EXPECT_EQ("-3us", FormatDuration(-3));
+  EXPECT_EQ("0s", FormatDuration(0));
+  EXPECT_EQ("64MiB", FormatByteSize(64 << 20));
+  EXPECT_EQ("1kB", FormatByteSize(1000));
+  EXPECT_EQ("1001B", FormatByteSize(1001));
+
+  const int64 kDurations[] = {
+    1, 999, 1000, 61000000, GG_INT64_C(-86400000000)
+  };
+  for (size_t i = 0; i < arraysize(kDurations); ++i) {
+    int64 value;
+    ASSERT_TRUE(ParseDuration(FormatDuration(kDurations[i]), &value));
+    EXPECT_EQ(kDurations[i], value);
+  }
+}
+
+TEST_F(NumberTest, ParseValueDoesNotAllocate) {
+  Value duration = Value::Duration(0);
+  Value bytes = Value::ByteSize(0);
+  Value number(0.0);
+  Value short_string("");
+
+  int allocations = AllocationCount();
+  EXPECT_TRUE(ParseValue("1h30m", &duration));
+  EXPECT_TRUE(ParseValue("64MiB", &bytes));
+  EXPECT_TRUE(ParseValue("1.5e6", &number));
+  EXPECT_TRUE(ParseValue("short", &short_string));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  EXPECT_EQ(GG_INT64_C(5400000000), duration.AsDuration());
+  EXPECT_EQ(64 << 20, bytes.AsByteSize());
+  EXPECT_EQ(1.5e6, number.AsDouble());
+  EXPECT_EQ("short", short_string.AsString());
+  EXPECT_FALSE(ParseValue("soon", &duration));
+  EXPECT_STREQ("a duration", DescribeType(duration.type()));
+}
+
+TEST_F(NumberTest, ParseDoubleDoesNotAllocate) {
+  const std::string path = "/var/lib/some/service/with/a/rather/long/path/"
+    "to/its/configuration/file.conf";
+  const std::string digits = std::string(100, '1') + ".5e-20";
+  double value;
+
+  int allocations = AllocationCount();
+  EXPECT_FALSE(ParseDouble(path, &value));
+  EXPECT_TRUE(ParseDouble(digits, &value));
+  EXPECT_TRUE(ParseDouble("-inf", &value));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  // Assigning a long kTypeAuto string costs only the StringBuffer and its
+  // copy of the text
+  allocations = AllocationCount();
+  Value auto_value(path);
+  EXPECT_EQ(2, AllocationCount() - allocations);
+}
+
+}  // namespace yact
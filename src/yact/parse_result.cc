@@ -0,0 +1,178 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include <yact.h>
+#include "base/logging.h"
+#include "yact/response_file.h"
+
+namespace yact {
+
+ParseResult::ParseResult()
+  : storage_(NULL) {
+}
+
+ParseResult::ParseResult(const ParseResult & other)
+  : program_(other.program_),
+    error_(other.error_),
+    argument_views_(other.argument_views_),
+    arguments_(other.arguments_),
+    storage_(other.storage_),
+    values_(other.values_),
+    counts_(other.counts_),
+    tallies_(other.tallies_),
+    completions_(other.completions_) {
+  if (storage_) {
+    storage_->AddRef();
+  }
+  CopySlots(other);
+}
+
+ParseResult::~ParseResult() {
+  if (storage_ && storage_->Release()) {
+    delete storage_;
+  }
+}
+
+ParseResult & ParseResult::operator=(const ParseResult & other) {
+  if (this != &other) {
+    program_ = other.program_;
+    error_ = other.error_;
+    argument_views_ = other.argument_views_;
+    arguments_ = other.arguments_;
+    if (other.storage_) {
+      other.storage_->AddRef();
+    }
+    if (storage_ && storage_->Release()) {
+      delete storage_;
+    }
+    storage_ = other.storage_;
+    values_ = other.values_;
+    counts_ = other.counts_;
+    tallies_ = other.tallies_;
+    completions_ = other.completions_;
+    CopySlots(other);
+  }
+  return *this;
+}
+
+const StringType & ParseResult::program() const {
+  return program_;
+}
+
+const StringType & ParseResult::error() const {
+  return error_;
+}
+
+const std::vector<StringType> & ParseResult::arguments() const {
+  if (arguments_.size() != argument_views_.size()) {
+    arguments_.clear();
+    arguments_.reserve(argument_views_.size());
+    for (size_t i = 0; i < argument_views_.size(); ++i) {
+      arguments_.push_back(argument_views_[i].as_string());
+    }
+  }
+  return arguments_;
+}
+
+const std::vector<TextView> & ParseResult::argument_views() const {
+  return argument_views_;
+}
+
+const Value & ParseResult::value(const StringType & name) const {
+  return values_.value(name);
+}
+
+const ValueGroup::ValueList & ParseResult::repeated_value(
+    const StringType & name) const {
+  return values_.repeated_value(name);
+}
+
+const ValueGroup & ParseResult::values() const {
+  return values_;
+}
+
+const Value & ParseResult::value(int index) const {
+  DCHECK(index >= 0 && static_cast<size_t>(index) < slots_.size())
+    << "No switch with index " << index;
+  DCHECK(!slots_[index]->empty()) << "Switch " << index << " has no value";
+  return slots_[index]->front();
+}
+
+int ParseResult::int_value(int index) const {
+  return value(index).AsInt();
+}
+
+bool ParseResult::bool_value(int index) const {
+  return value(index).AsBool();
+}
+
+StringType ParseResult::string_value(int index) const {
+  return value(index).AsString();
+}
+
+Int64Type ParseResult::int64_value(int index) const {
+  return value(index).AsInt64();
+}
+
+double ParseResult::double_value(int index) const {
+  return value(index).AsDouble();
+}
+
+Int64Type ParseResult::duration_value(int index) const {
+  return value(index).AsDuration();
+}
+
+Int64Type ParseResult::byte_size_value(int index) const {
+  return value(index).AsByteSize();
+}
+
+int ParseResult::count(int index) const {
+  DCHECK(index >= 0 && static_cast<size_t>(index) < counts_.size())
+    << "No switch with index " << index;
+  return counts_[index];
+}
+
+const std::vector<StringType> & ParseResult::completions() const {
+  return completions_;
+}
+
+void ParseResult::Clear() {
+  program_.clear();
+  error_.clear();
+  argument_views_.clear();
+  arguments_.clear();
+  // Views held by copies of this result keep shared storage alive
+  if (storage_ && storage_->HasOneRef()) {
+    storage_->Clear();
+  } else if (storage_) {
+    if (storage_->Release()) {
+      delete storage_;
+    }
+    storage_ = NULL;
+  }
+  values_ = ValueGroup();
+  slots_.clear();
+  counts_.clear();
+  tallies_.clear();
+  completions_.clear();
+}
+
+void ParseResult::CopySlots(const ParseResult & other) {
+  // Both value maps hold the same names in the same order
+  typedef std::map<const ValueGroup::ValueList *,
+    const ValueGroup::ValueList *> SlotMap;
+  SlotMap copies;
+  ValueGroup::ValueMap::const_iterator from = other.values_.values().begin();
+  for (ValueGroup::ValueMap::const_iterator to = values_.values().begin();
+      to != values_.values().end(); ++to, ++from) {
+    copies[&from->second] = &to->second;
+  }
+
+  slots_.clear();
+  slots_.reserve(other.slots_.size());
+  for (size_t i = 0; i < other.slots_.size(); ++i) {
+    slots_.push_back(copies[other.slots_[i]]);
+  }
+}
+
+}  // namespace yact
@@ -0,0 +1,168 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/response_file.h"
+#include "base/file_path.h"
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "yact/string.h"
+
+namespace yact {
+
+namespace {
+bool IsSpace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' ||
+    ch == '\v';
+}
+}  // anonymous namespace
+
+ResponseFile::ResponseFile()
+  : begin_(NULL),
+    position_(NULL),
+    end_(NULL),
+    next_buffer_(0) {
+}
+
+ResponseFile::ResponseFile(const base::StringPiece & contents)
+  : begin_(contents.data()),
+    position_(contents.data()),
+    end_(contents.data() + contents.size()),
+    next_buffer_(0) {
+}
+
+bool ResponseFile::Open(const StringType & filename) {
+#if defined(OS_WIN)
+  FilePath path(StringToWide(filename));
+#else  // !OS_WIN
+  FilePath path(filename);
+#endif  // !OS_WIN
+  if (!file_.Initialize(path)) {
+    // An empty file cannot be mapped, but is a valid (empty) response file.
+    int64 size;
+    if (file_util::GetFileSize(path, &size) && size == 0) {
+      begin_ = position_ = end_ = NULL;
+      return true;
+    }
+    error_ = StringPrintf("cannot read response file '%s'", filename.c_str());
+    return false;
+  }
+  begin_ = position_ = reinterpret_cast<const char *>(file_.data());
+  end_ = position_ + file_.length();
+  return true;
+}
+
+bool ResponseFile::Next(base::StringPiece * arg) {
+  while (position_ != end_ && IsSpace(*position_)) {
+    ++position_;
+  }
+  if (position_ == end_) {
+    return false;
+  }
+
+  // The common case is an argument with nothing to unquote, which we return
+  // in place.
+  const char * start = position_;
+  while (position_ != end_ && !IsSpace(*position_) && *position_ != '\'' &&
+      *position_ != '"' && *position_ != '\\') {
+    ++position_;
+  }
+  if (position_ == end_ || IsSpace(*position_)) {
+    arg->set(start, position_ - start);
+    return true;
+  }
+
+  std::string & buffer = buffers_[next_buffer_];
+  next_buffer_ = 1 - next_buffer_;
+  buffer.assign(start, position_ - start);
+  char quote = 0;
+  while (position_ != end_) {
+    char ch = *position_;
+    if (quote == '\'') {
+      if (ch == '\'') {
+        quote = 0;
+      } else {
+        buffer.push_back(ch);
+      }
+    } else if (ch == '\\') {
+      if (position_ + 1 == end_) {
+        error_ = "response file ends with a backslash";
+        return false;
+      }
+      char next = position_[1];
+      if (next == '\n') {
+        ++position_;
+      } else if (quote != '"' || next == '$' || next == '`' || next == '"' ||
+          next == '\\') {
+        buffer.push_back(next);
+        ++position_;
+      } else {
+        buffer.push_back(ch);
+      }
+    } else if (quote == '"') {
+      if (ch == '"') {
+        quote = 0;
+      } else {
+        buffer.push_back(ch);
+      }
+    } else if (ch == '\'' || ch == '"') {
+      quote = ch;
+    } else if (IsSpace(ch)) {
+      break;
+    } else {
+      buffer.push_back(ch);
+    }
+    ++position_;
+  }
+  if (quote) {
+    error_ = StringPrintf("unterminated %c in response file", quote);
+    return false;
+  }
+  arg->set(buffer.data(), buffer.size());
+  return true;
+}
+
+const StringType & ResponseFile::error() const {
+  return error_;
+}
+
+ArgumentStorage::ArgumentStorage()
+  : ref_count_(1) {
+}
+
+ArgumentStorage::~ArgumentStorage() {
+  Clear();
+}
+
+const CharType * ArgumentStorage::CopyArgv(int argc, const CharType ** argv) {
+  size_t size = 0;
+  for (int i = 0; i < argc; ++i) {
+    size += std::char_traits<CharType>::length(argv[i]) + 1;
+  }
+  argv_.clear();
+  argv_.reserve(size);
+  for (int i = 0; i < argc; ++i) {
+    argv_.append(argv[i], std::char_traits<CharType>::length(argv[i]) + 1);
+  }
+  return argv_.data();
+}
+
+void ArgumentStorage::Keep(ResponseFile * response_file) {
+  response_files_.push_back(response_file);
+}
+
+base::StringPiece ArgumentStorage::Copy(const base::StringPiece & text) {
+  copies_.push_back(StringType());
+  text.CopyToString(&copies_.back());
+  return copies_.back();
+}
+
+void ArgumentStorage::Clear() {
+  argv_.clear();
+  for (size_t i = 0; i < response_files_.size(); ++i) {
+    delete response_files_[i];
+  }
+  response_files_.clear();
+  copies_.clear();
+}
+
+}  // namespace yact
@@ -0,0 +1,112 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_RESPONSE_FILE_H_
+#define YACT_RESPONSE_FILE_H_
+
+#include <yact.h>
+#include <deque>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/file_util.h"
+#include "base/string_piece.h"
+
+namespace yact {
+
+// Splits a response file (the `file` in `program @file`) into arguments one
+// at a time.  The file is memory mapped rather than read, and arguments are
+// found as they are requested, so the memory used does not depend on the
+// number of arguments in the file.
+//
+// Arguments are separated by whitespace.  As in a POSIX shell, text inside
+// single quotes is taken literally.  In unquoted text a backslash escapes the
+// character which follows it.  Inside double quotes it escapes only $, `, ",
+// a backslash or a newline and is otherwise kept, so "C:\dir" is C:\dir.  A
+// backslash before a newline joins the lines.
+class ResponseFile {
+ public:
+  ResponseFile();
+
+  // Tokenizes `contents`, which must outlive this object.
+  explicit ResponseFile(const base::StringPiece & contents);
+
+  // Maps `filename` and prepares to tokenize it.  Returns false if the file
+  // cannot be read.
+  bool Open(const StringType & filename);
+
+  // Stores the next argument in `arg` and returns true, or returns false at
+  // the end of the file or if the file is malformed, in which case error()
+  // is set.  An argument without quotes or escapes points directly into the
+  // mapped file.  Others are unquoted into a buffer which remains valid until
+  // the second following call to Next().
+  bool Next(base::StringPiece * arg);
+
+  // A description of the problem if Next() failed, otherwise empty.
+  const StringType & error() const;
+
+  // True if `arg`, returned by Next(), points into the file rather than into
+  // a buffer of this object.
+  bool Contains(const base::StringPiece & arg) const {
+    return arg.data() >= begin_ && arg.data() + arg.size() <= end_;
+  }
+
+ private:
+  file_util::MemoryMappedFile file_;
+  const char * begin_;
+  const char * position_;
+  const char * end_;
+  std::string buffers_[2];
+  int next_buffer_;
+  StringType error_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResponseFile);
+};
+
+// Holds the text which the free arguments of a ParseResult point into: a
+// copy of argv, the response files which free arguments were read from in
+// place, and copies of those which had quotes or escapes removed.  It is
+// reference counted so that copies of a ParseResult may share it.
+class ArgumentStorage {
+ public:
+  ArgumentStorage();
+  ~ArgumentStorage();
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  // Returns true if that was the last reference, and the caller must delete
+  // the storage
+  bool Release() {
+    return base::subtle::Barrier_AtomicIncrement(&ref_count_, -1) == 0;
+  }
+
+  bool HasOneRef() const {
+    return base::subtle::Acquire_Load(&ref_count_) == 1;
+  }
+
+  // Copies the `argc` strings of `argv` into one buffer, each followed by a
+  // nul, and returns it
+  const CharType * CopyArgv(int argc, const CharType ** argv);
+
+  // Takes ownership of `response_file`, which stays mapped until Clear()
+  void Keep(ResponseFile * response_file);
+
+  // Returns a copy of `text` which stays valid until Clear()
+  base::StringPiece Copy(const base::StringPiece & text);
+
+  // Discards the contents, keeping the argv buffer for reuse
+  void Clear();
+
+ private:
+  base::subtle::Atomic32 ref_count_;
+  StringType argv_;
+  std::vector<ResponseFile *> response_files_;
+  std::deque<StringType> copies_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArgumentStorage);
+};
+
+}  // namespace yact
+
+#endif  // YACT_RESPONSE_FILE_H_
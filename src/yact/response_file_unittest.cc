@@ -0,0 +1,85 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "yact/response_file.h"
+
+namespace yact {
+
+class ResponseFileTest : public BaseTest {
+ public:
+  // Returns the arguments of `contents` joined by '|', or "ERROR: ..."
+  std::string Tokenize(const char * contents) {
+    ResponseFile response_file(contents);
+    std::string rv;
+    base::StringPiece arg;
+    while (response_file.Next(&arg)) {
+      if (!rv.empty()) {
+        rv += "|";
+      }
+      arg.AppendToString(&rv);
+    }
+    if (!response_file.error().empty()) {
+      return "ERROR: " + response_file.error();
+    }
+    return rv;
+  }
+};
+
+TEST_F(ResponseFileTest, Whitespace) {
+  EXPECT_EQ("", Tokenize(""));
+  EXPECT_EQ("", Tokenize(" \n\t "));
+  EXPECT_EQ("a|b|c", Tokenize("a b\nc"));
+  EXPECT_EQ("--foo=bar|-x", Tokenize("  --foo=bar\r\n\t-x\n"));
+}
+
+TEST_F(ResponseFileTest, Quoting) {
+  EXPECT_EQ("a b|c", Tokenize("'a b' c"));
+  EXPECT_EQ("a b", Tokenize("\"a b\""));
+  EXPECT_EQ("foo=a b", Tokenize("foo='a b'"));
+  EXPECT_EQ("it's", Tokenize("\"it's\""));
+  EXPECT_EQ("say \"hi\"", Tokenize("'say \"hi\"'"));
+  EXPECT_EQ("a\\b", Tokenize("'a\\b'"));
+  EXPECT_EQ("a b|c", Tokenize("a\\ b c"));
+  EXPECT_EQ("\"", Tokenize("\"\\\"\""));
+  EXPECT_EQ("", Tokenize("''"));
+}
+
+TEST_F(ResponseFileTest, BackslashesInDoubleQuotes) {
+  // Only $, `, ", a backslash or a newline are escaped, as in a POSIX shell
+  EXPECT_EQ("C:\\dir\\x", Tokenize("\"C:\\dir\\x\""));
+  EXPECT_EQ("\\n", Tokenize("\"\\n\""));
+  EXPECT_EQ("$|`|\\|\"", Tokenize("\"\\$\" \"\\`\" \"\\\\\" \"\\\"\""));
+  EXPECT_EQ("ab", Tokenize("\"a\\\nb\""));
+
+  // Unquoted, a backslash escapes anything and joins lines
+  EXPECT_EQ("C:dirx", Tokenize("C:\\dir\\x"));
+  EXPECT_EQ("ab|c", Tokenize("a\\\nb c"));
+}
+
+TEST_F(ResponseFileTest, Errors) {
+  EXPECT_EQ("ERROR: unterminated ' in response file", Tokenize("a 'b"));
+  EXPECT_EQ("ERROR: unterminated \" in response file", Tokenize("\"b"));
+  EXPECT_EQ("ERROR: response file ends with a backslash", Tokenize("a\\"));
+}
+
+TEST_F(ResponseFileTest, UnquotedArgumentsAreNotCopied) {
+  const char * contents = "foo 'bar'";
+  ResponseFile response_file(contents);
+  base::StringPiece arg;
+  ASSERT_TRUE(response_file.Next(&arg));
+  EXPECT_EQ(contents, arg.data());
+  ASSERT_TRUE(response_file.Next(&arg));
+  EXPECT_EQ("bar", arg);
+  EXPECT_FALSE(response_file.Next(&arg));
+}
+
+TEST_F(ResponseFileTest, MissingFile) {
+  ResponseFile response_file;
+  EXPECT_FALSE(response_file.Open("/this/file/does/not/exist"));
+  EXPECT_EQ("cannot read response file '/this/file/does/not/exist'",
+    response_file.error());
+}
+
+}  // namespace yact
@@ -2,24 +2,36 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include <yact.h>
+#include "base/basictypes.h"
 #include "base/string_util.h"
+#include "yact/string.h"
 
 namespace yact {
 const StringType kEmptyString;
 
-bool StringToBool(const yact::StringType & value, bool * bool_value) {
-  if (LowerCaseEqualsASCII(value, "no") ||
-      LowerCaseEqualsASCII(value, "false") ||
-      LowerCaseEqualsASCII(value, "0") ||
-      LowerCaseEqualsASCII(value, "off")) {
+bool TextView::operator==(const CharType * other) const {
+  return std::char_traits<CharType>::length(other) == size_ &&
+    std::char_traits<CharType>::compare(data_, other, size_) == 0;
+}
+
+bool TextView::operator==(const StringType & other) const {
+  return other.size() == size_ &&
+    std::char_traits<CharType>::compare(data_, other.data(), size_) == 0;
+}
+
+bool StringToBool(const base::StringPiece & value, bool * bool_value) {
+  if (LowerCaseEqualsASCII(value.begin(), value.end(), "no") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "false") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "0") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "off")) {
     *bool_value = false;
     return true;
   }
 
-  if (LowerCaseEqualsASCII(value, "yes") ||
-      LowerCaseEqualsASCII(value, "true") ||
-      LowerCaseEqualsASCII(value, "1") ||
-      LowerCaseEqualsASCII(value, "on")) {
+  if (LowerCaseEqualsASCII(value.begin(), value.end(), "yes") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "true") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "1") ||
+      LowerCaseEqualsASCII(value.begin(), value.end(), "on")) {
     *bool_value = true;
     return true;
   }
@@ -27,6 +39,15 @@ bool StringToBool(const yact::StringType & value, bool * bool_value) {
   return false;
 }
 
+size_t HashString(const base::StringPiece & value) {
+  uint32 hash = 2166136261u;
+  for (size_t i = 0; i < value.size(); ++i) {
+    hash ^= static_cast<unsigned char>(value[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 std::wstring StringToWide(const StringType & value) {
 #if defined(YACT_STRING_WCHAR)
   return value;
@@ -5,10 +5,14 @@
 #define YACT_STRING_H_
 
 #include <yact.h>
-
+#include "base/string_piece.h"
 
 namespace yact {
-bool StringToBool(const yact::StringType & value, bool * bool_value);
+bool StringToBool(const base::StringPiece & value, bool * bool_value);
+
+// A fast, non-cryptographic hash (32-bit FNV-1a) for the lookup tables used
+// throughout yact.
+size_t HashString(const base::StringPiece & value);
 std::wstring StringToWide(const StringType & value);
 StringType WideToString(const std::wstring & value);
 }
@@ -2,84 +2,208 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include <yact.h>
+#include <algorithm>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/scoped_ptr.h"
 #include "base/string_util.h"
 
 namespace yact {
 
+// Owns a SwitchValidator on behalf of every Data which refers to it.
+class Switch::SharedValidator {
+ public:
+  explicit SharedValidator(SwitchValidator * validator)
+    : ref_count_(1),
+      validator_(validator) {
+  }
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  // Returns true if the last reference was released
+  bool Release() {
+    return base::subtle::Barrier_AtomicIncrement(&ref_count_, -1) == 0;
+  }
+
+  SwitchValidator * get() const { return validator_.get(); }
+
+ private:
+  base::subtle::Atomic32 ref_count_;
+  scoped_ptr<SwitchValidator> validator_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedValidator);
+};
+
+// The description of a switch.  A Data is shared by every Switch copied from
+// the one which created it and is not modified while it is shared.
+class Switch::Data {
+ public:
+  Data()
+    : ref_count_(1),
+      short_flag_(0),
+      action_(kActionStoreTrue),
+      type_(Value::kTypeAuto),
+      default__(false),
+      validator_(NULL) {
+  }
+
+  // Copies a shared description so that it can be modified
+  explicit Data(const Data & other)
+    : ref_count_(1),
+      names_(other.names_),
+      short_flag_(other.short_flag_),
+      action_(other.action_),
+      type_(other.type_),
+      dest_(other.dest_),
+      constant_(other.constant_),
+      default__(other.default__),
+      choices_(other.choices_),
+      help_(other.help_),
+      environment_variable_(other.environment_variable_),
+      validator_(other.validator_) {
+    if (validator_) {
+      validator_->AddRef();
+    }
+  }
+
+  ~Data() {
+    set_validator(NULL);
+  }
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  // Returns true if the last reference was released
+  bool Release() {
+    return base::subtle::Barrier_AtomicIncrement(&ref_count_, -1) == 0;
+  }
+
+  bool HasOneRef() const {
+    return base::subtle::Acquire_Load(&ref_count_) == 1;
+  }
+
+  // Returns a reference to a description which is never freed, for switches
+  // which have been moved from
+  static Data * Empty() {
+    static Data * empty = new Data;
+    empty->AddRef();
+    return empty;
+  }
+
+  void set_validator(SharedValidator * validator) {
+    if (validator_ && validator_->Release()) {
+      delete validator_;
+    }
+    validator_ = validator;
+  }
+
+  base::subtle::Atomic32 ref_count_;
+  std::vector<StringType> names_;
+  CharType short_flag_;
+  int action_;
+  int type_;
+  StringType dest_;
+  Value constant_;
+  Value default__;
+  std::vector<StringType> choices_;
+  StringType help_;
+  StringType environment_variable_;
+  SharedValidator * validator_;
+
+ private:
+  void operator=(const Data&);
+};
+
 Switch::Switch()
-  : validator_(NULL),
-    short_flag_(0) {
-  action(kActionStoreTrue);
+  : data_(new Data) {
 }
 
 Switch::Switch(const Switch & other)
-  : names_(other.names_),
-    short_flag_(other.short_flag_),
-    action_(other.action_),
-    dest_(other.dest_),
-    constant_(other.constant_),
-    default__(other.default__),
-    choices_(other.choices_),
-    help_(other.help_),
-    environment_variable_(other.environment_variable_),
-    validator_(NULL) {
-  // TODO(ross): copy validator
+  : data_(other.data_) {
+  data_->AddRef();
 }
 
 Switch& Switch::operator =(const Switch& other) {
-  names_ = other.names_;
-  short_flag_ = other.short_flag_;
-  action_ = other.action_;
-  dest_ = other.dest_;
-  constant_ = other.constant_;
-  default__ = other.default__;
-  choices_ = other.choices_;
-  help_ = other.help_;
-  environment_variable_ = other.environment_variable_;
-  validator_ = NULL;
-  // TODO(ross): copy validator
+  other.data_->AddRef();
+  if (data_->Release()) {
+    delete data_;
+  }
+  data_ = other.data_;
+  return *this;
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+Switch::Switch(Switch && other)
+  : data_(other.data_) {
+  other.data_ = Data::Empty();
+}
+
+Switch& Switch::operator =(Switch && other) {
+  swap(other);
   return *this;
 }
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
+void Switch::swap(Switch & other) {
+  std::swap(data_, other.data_);
+}
 
 Switch::~Switch() {
-  if (validator_) { delete validator_; }
+  if (data_->Release()) {
+    delete data_;
+  }
+}
+
+Switch::Data * Switch::MutableData() {
+  if (!data_->HasOneRef()) {
+    Data * data = new Data(*data_);
+    if (data_->Release()) {
+      delete data_;
+    }
+    data_ = data;
+  }
+  return data_;
 }
 
 const std::vector<StringType> & Switch::names() const {
-  return names_;
+  return data_->names_;
 }
 
 const StringType & Switch::name() const {
-  return names_[0];
+  return data_->names_[0];
 }
 
 Switch & Switch::name(const StringType & name) {
-  if (names_.empty()) {
-    DCHECK(dest_.empty());
-    DCHECK(environment_variable_.empty());
-    dest_ = name;
-    environment_variable_ = StringToUpperASCII(name);
+  Data * data = MutableData();
+  if (data->names_.empty()) {
+    DCHECK(data->dest_.empty());
+    DCHECK(data->environment_variable_.empty());
+    data->dest_ = name;
+    data->environment_variable_ = StringToUpperASCII(name);
   }
-  names_.push_back(name);
+  data->names_.push_back(name);
   return *this;
 }
 
 CharType Switch::short_flag() const {
-  return short_flag_;
+  return data_->short_flag_;
 }
 
 Switch & Switch::short_flag(CharType short_flag) {
-  short_flag_ = short_flag;
+  MutableData()->short_flag_ = short_flag;
   return *this;
 }
 
 int Switch::action() const {
-  return action_;
+  return data_->action_;
 }
 
 Switch & Switch::action(int action) {
-  action_ = action;
-  switch (action_) {
+  MutableData()->action_ = action;
+  switch (action) {
     case kActionStore:
       break;
     case kActionStoreTrue:
@@ -102,67 +226,76 @@ Switch & Switch::action(int action) {
   return *this;
 }
 
+int Switch::type() const {
+  return data_->type_;
+}
+
+Switch & Switch::type(int type) {
+  MutableData()->type_ = type;
+  return *this;
+}
+
 const StringType & Switch::dest() const {
-  return dest_;
+  return data_->dest_;
 }
 
 Switch & Switch::dest(const StringType & dest) {
-  dest_ = dest;
+  MutableData()->dest_ = dest;
   return *this;
 }
 
 const Value & Switch::constant() const {
-  return constant_;
+  return data_->constant_;
 }
 
 Switch & Switch::constant(const Value & constant) {
-  constant_ = constant;
+  MutableData()->constant_ = constant;
   return *this;
 }
 
 const Value & Switch::default_() const {
-  return default__;
+  return data_->default__;
 }
 
 Switch & Switch::default_(const Value & default_) {
-  default__ = default_;
+  MutableData()->default__ = default_;
   return *this;
 }
 
 const std::vector<StringType> & Switch::choices() const {
-  return choices_;
+  return data_->choices_;
 }
 
 Switch & Switch::choice(const StringType & choice) {
-  choices_.push_back(choice);
+  MutableData()->choices_.push_back(choice);
   return *this;
 }
 
 const StringType & Switch::help() const {
-  return help_;
+  return data_->help_;
 }
 
 Switch & Switch::help(const StringType & help) {
-  help_ = help;
+  MutableData()->help_ = help;
   return *this;
 }
 
 const StringType & Switch::environment_variable() const {
-  return environment_variable_;
+  return data_->environment_variable_;
 }
 
 Switch & Switch::environment_variable(const StringType & environment_variable) {
-  environment_variable_ = environment_variable;
+  MutableData()->environment_variable_ = environment_variable;
   return *this;
 }
 
 SwitchValidator * Switch::validator() const {
-  return validator_;
+  return data_->validator_ ? data_->validator_->get() : NULL;
 }
 
 Switch & Switch::validator(SwitchValidator * validator) {
-  if (validator_) { delete validator_; }
-  validator_ = validator;
+  MutableData()->set_validator(
+    validator ? new SharedValidator(validator) : NULL);
   return *this;
 }
 
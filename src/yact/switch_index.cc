@@ -0,0 +1,127 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/switch_index.h"
+#include <string.h>
+#include "base/logging.h"
+#include "yact/string.h"
+
+namespace yact {
+
+SwitchIndex::SwitchIndex(const SwitchSet::List & switches)
+  : first_(switches.empty() ? NULL : &switches[0]),
+    size_(switches.size()),
+    mask_(0),
+    trie_(switches) {
+  memset(short_flags_, 0, sizeof(short_flags_));
+  for (size_t i = 0; i < switches.size(); ++i) {
+    if (CharType ch = switches[i].short_flag()) {
+      AddShortFlag(ch, static_cast<int>(i));
+    }
+  }
+  IndexNames(switches);
+}
+
+SwitchIndex::SwitchIndex(const SwitchSet::List & switches,
+    const SwitchSpec * specs, size_t count)
+  : first_(switches.empty() ? NULL : &switches[0]),
+    size_(switches.size()),
+    mask_(0),
+    trie_(switches) {
+  DCHECK_EQ(count, switches.size());
+  memset(short_flags_, 0, sizeof(short_flags_));
+  for (size_t i = 0; i < count; ++i) {
+    if (specs[i].short_flag) {
+      AddShortFlag(specs[i].short_flag, static_cast<int>(i));
+    }
+  }
+  IndexNames(switches);
+}
+
+void SwitchIndex::IndexNames(const SwitchSet::List & switches) {
+  size_t name_count = 0;
+  for (SwitchSet::List::const_iterator it = switches.begin();
+      it != switches.end(); ++it) {
+    name_count += it->names().size();
+  }
+
+  // Keep the load factor at or below 1/2 so that probe sequences stay short.
+  size_t capacity = 8;
+  while (capacity < name_count * 2) {
+    capacity *= 2;
+  }
+  Slot empty_slot = { NULL, NULL, 0 };
+  slots_.assign(capacity, empty_slot);
+  mask_ = capacity - 1;
+
+  // Switches are inserted in order and existing entries are never replaced,
+  // so that when two switches share a name or flag the first one wins, just
+  // as it would with a linear scan of the list.
+  for (SwitchSet::List::const_iterator it = switches.begin();
+      it != switches.end(); ++it) {
+    for (std::vector<StringType>::const_iterator name = it->names().begin();
+        name != it->names().end(); ++name) {
+      size_t hash = HashString(*name);
+      size_t i = hash & mask_;
+      while (slots_[i].switch_ && !(slots_[i].hash == hash &&
+          *slots_[i].name == *name)) {
+        i = (i + 1) & mask_;
+      }
+      if (!slots_[i].switch_) {
+        slots_[i].name = &*name;
+        slots_[i].switch_ = &*it;
+        slots_[i].hash = hash;
+      }
+    }
+  }
+}
+
+void SwitchIndex::AddShortFlag(CharType ch, int ordinal) {
+  size_t index = static_cast<size_t>(ch);
+  if (index < kShortFlagTableSize && ordinal < kuint16max) {
+    if (!short_flags_[index]) {
+      short_flags_[index] = static_cast<uint16>(ordinal + 1);
+    }
+  } else if (!Find(ch)) {
+    wide_short_flags_.push_back(std::make_pair(ch, ordinal));
+  }
+}
+
+const Switch * SwitchIndex::Find(CharType ch) const {
+  size_t index = static_cast<size_t>(ch);
+  if (index < kShortFlagTableSize && short_flags_[index]) {
+    return first_ + short_flags_[index] - 1;
+  }
+  for (size_t i = 0; i < wide_short_flags_.size(); ++i) {
+    if (wide_short_flags_[i].first == ch) {
+      return first_ + wide_short_flags_[i].second;
+    }
+  }
+  return NULL;
+}
+
+const Switch * SwitchIndex::Find(const base::StringPiece & name) const {
+  size_t hash = HashString(name);
+  for (size_t i = hash & mask_; slots_[i].switch_; i = (i + 1) & mask_) {
+    if (slots_[i].hash == hash && base::StringPiece(*slots_[i].name) == name) {
+      return slots_[i].switch_;
+    }
+  }
+  return NULL;
+}
+
+// static
+const SwitchSet::List & SwitchIndex::GlobalSwitches(
+    const SwitchSet & switch_set) {
+  const SwitchSet::GroupList & groups = switch_set.switches();
+  for (SwitchSet::GroupList::const_iterator it = groups.begin();
+      it != groups.end(); ++it) {
+    if (it->first.empty()) {
+      return it->second;
+    }
+  }
+  static SwitchSet::List kEmptyList;
+  return kEmptyList;
+}
+
+}  // namespace yact
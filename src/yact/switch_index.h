@@ -0,0 +1,91 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_SWITCH_INDEX_H_
+#define YACT_SWITCH_INDEX_H_
+
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/string_piece.h"
+#include "yact/switch_trie.h"
+
+namespace yact {
+
+// A lookup index over the switches of a single SwitchSet group.  Long names
+// (including every alias in Switch::names()) are stored in an open-addressing
+// hash table, and short flags are stored in a table indexed directly by the
+// flag character, so that each lookup is O(1) regardless of the number of
+// switches.  Abbreviated long names are resolved through a SwitchTrie.
+//
+// The index holds pointers into the SwitchSet::List that it was built from,
+// so it must be rebuilt whenever that list changes.
+class SwitchIndex {
+ public:
+  explicit SwitchIndex(const SwitchSet::List & switches);
+
+  // Indexes `switches`, which were compiled from the `count` entries of
+  // `specs` in order.  The short flag table is filled in straight from the
+  // specs rather than from the switches.
+  SwitchIndex(const SwitchSet::List & switches, const SwitchSpec * specs,
+    size_t count);
+
+  // Returns the switch whose short flag is `ch`, or NULL.
+  const Switch * Find(CharType ch) const;
+
+  // Returns the switch which has `name` as one of its names(), or NULL.
+  const Switch * Find(const base::StringPiece & name) const;
+
+  // The position of `switch_` in the list the index was built from.  This is
+  // a dense ordinal in [0, size()) which callers use to keep per-switch state
+  // in flat arrays.
+  int Ordinal(const Switch * switch_) const {
+    DCHECK(switch_ >= first_ && switch_ < first_ + size_);
+    return static_cast<int>(switch_ - first_);
+  }
+
+  // The number of switches in the index.
+  int size() const { return static_cast<int>(size_); }
+
+  // The trie of all long names, for resolving abbreviations.
+  const SwitchTrie & trie() const { return trie_; }
+
+  // Returns the switches of the unnamed group of `switch_set`, or an empty
+  // list if the group was never defined.
+  static const SwitchSet::List & GlobalSwitches(const SwitchSet & switch_set);
+
+ private:
+  struct Slot {
+    const StringType * name;
+    const Switch * switch_;
+    size_t hash;
+  };
+
+  // Builds slots_ from the names of `switches`
+  void IndexNames(const SwitchSet::List & switches);
+
+  // Maps `ch` to the switch at `ordinal`, unless it is already mapped
+  void AddShortFlag(CharType ch, int ordinal);
+
+  const Switch * first_;
+  size_t size_;
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+
+  // The ordinal plus one of the switch with each short flag, or zero.  Short
+  // flags outside of the direct table (only possible with wide characters)
+  // are kept in a small overflow list, as are those of switches past the
+  // first 65535.
+  enum { kShortFlagTableSize = 256 };
+  uint16 short_flags_[kShortFlagTableSize];
+  std::vector<std::pair<CharType, int> > wide_short_flags_;
+
+  SwitchTrie trie_;
+
+  DISALLOW_COPY_AND_ASSIGN(SwitchIndex);
+};
+
+}  // namespace yact
+
+#endif  // YACT_SWITCH_INDEX_H_
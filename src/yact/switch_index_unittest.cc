@@ -0,0 +1,91 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "base/string_number_conversions.h"
+#include "yact/switch_index.h"
+
+namespace yact {
+
+class SwitchIndexTest : public BaseTest {
+};
+
+TEST_F(SwitchIndexTest, Basics) {
+  SwitchSet ss;
+  ss.insert(Switch().name("verbose").short_flag('v').name("loudness").count());
+  ss.insert(Switch().name("help").short_flag('h'));
+  ss.insert("Advanced Options", Switch().name("frobnicate"));
+
+  SwitchIndex index(SwitchIndex::GlobalSwitches(ss));
+  ASSERT_TRUE(NULL != index.Find("verbose"));
+  EXPECT_EQ("verbose", index.Find("verbose")->name());
+  EXPECT_EQ("verbose", index.Find("loudness")->name());
+  EXPECT_EQ("help", index.Find("help")->name());
+  EXPECT_EQ("verbose", index.Find('v')->name());
+  EXPECT_EQ("help", index.Find('h')->name());
+
+  // Only the global group is indexed
+  EXPECT_TRUE(NULL == index.Find("frobnicate"));
+  EXPECT_TRUE(NULL == index.Find("verb"));
+  EXPECT_TRUE(NULL == index.Find(""));
+  EXPECT_TRUE(NULL == index.Find('x'));
+}
+
+TEST_F(SwitchIndexTest, FirstDefinitionWins) {
+  SwitchSet ss;
+  ss.insert(Switch().name("foo").short_flag('f'));
+  ss.insert(Switch().name("bar").name("foo").short_flag('f'));
+
+  SwitchIndex index(SwitchIndex::GlobalSwitches(ss));
+  EXPECT_EQ("foo", index.Find("foo")->name());
+  EXPECT_EQ("foo", index.Find('f')->name());
+  EXPECT_EQ("bar", index.Find("bar")->name());
+}
+
+TEST_F(SwitchIndexTest, SwitchSpecs) {
+  const SwitchSpec specs[] = {
+    { "verbose", 'v', Switch::kActionCount, NULL, NULL, Value::kTypeAuto },
+    { "help", 'h', Switch::kActionStoreTrue, NULL, NULL, Value::kTypeAuto },
+    { "quiet", 'v', Switch::kActionStoreTrue, NULL, NULL, Value::kTypeAuto },
+    { "output", 0, Switch::kActionStore, NULL, NULL, Value::kTypeAuto },
+  };
+  SwitchSet ss;
+  for (size_t i = 0; i < arraysize(specs); ++i) {
+    ss.insert(Switch().name(specs[i].name).short_flag(specs[i].short_flag));
+  }
+
+  SwitchIndex index(SwitchIndex::GlobalSwitches(ss), specs, arraysize(specs));
+  EXPECT_EQ("verbose", index.Find('v')->name());
+  EXPECT_EQ("help", index.Find('h')->name());
+  EXPECT_EQ(1, index.Ordinal(index.Find('h')));
+  EXPECT_EQ("output", index.Find("output")->name());
+  EXPECT_TRUE(NULL == index.Find('o'));
+  EXPECT_TRUE(NULL == index.Find('\0'));
+}
+
+TEST_F(SwitchIndexTest, EmptySwitchSet) {
+  SwitchSet ss;
+  SwitchIndex index(SwitchIndex::GlobalSwitches(ss));
+  EXPECT_TRUE(NULL == index.Find("foo"));
+  EXPECT_TRUE(NULL == index.Find('f'));
+}
+
+TEST_F(SwitchIndexTest, ManySwitches) {
+  SwitchSet ss;
+  for (int i = 0; i < 5000; ++i) {
+    std::string name = "switch-" + base::IntToString(i);
+    ss.insert(Switch().name(name).name("alias-" + base::IntToString(i)));
+  }
+
+  SwitchIndex index(SwitchIndex::GlobalSwitches(ss));
+  for (int i = 0; i < 5000; ++i) {
+    std::string name = "switch-" + base::IntToString(i);
+    ASSERT_TRUE(NULL != index.Find(name)) << name;
+    EXPECT_EQ(name, index.Find(name)->name());
+    EXPECT_EQ(name, index.Find("alias-" + base::IntToString(i))->name());
+  }
+  EXPECT_TRUE(NULL == index.Find("switch-5000"));
+}
+
+}  // namespace yact
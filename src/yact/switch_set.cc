@@ -10,16 +10,32 @@ void SwitchSet::insert(const Switch & switch_) {
   return insert(kEmptyString, switch_);
 }
 void SwitchSet::insert(const StringType & group, const Switch & switch_) {
+  group_list(group).push_back(switch_);
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+void SwitchSet::insert(Switch && switch_) {
+  insert(kEmptyString, std::move(switch_));
+}
+
+void SwitchSet::insert(const StringType & group, Switch && switch_) {
+  group_list(group).push_back(std::move(switch_));
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
+void SwitchSet::swap(SwitchSet & other) {
+  switches_.swap(other.switches_);
+}
+
+SwitchSet::List & SwitchSet::group_list(const StringType & group) {
   for (GroupList::iterator it1 = switches_.begin();
       it1 != switches_.end(); ++it1) {
     if (it1->first == group) {
-      it1->second.push_back(switch_);
-      return;
+      return it1->second;
     }
   }
-  List switch_list;
-  switch_list.push_back(switch_);
-  switches_.push_back(GroupList::value_type(group, switch_list));
+  switches_.push_back(GroupList::value_type(group, List()));
+  return switches_.back().second;
 }
 
 const SwitchSet::GroupList & SwitchSet::switches() const {
@@ -53,7 +69,8 @@ const Switch & SwitchSet::switch_(const StringType & group,
   return kNullSwitch;
 }
 
-bool SwitchSet::has_switch(const StringType & group, const StringType & name) {
+bool SwitchSet::has_switch(const StringType & group,
+    const StringType & name) const {
   for (GroupList::const_iterator it1 = switches_.begin();
       it1 != switches_.end(); ++it1) {
     if (it1->first != group) {
@@ -0,0 +1,195 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/switch_trie.h"
+#include "base/logging.h"
+
+namespace yact {
+
+namespace {
+const int kRoot = 0;
+}  // anonymous namespace
+
+SwitchTrie::Node::Node()
+  : terminal(NULL),
+    terminal_name(NULL),
+    unique(NULL) {
+}
+
+SwitchTrie::SwitchTrie(const SwitchSet::List & switches) {
+  nodes_.push_back(Node());
+  for (SwitchSet::List::const_iterator it = switches.begin();
+      it != switches.end(); ++it) {
+    for (std::vector<StringType>::const_iterator name = it->names().begin();
+        name != it->names().end(); ++name) {
+      if (!name->empty()) {
+        Insert(*name, &*it);
+      }
+    }
+  }
+  ComputeUnique(kRoot);
+}
+
+void SwitchTrie::Insert(const StringType & name, const Switch * switch_) {
+  int node = kRoot;
+  size_t pos = 0;
+  while (pos < name.size()) {
+    int child = FindChild(node, name[pos]);
+    if (child < 0) {
+      Node leaf;
+      leaf.label = name.substr(pos);
+      leaf.terminal = switch_;
+      leaf.terminal_name = &name;
+      nodes_.push_back(leaf);
+      AddChild(node, nodes_.size() - 1);
+      return;
+    }
+
+    // Find how much of the edge label we share
+    const StringType & label = nodes_[child].label;
+    size_t common = 0;
+    while (common < label.size() && pos + common < name.size() &&
+        label[common] == name[pos + common]) {
+      ++common;
+    }
+
+    if (common < label.size()) {
+      // Split the edge: the child keeps the tail of the label and is moved
+      // beneath a new node carrying the shared head.
+      Node middle;
+      middle.label = label.substr(0, common);
+      nodes_.push_back(middle);
+      int middle_index = nodes_.size() - 1;
+      nodes_[child].label.erase(0, common);
+      nodes_[middle_index].children.push_back(child);
+      for (size_t i = 0; i < nodes_[node].children.size(); ++i) {
+        if (nodes_[node].children[i] == child) {
+          nodes_[node].children[i] = middle_index;
+        }
+      }
+      child = middle_index;
+    }
+    pos += common;
+    node = child;
+  }
+
+  // The name ends at an existing node.  Duplicate names resolve to the first
+  // switch that defined them.
+  if (!nodes_[node].terminal) {
+    nodes_[node].terminal = switch_;
+    nodes_[node].terminal_name = &name;
+  }
+}
+
+int SwitchTrie::FindChild(int node, CharType ch) const {
+  const std::vector<int> & children = nodes_[node].children;
+  size_t low = 0;
+  size_t high = children.size();
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    CharType mid_ch = nodes_[children[mid]].label[0];
+    if (mid_ch == ch) {
+      return children[mid];
+    } else if (mid_ch < ch) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return -1;
+}
+
+void SwitchTrie::AddChild(int node, int child) {
+  CharType ch = nodes_[child].label[0];
+  std::vector<int> & children = nodes_[node].children;
+  std::vector<int>::iterator it = children.begin();
+  while (it != children.end() && nodes_[*it].label[0] < ch) {
+    ++it;
+  }
+  children.insert(it, child);
+}
+
+const Switch * SwitchTrie::ComputeUnique(int node) {
+  // Every node other than the root has at least one name beneath it, so
+  // NULL here means "more than one switch".
+  const Switch * unique = nodes_[node].terminal;
+  bool ambiguous = false;
+  for (size_t i = 0; i < nodes_[node].children.size(); ++i) {
+    const Switch * child_unique = ComputeUnique(nodes_[node].children[i]);
+    if (!child_unique) {
+      ambiguous = true;
+    } else if (!unique) {
+      unique = child_unique;
+    } else if (unique != child_unique) {
+      ambiguous = true;
+    }
+  }
+  nodes_[node].unique = ambiguous ? NULL : unique;
+  return nodes_[node].unique;
+}
+
+int SwitchTrie::Walk(const base::StringPiece & prefix, bool * at_node) const {
+  int node = kRoot;
+  size_t pos = 0;
+  *at_node = true;
+  while (pos < prefix.size()) {
+    int child = FindChild(node, prefix[pos]);
+    if (child < 0) {
+      return -1;
+    }
+    const StringType & label = nodes_[child].label;
+    size_t i = 1;
+    while (i < label.size() && pos + i < prefix.size()) {
+      if (label[i] != prefix[pos + i]) {
+        return -1;
+      }
+      ++i;
+    }
+    *at_node = (i == label.size());
+    pos += i;
+    node = child;
+  }
+  return node;
+}
+
+SwitchTrie::MatchResult SwitchTrie::Match(const base::StringPiece & prefix,
+    const Switch ** switch_) const {
+  if (prefix.empty()) {
+    return kNoMatch;
+  }
+  bool at_node;
+  int node = Walk(prefix, &at_node);
+  if (node < 0) {
+    return kNoMatch;
+  }
+  if (at_node && nodes_[node].terminal) {
+    *switch_ = nodes_[node].terminal;
+    return kMatch;
+  }
+  if (!nodes_[node].unique) {
+    return kAmbiguous;
+  }
+  *switch_ = nodes_[node].unique;
+  return kMatch;
+}
+
+void SwitchTrie::Complete(const base::StringPiece & prefix,
+    std::vector<StringType> * names) const {
+  bool at_node;
+  int node = Walk(prefix, &at_node);
+  if (node >= 0) {
+    CollectNames(node, names);
+  }
+}
+
+void SwitchTrie::CollectNames(int node,
+    std::vector<StringType> * names) const {
+  if (nodes_[node].terminal_name) {
+    names->push_back(*nodes_[node].terminal_name);
+  }
+  for (size_t i = 0; i < nodes_[node].children.size(); ++i) {
+    CollectNames(nodes_[node].children[i], names);
+  }
+}
+
+}  // namespace yact
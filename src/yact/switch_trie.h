@@ -0,0 +1,80 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#ifndef YACT_SWITCH_TRIE_H_
+#define YACT_SWITCH_TRIE_H_
+
+#include <yact.h>
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
+namespace yact {
+
+// A radix trie over every name (including aliases) of a list of switches.
+// Each node records the single switch reachable beneath it, if there is only
+// one, so that resolving an abbreviation and detecting ambiguity only costs a
+// walk down the trie proportional to the length of the abbreviation.
+//
+// Like SwitchIndex, the trie holds pointers into the SwitchSet::List it was
+// built from.
+class SwitchTrie {
+ public:
+  explicit SwitchTrie(const SwitchSet::List & switches);
+
+  enum MatchResult {
+    kNoMatch,
+    kMatch,
+    kAmbiguous
+  };
+
+  // Resolves `prefix` to a switch.  An exact name always matches.  Otherwise
+  // `prefix` matches if it is the beginning of the names of exactly one
+  // switch (several aliases of the same switch are not ambiguous).  On kMatch
+  // the switch is stored in `switch_`.
+  MatchResult Match(const base::StringPiece & prefix,
+    const Switch ** switch_) const;
+
+  // Appends every name beginning with `prefix` to `names`, in lexicographic
+  // order.
+  void Complete(const base::StringPiece & prefix,
+    std::vector<StringType> * names) const;
+
+ private:
+  struct Node {
+    Node();
+
+    // The label of the edge from the parent to this node
+    StringType label;
+
+    // Indexes into nodes_, ordered by the first character of their label
+    std::vector<int> children;
+
+    // The switch and name which end exactly at this node, if any
+    const Switch * terminal;
+    const StringType * terminal_name;
+
+    // The only switch with a name beneath this node, or NULL if there are
+    // several.
+    const Switch * unique;
+  };
+
+  void Insert(const StringType & name, const Switch * switch_);
+  int FindChild(int node, CharType ch) const;
+  void AddChild(int node, int child);
+  const Switch * ComputeUnique(int node);
+
+  // Walks the trie along `prefix` and returns the node at or beneath which all
+  // the names starting with `prefix` are found, or -1.  `at_node` is set to
+  // true if `prefix` ends exactly at the returned node rather than part way
+  // along the edge leading to it.
+  int Walk(const base::StringPiece & prefix, bool * at_node) const;
+  void CollectNames(int node, std::vector<StringType> * names) const;
+
+  std::vector<Node> nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(SwitchTrie);
+};
+
+}  // namespace yact
+
+#endif  // YACT_SWITCH_TRIE_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "yact/test_common.h"
+#include <yact.h>
+#include "yact/switch_trie.h"
+
+namespace yact {
+
+class SwitchTrieTest : public BaseTest {
+ public:
+  void SetUp() {
+    switch_set_.insert(Switch().name("verbose").name("verbosity").count());
+    switch_set_.insert(Switch().name("version"));
+    switch_set_.insert(Switch().name("help"));
+    switch_set_.insert(Switch().name("help-all"));
+    switch_set_.insert(Switch().name("x"));
+  }
+
+  SwitchTrie::MatchResult Match(const char * prefix, std::string * name) {
+    SwitchTrie trie(switch_set_.switches(""));
+    const Switch * switch_ = NULL;
+    SwitchTrie::MatchResult result = trie.Match(prefix, &switch_);
+    if (result == SwitchTrie::kMatch) {
+      *name = switch_->name();
+    }
+    return result;
+  }
+
+  SwitchSet switch_set_;
+};
+
+TEST_F(SwitchTrieTest, Match) {
+  std::string name;
+  EXPECT_EQ(SwitchTrie::kMatch, Match("verbose", &name));
+  EXPECT_EQ("verbose", name);
+  EXPECT_EQ(SwitchTrie::kMatch, Match("verb", &name));
+  EXPECT_EQ("verbose", name);
+  EXPECT_EQ(SwitchTrie::kMatch, Match("verbosit", &name));
+  EXPECT_EQ("verbose", name);
+  EXPECT_EQ(SwitchTrie::kMatch, Match("vers", &name));
+  EXPECT_EQ("version", name);
+  EXPECT_EQ(SwitchTrie::kMatch, Match("x", &name));
+  EXPECT_EQ("x", name);
+
+  // An exact name wins over a longer name that it is a prefix of
+  EXPECT_EQ(SwitchTrie::kMatch, Match("help", &name));
+  EXPECT_EQ("help", name);
+  EXPECT_EQ(SwitchTrie::kMatch, Match("help-", &name));
+  EXPECT_EQ("help-all", name);
+
+  EXPECT_EQ(SwitchTrie::kAmbiguous, Match("ver", &name));
+  EXPECT_EQ(SwitchTrie::kAmbiguous, Match("v", &name));
+  EXPECT_EQ(SwitchTrie::kAmbiguous, Match("hel", &name));
+  EXPECT_EQ(SwitchTrie::kNoMatch, Match("", &name));
+  EXPECT_EQ(SwitchTrie::kNoMatch, Match("verbosely", &name));
+  EXPECT_EQ(SwitchTrie::kNoMatch, Match("q", &name));
+}
+
+TEST_F(SwitchTrieTest, Complete) {
+  SwitchTrie trie(switch_set_.switches(""));
+  std::vector<StringType> names;
+  trie.Complete("ver", &names);
+  ASSERT_EQ(3, names.size());
+  EXPECT_EQ("verbose", names[0]);
+  EXPECT_EQ("verbosity", names[1]);
+  EXPECT_EQ("version", names[2]);
+
+  names.clear();
+  trie.Complete("", &names);
+  EXPECT_EQ(6, names.size());
+
+  names.clear();
+  trie.Complete("help-a", &names);
+  ASSERT_EQ(1, names.size());
+  EXPECT_EQ("help-all", names[0]);
+
+  names.clear();
+  trie.Complete("hex", &names);
+  EXPECT_EQ(0, names.size());
+}
+
+}  // namespace yact
@@ -38,4 +38,81 @@ TEST_F(SwitchTest, Basics) {
 
 }
 
+class CountingValidator : public SwitchValidator {
+ public:
+  explicit CountingValidator(int * deleted) : deleted_(deleted) {}
+  virtual ~CountingValidator() { ++*deleted_; }
+  virtual bool Validate(const Value & value) { return true; }
+
+ private:
+  int * deleted_;
+};
+
+TEST_F(SwitchTest, CopiesShareDescription) {
+  Switch s;
+  s.name("output").short_flag('o').store().default_(Value("a.out"))
+    .choice("a.out").choice("b.out")
+    .help("Where to write the output, which is a long enough string");
+
+  Switch assigned;
+  int allocations = AllocationCount();
+  Switch copy(s);
+  assigned = s;
+  assigned = copy;
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ(&s.help(), &copy.help());
+
+  // Modifying a copy leaves the original alone
+  copy.help("Something else").name("out");
+  EXPECT_EQ("Something else", copy.help());
+  EXPECT_EQ("Where to write the output, which is a long enough string",
+    s.help());
+  EXPECT_EQ(1, s.names().size());
+  EXPECT_EQ(2, copy.names().size());
+  EXPECT_EQ("output", assigned.name());
+  EXPECT_EQ(1, assigned.names().size());
+}
+
+TEST_F(SwitchTest, CopiesShareValidator) {
+  int deleted = 0;
+  CountingValidator * validator = new CountingValidator(&deleted);
+  {
+    Switch s;
+    s.name("port").store().validator(validator);
+    Switch copy(s);
+    EXPECT_EQ(validator, copy.validator());
+    copy.help("The port to listen on");
+    EXPECT_EQ(validator, copy.validator());
+    EXPECT_EQ(validator, s.validator());
+    s.validator(NULL);
+    EXPECT_EQ(NULL, s.validator());
+    EXPECT_EQ(0, deleted);
+  }
+  EXPECT_EQ(1, deleted);
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+TEST_F(SwitchTest, Move) {
+  Switch s;
+  s.name("output").store().help("Where to write the output");
+  const StringType * help = &s.help();
+  // The first move allocates the description left in moved-from switches
+  Switch warm_up;
+  Switch unused(std::move(warm_up));
+
+  int allocations = AllocationCount();
+  Switch moved(std::move(s));
+  SwitchSet switches;
+  switches.insert(std::move(moved));
+  EXPECT_EQ(help, &switches.switches("")[0].help());
+  EXPECT_EQ(2, AllocationCount() - allocations);  // the group and its list
+
+  // A moved-from switch may be reused
+  EXPECT_EQ(0, s.names().size());
+  s.name("input");
+  EXPECT_EQ("input", s.name());
+  EXPECT_EQ(0, moved.names().size());
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
 }  // namespace yact
@@ -2,4 +2,68 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include "yact/test_common.h"
+#include <stdlib.h>
+#include <new>
+#include "base/atomicops.h"
 
+namespace {
+
+// Some of the base tests allocate from several threads at once.
+base::subtle::Atomic32 g_allocation_count = 0;
+
+}  // anonymous namespace
+
+void * operator new(size_t size) {
+  void * p = operator new(size, std::nothrow);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void * operator new[](size_t size) {
+  return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) throw() {
+  base::subtle::NoBarrier_AtomicIncrement(&g_allocation_count, 1);
+  return malloc(size ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) throw() {
+  return operator new(size, std::nothrow);
+}
+
+// Every form of delete must be replaced along with new, or the library's
+// sized and nothrow versions would release memory they did not allocate.
+void operator delete(void * p) throw() {
+  free(p);
+}
+
+void operator delete[](void * p) throw() {
+  free(p);
+}
+
+void operator delete(void * p, size_t) throw() {
+  free(p);
+}
+
+void operator delete[](void * p, size_t) throw() {
+  free(p);
+}
+
+void operator delete(void * p, const std::nothrow_t &) throw() {
+  free(p);
+}
+
+void operator delete[](void * p, const std::nothrow_t &) throw() {
+  free(p);
+}
+
+namespace yact {
+
+int AllocationCount() {
+  return base::subtle::NoBarrier_Load(&g_allocation_count);
+}
+
+}  // namespace yact
@@ -8,6 +8,10 @@
 
 namespace yact {
 
+// Returns the number of times operator new has been called by the test
+// program.  Compare two readings to count the allocations made in between.
+int AllocationCount();
+
 class BaseTest : public ::testing::Test {
 };
 
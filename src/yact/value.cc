@@ -2,124 +2,529 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include <yact.h>
+#include <string.h>
+#include <algorithm>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
 #include "base/string_number_conversions.h"
 #include "base/logging.h"
+#include "yact/number.h"
 #include "yact/string.h"
 
 namespace yact {
 
+// Out of line storage for strings.  Long strings always live in a
+// StringBuffer, and short ones get a StringBuffer the first time they are
+// converted.  The string never changes once the buffer is constructed, and the
+// buffer is shared by every copy of the Value which created it.  The reference
+// count and the conversions are atomic so that copies may be made, read and
+// destroyed on different threads.
+class Value::StringBuffer {
+ public:
+  StringBuffer(const CharType * data, size_t size)
+    : ref_count_(1),
+      conversions_(0),
+      value_(data, size),
+      int64_value_(0),
+      double_value_(0) {
+  }
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  // Returns true if the last reference was released
+  bool Release() {
+    return base::subtle::Barrier_AtomicIncrement(&ref_count_, -1) == 0;
+  }
+
+  const StringType & value() const { return value_; }
+
+  // Each returns false if the string is not of that type.  The string is
+  // parsed by the first call and the results are kept for later ones.
+  bool ToInt64(int64 * int64_value);
+  bool ToDouble(double * double_value);
+  bool ToBool(bool * bool_value);
+
+ private:
+  enum {
+    kConverted = 0x01,
+    kConverting = 0x02,
+    kIsInt = 0x04,
+    kIsDouble = 0x08,
+    kIsBool = 0x10,
+    kIsTrue = 0x20
+  };
+
+  // Returns the kIs* flags which apply to the string and sets the numeric
+  // values which go with them
+  int Convert(int64 * int64_value, double * double_value);
+
+  base::subtle::Atomic32 ref_count_;
+  base::subtle::Atomic32 conversions_;
+  StringType value_;
+  int64 int64_value_;
+  double double_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringBuffer);
+};
+
+int Value::StringBuffer::Convert(int64 * int64_value, double * double_value) {
+  base::subtle::Atomic32 conversions =
+    base::subtle::Acquire_Load(&conversions_);
+  if (conversions & kConverted) {
+    *int64_value = int64_value_;
+    *double_value = double_value_;
+    return conversions;
+  }
+
+  conversions = kConverted;
+  bool bool_value;
+  if (ParseInt64(value_, int64_value)) {
+    *double_value = static_cast<double>(*int64_value);
+    conversions |= kIsInt | kIsDouble;
+  } else {
+    *int64_value = 0;
+    if (ParseDouble(value_, double_value)) {
+      conversions |= kIsDouble;
+    } else {
+      *double_value = 0;
+    }
+  }
+  if (StringToBool(value_, &bool_value)) {
+    // Only "0" and "1" are both, and they agree
+    conversions |= kIsBool | (bool_value ? kIsTrue : 0);
+  }
+
+  // Threads which race to convert the same string reach the same answer, so
+  // only the first stores it and the others just return theirs.
+  if (base::subtle::NoBarrier_CompareAndSwap(&conversions_, 0,
+      kConverting) == 0) {
+    int64_value_ = *int64_value;
+    double_value_ = *double_value;
+    base::subtle::Release_Store(&conversions_, conversions);
+  }
+  return conversions;
+}
+
+bool Value::StringBuffer::ToInt64(int64 * int64_value) {
+  double double_value;
+  return (Convert(int64_value, &double_value) & kIsInt) != 0;
+}
+
+bool Value::StringBuffer::ToDouble(double * double_value) {
+  int64 int64_value;
+  return (Convert(&int64_value, double_value) & kIsDouble) != 0;
+}
+
+bool Value::StringBuffer::ToBool(bool * bool_value) {
+  int64 int64_value;
+  double double_value;
+  int conversions = Convert(&int64_value, &double_value);
+  *bool_value = (conversions & kIsTrue) != 0;
+  return (conversions & kIsBool) != 0;
+}
+
+// Out of line storage for a Value created from a Switch, which keeps a copy of
+// the Switch next to the contents of the Value.  Copies of the Value share the
+// SwitchBox as they share a StringBuffer, and a shared SwitchBox is copied
+// before one of them is modified.
+class Value::SwitchBox {
+ public:
+  SwitchBox(const Switch & switch_, const Value & value)
+    : ref_count_(1),
+      switch__(switch_),
+      value_(value) {
+  }
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  // Returns true if the last reference was released
+  bool Release() {
+    return base::subtle::Barrier_AtomicIncrement(&ref_count_, -1) == 0;
+  }
+
+  bool HasOneRef() const {
+    return base::subtle::Acquire_Load(&ref_count_) == 1;
+  }
+
+  const Switch & switch_() const { return switch__; }
+  const Value & value() const { return value_; }
+  Value * mutable_value() { return &value_; }
+
+ private:
+  base::subtle::Atomic32 ref_count_;
+  Switch switch__;
+  Value value_;
+
+  DISALLOW_COPY_AND_ASSIGN(SwitchBox);
+};
+
+// A Value should be no larger than two pointers on 64-bit platforms.
+COMPILE_ASSERT(sizeof(Value) <= 16 || sizeof(CharType) != 1 ||
+  sizeof(void *) != 8, value_should_be_16_bytes);
+
+// Copies move the union as one int64 sized block, and a short string's buffer
+// is published through it as an AtomicWord.
+COMPILE_ASSERT(sizeof(int64) >= sizeof(void *) &&
+  sizeof(int64) == sizeof(double), union_is_int64_sized);
+COMPILE_ASSERT(sizeof(base::subtle::AtomicWord) == sizeof(void *),
+  buffer_is_atomic_word_sized);
+
 Value::Value()
-  : type_(kTypeAuto),
-    int_value_(0),
-    switch__(NULL) {
+  : int64_value_(0),
+    tag_(kTypeAuto) {
+  inline_[0] = 0;
+}
+
+Value::Value(const Value & other)
+  : buffer_(NULL),
+    tag_(kTypeAuto) {
+  inline_[0] = 0;
+  *this = other;
 }
 
 Value::Value(const Switch * switch_)
-  : int_value_(0),
-    switch__(switch_) {
-  switch (switch_->action()) {
-    case Switch::kActionStore:
-    case Switch::kActionAppend:
-    case Switch::kActionStoreConstant:
-      type_ = kTypeAuto;
-      break;
-    case Switch::kActionStoreTrue:
-    case Switch::kActionStoreFalse:
-      type_ = kTypeBool;
-      break;
-    case Switch::kActionCount:
-      type_ = kTypeInt;
-      break;
-    default:
-      NOTREACHED();
-  }
+  : int64_value_(0),
+    tag_(kSwitchFlag) {
+  inline_[0] = 0;
+  box_ = new SwitchBox(*switch_, EmptyValue(SwitchValueType(*switch_)));
 }
 
 Value::Value(int value)
-  : type_(kTypeInt),
-    int_value_(value),
-    switch__(NULL) {
+  : int_value_(value),
+    tag_(kTypeInt) {
+  inline_[0] = 0;
 }
 
 Value::Value(bool value)
-  : type_(kTypeBool),
-    bool_value_(value),
-    switch__(NULL) {
+  : bool_value_(value),
+    tag_(kTypeBool) {
+  inline_[0] = 0;
 }
 
 Value::Value(const StringType & value)
-  : type_(kTypeString),
-    string_value_(value),
-    switch__(NULL) {
+  : buffer_(NULL),
+    tag_(kTypeAuto) {
+  AssignString(kTypeString, value.data(), value.size());
 }
 
 Value::Value(const CharType * value)
-  : type_(kTypeString),
-    string_value_(value),
-    switch__(NULL) {
+  : buffer_(NULL),
+    tag_(kTypeAuto) {
+  AssignString(kTypeString, value, std::char_traits<CharType>::length(value));
+}
+
+Value::Value(int64 value)
+  : int64_value_(value),
+    tag_(kTypeInt64) {
+  inline_[0] = 0;
+}
+
+Value::Value(double value)
+  : double_value_(value),
+    tag_(kTypeDouble) {
+  inline_[0] = 0;
+}
+
+// static
+Value Value::Duration(int64 microseconds) {
+  Value rv(microseconds);
+  rv.tag_ = kTypeDuration;
+  return rv;
+}
+
+// static
+Value Value::ByteSize(int64 bytes) {
+  Value rv(bytes);
+  rv.tag_ = kTypeByteSize;
+  return rv;
+}
+
+Value::~Value() {
+  Release();
 }
 
 int Value::type() const {
-  return type_;
+  return ((tag_ & kSwitchFlag) ? box_->value().tag_ : tag_) & kTypeMask;
+}
+
+bool Value::is_string() const {
+  return type() == kTypeAuto || type() == kTypeString;
+}
+
+const CharType * Value::string_data() const {
+  return (tag_ & kStringBufferFlag) ? buffer_->value().c_str() : inline_;
+}
+
+size_t Value::string_size() const {
+  return (tag_ & kStringBufferFlag) ? buffer_->value().size() :
+    std::char_traits<CharType>::length(inline_);
+}
+
+void Value::AssignString(int type, const CharType * data, size_t size) {
+  // `data` may point into our own storage, so the old storage is released
+  // only after the new string is in place.
+  StringBuffer * old_buffer = is_string() ? buffer_ : NULL;
+  if (size < kInlineCapacity &&
+      std::char_traits<CharType>::find(data, size, 0) == NULL) {
+    std::char_traits<CharType>::move(inline_, data, size);
+    inline_[size] = 0;
+    buffer_ = NULL;
+    tag_ = type;
+  } else {
+    buffer_ = new StringBuffer(data, size);
+    tag_ = type | kStringBufferFlag;
+  }
+  if (old_buffer && old_buffer->Release()) {
+    delete old_buffer;
+  }
+}
+
+Value::StringBuffer * Value::shared_buffer() const {
+  DCHECK(is_string());
+  if (tag_ & kStringBufferFlag) {
+    return buffer_;
+  }
+  // Another thread may be converting the same short string
+  return reinterpret_cast<StringBuffer *>(base::subtle::Acquire_Load(
+    reinterpret_cast<const base::subtle::AtomicWord *>(&buffer_)));
+}
+
+Value::StringBuffer * Value::string_buffer() const {
+  StringBuffer * buffer = shared_buffer();
+  if (buffer) {
+    return buffer;
+  }
+
+  // Publish a buffer for our short string, unless another thread beat us to it
+  base::subtle::AtomicWord * word =
+    reinterpret_cast<base::subtle::AtomicWord *>(
+      const_cast<StringBuffer **>(&buffer_));
+  buffer = new StringBuffer(inline_, std::char_traits<CharType>::length(
+    inline_));
+  if (base::subtle::Release_CompareAndSwap(word, 0,
+      reinterpret_cast<base::subtle::AtomicWord>(buffer)) != 0) {
+    delete buffer;
+    buffer = reinterpret_cast<StringBuffer *>(base::subtle::Acquire_Load(
+      word));
+  }
+  return buffer;
+}
+
+Value * Value::boxed_value() {
+  DCHECK(tag_ & kSwitchFlag);
+  if (!box_->HasOneRef()) {
+    SwitchBox * box = new SwitchBox(box_->switch_(), box_->value());
+    if (box_->Release()) {
+      delete box_;
+    }
+    box_ = box;
+  }
+  return box_->mutable_value();
+}
+
+void Value::Release() {
+  if (tag_ & kSwitchFlag) {
+    if (box_->Release()) {
+      delete box_;
+    }
+    buffer_ = NULL;
+    tag_ = kTypeAuto;
+    inline_[0] = 0;
+  } else if (is_string()) {
+    if (buffer_ && buffer_->Release()) {
+      delete buffer_;
+    }
+    buffer_ = NULL;
+    tag_ &= ~kStringBufferFlag;
+    inline_[0] = 0;
+  }
+}
+
+bool Value::StringEquals(const Value & other) const {
+  size_t size = string_size();
+  return size == other.string_size() && std::char_traits<CharType>::compare(
+    string_data(), other.string_data(), size) == 0;
 }
 
 int Value::AsInt() const {
-  if (type_ == kTypeAuto) {
-    int rv;
-    bool ok = base::StringToInt(string_value_, &rv);
-    DCHECK(ok) << "Cannot convert '" << string_value_ << "' to int";
-    return rv;
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsInt();
   }
-  DCHECK(type_ == kTypeInt) << "Value type mismatch: must be an integer";
+  if (type() == kTypeAuto) {
+    int64 rv;
+    bool ok = string_buffer()->ToInt64(&rv) && rv >= kint32min &&
+      rv <= kint32max;
+    DCHECK(ok) << "Cannot convert '" << AsString() << "' to int";
+    return ok ? static_cast<int>(rv) : 0;
+  }
+  DCHECK(type() == kTypeInt) << "Value type mismatch: must be an integer";
   return int_value_;
 }
 
 bool Value::AsBool() const {
-  if (type_ == kTypeAuto) {
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsBool();
+  }
+  if (type() == kTypeAuto) {
     bool rv;
-    bool ok = StringToBool(string_value_, &rv);
-    DCHECK(ok) << "Cannot convert '" << string_value_ << "' to bool";
-    return rv;
+    bool ok = string_buffer()->ToBool(&rv);
+    DCHECK(ok) << "Cannot convert '" << AsString() << "' to bool";
+    return ok && rv;
   }
-  DCHECK(type_ == kTypeBool) << "Value type mismatch: must be a bool";
+  DCHECK(type() == kTypeBool) << "Value type mismatch: must be a bool";
   return bool_value_;
 }
 
+int64 Value::AsInt64() const {
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsInt64();
+  }
+  switch (type()) {
+    case kTypeAuto:
+      {
+        int64 rv;
+        bool ok = string_buffer()->ToInt64(&rv);
+        DCHECK(ok) << "Cannot convert '" << AsString() << "' to int64";
+        return ok ? rv : 0;
+      }
+    case kTypeInt:
+      return int_value_;
+    default:
+      DCHECK(type() == kTypeInt64) << "Value type mismatch: must be an "
+        "integer";
+      return int64_value_;
+  }
+}
+
+double Value::AsDouble() const {
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsDouble();
+  }
+  switch (type()) {
+    case kTypeAuto:
+      {
+        double rv;
+        bool ok = string_buffer()->ToDouble(&rv);
+        DCHECK(ok) << "Cannot convert '" << AsString() << "' to double";
+        return ok ? rv : 0;
+      }
+    case kTypeInt:
+      return int_value_;
+    case kTypeInt64:
+      return static_cast<double>(int64_value_);
+    default:
+      DCHECK(type() == kTypeDouble) << "Value type mismatch: must be a "
+        "number";
+      return double_value_;
+  }
+}
+
+int64 Value::AsDuration() const {
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsDuration();
+  }
+  if (type() == kTypeAuto) {
+    int64 rv = 0;
+    bool ok = ParseDuration(base::StringPiece(string_data(), string_size()),
+      &rv);
+    DCHECK(ok) << "Cannot convert '" << AsString() << "' to a duration";
+    return rv;
+  }
+  DCHECK(type() == kTypeDuration) << "Value type mismatch: must be a "
+    "duration";
+  return int64_value_;
+}
+
+int64 Value::AsByteSize() const {
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsByteSize();
+  }
+  if (type() == kTypeAuto) {
+    int64 rv = 0;
+    bool ok = ParseByteSize(base::StringPiece(string_data(), string_size()),
+      &rv);
+    DCHECK(ok) << "Cannot convert '" << AsString() << "' to a byte size";
+    return rv;
+  }
+  DCHECK(type() == kTypeByteSize) << "Value type mismatch: must be a byte "
+    "size";
+  return int64_value_;
+}
+
 const StringType & Value::AsString() const {
-  DCHECK(type_ == kTypeAuto || type_ == kTypeString) << "Value type mismatch: "
-    "must be a string";
-  return string_value_;
+  if (tag_ & kSwitchFlag) {
+    return box_->value().AsString();
+  }
+  DCHECK(is_string()) << "Value type mismatch: must be a string";
+  return is_string() ? string_buffer()->value() : kEmptyString;
 }
 
 void Value::set(const Value & value) {
-  type_ = value.type();
-  int_value_ = value.int_value_;
-  string_value_ = value.string_value_;
-  // We retain our value of switch_
+  *this = value;
 }
 
 void Value::set(int value) {
-  type_ = kTypeInt;
+  if (tag_ & kSwitchFlag) {
+    boxed_value()->set(value);
+    return;
+  }
+  Release();
+  tag_ = kTypeInt;
   int_value_ = value;
 }
 
 void Value::set(bool value) {
-  type_ = kTypeBool;
+  if (tag_ & kSwitchFlag) {
+    boxed_value()->set(value);
+    return;
+  }
+  Release();
+  tag_ = kTypeBool;
   bool_value_ = value;
 }
 
+void Value::set(int64 value) {
+  if (tag_ & kSwitchFlag) {
+    boxed_value()->set(value);
+    return;
+  }
+  Release();
+  tag_ = kTypeInt64;
+  int64_value_ = value;
+}
+
+void Value::set(double value) {
+  if (tag_ & kSwitchFlag) {
+    boxed_value()->set(value);
+    return;
+  }
+  Release();
+  tag_ = kTypeDouble;
+  double_value_ = value;
+}
+
 void Value::set(const StringType & value) {
-  type_ = kTypeString;
-  string_value_ = value;
+  set(value.data(), value.size());
 }
 
 void Value::set(const CharType * value) {
-  type_ = kTypeString;
-  string_value_ = value;
+  set(value, std::char_traits<CharType>::length(value));
+}
+
+void Value::set(const CharType * value, size_t size) {
+  if (tag_ & kSwitchFlag) {
+    boxed_value()->set(value, size);
+    return;
+  }
+  AssignString(type() == kTypeAuto ? kTypeAuto : kTypeString, value, size);
 }
 
 const Switch * Value::switch_() const {
-  return switch__;
+  return (tag_ & kSwitchFlag) ? &box_->switch_() : NULL;
 }
 
 Value::operator int() const {
@@ -127,11 +532,19 @@ Value::operator int() const {
 }
 
 Value::operator StringType() const {
-  return AsString();
+  if (tag_ & kSwitchFlag) {
+    return box_->value();
+  }
+  DCHECK(is_string()) << "Value type mismatch: must be a string";
+  return StringType(string_data(), string_size());
 }
 
 Value::operator ConstCharArrayType() const {
-  return AsString().c_str();
+  if (tag_ & kSwitchFlag) {
+    return box_->value();
+  }
+  DCHECK(is_string()) << "Value type mismatch: must be a string";
+  return string_data();
 }
 
 Value::operator bool() const {
@@ -139,57 +552,116 @@ Value::operator bool() const {
 }
 
 Value & Value::operator=(const Value & other) {
-  type_ = other.type_;
-  int_value_ = other.int_value_;
-  string_value_ = other.string_value_;
-  if (other.switch__) {
-    switch__ = new Switch(*other.switch__);
+  if (this == &other) {
+    return *this;
+  }
+  bool has_buffer = other.is_string() && !(other.tag_ & kSwitchFlag);
+  StringBuffer * buffer = has_buffer ? other.shared_buffer() : NULL;
+  if (buffer) {
+    buffer->AddRef();
+  } else if (other.tag_ & kSwitchFlag) {
+    other.box_->AddRef();
+  }
+  Release();
+  if (has_buffer) {
+    buffer_ = buffer;
   } else {
-    switch__ = NULL;
+    memcpy(&int64_value_, &other.int64_value_, sizeof(int64_value_));
   }
+  std::char_traits<CharType>::copy(inline_, other.inline_, kInlineCapacity);
+  tag_ = other.tag_;
   return *this;
 }
 
+#if YACT_HAS_RVALUE_REFERENCES
+Value::Value(Value && other)
+  : int64_value_(0),
+    tag_(kTypeAuto) {
+  inline_[0] = 0;
+  swap(other);
+}
+
+Value & Value::operator=(Value && other) {
+  // `other` releases our previous contents when it is destroyed
+  swap(other);
+  return *this;
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
+void Value::swap(Value & other) {
+  char union_value[sizeof(int64_value_)];
+  memcpy(union_value, &int64_value_, sizeof(union_value));
+  memcpy(&int64_value_, &other.int64_value_, sizeof(union_value));
+  memcpy(&other.int64_value_, union_value, sizeof(union_value));
+  std::swap_ranges(inline_, inline_ + kInlineCapacity, other.inline_);
+  std::swap(tag_, other.tag_);
+}
+
 bool Value::operator==(const Value & other) const {
-  if (type_ == kTypeAuto) {
-    switch (other.type_) {
+  if ((tag_ | other.tag_) & kSwitchFlag) {
+    return ((tag_ & kSwitchFlag) ? box_->value() : *this) ==
+      ((other.tag_ & kSwitchFlag) ? other.box_->value() : other);
+  }
+  if (type() != kTypeAuto && other.type() == kTypeAuto) {
+    return other == *this;
+  }
+
+  // Compare a kTypeAuto string with other types by converting it, and treat a
+  // string which cannot be converted as different.  The conversion is not
+  // kept, so comparing never allocates.
+  if (type() == kTypeAuto) {
+    base::StringPiece value(string_data(), string_size());
+    int64 int64_value;
+    double double_value;
+    bool bool_value;
+    switch (other.type()) {
       case kTypeAuto:
       case kTypeString:
-        return string_value_ == other.string_value_;
-      case kTypeInt:
-        return AsInt() == other.int_value_;
-      case kTypeBool:
-        return AsBool() == other.bool_value_;
-      default:
-        NOTREACHED();
-    }
-  } else if (other.type_ == kTypeAuto) {
-    switch (type_) {
-      case kTypeString:
-        return other.string_value_ == string_value_;
+        return StringEquals(other);
       case kTypeInt:
-        return other.AsInt() == int_value_;
+        return ParseInt64(value, &int64_value) &&
+          int64_value == other.int_value_;
       case kTypeBool:
-        return other.AsBool() == bool_value_;
+        return StringToBool(value, &bool_value) &&
+          bool_value == other.bool_value_;
+      case kTypeInt64:
+        return ParseInt64(value, &int64_value) &&
+          int64_value == other.int64_value_;
+      case kTypeDouble:
+        return ParseDouble(value, &double_value) &&
+          double_value == other.double_value_;
+      case kTypeDuration:
+        return ParseDuration(value, &int64_value) &&
+          int64_value == other.int64_value_;
+      case kTypeByteSize:
+        return ParseByteSize(value, &int64_value) &&
+          int64_value == other.int64_value_;
       default:
         NOTREACHED();
+        return false;
     }
-  } else if (type_ == other.type_) {
-    switch (type_) {
-      case kTypeString:
-        return other.string_value_ == string_value_;
-      case kTypeInt:
-        return other.int_value_ == int_value_;
-      case kTypeBool:
-        return other.bool_value_ == bool_value_;
-      default:
-        NOTREACHED();
-    }
-  } else {
+  }
+
+  if (type() != other.type()) {
     return false;
   }
-  NOTREACHED();
-  return false;
+  switch (type()) {
+    case kTypeString:
+      return StringEquals(other);
+    case kTypeInt:
+      return other.int_value_ == int_value_;
+    case kTypeBool:
+      return other.bool_value_ == bool_value_;
+    case kTypeInt64:
+    case kTypeDuration:
+    case kTypeByteSize:
+      return other.int64_value_ == int64_value_;
+    case kTypeDouble:
+      return other.double_value_ == double_value_;
+    default:
+      NOTREACHED();
+      return false;
+  }
 }
 
 std::ostream& operator<< (std::ostream& out, const Value & value) {
@@ -201,6 +673,14 @@ std::ostream& operator<< (std::ostream& out, const Value & value) {
       return out << value.AsInt();
     case Value::kTypeBool:
       return out << (value.AsBool() ? "true" : "false");
+    case Value::kTypeInt64:
+      return out << value.AsInt64();
+    case Value::kTypeDouble:
+      return out << base::DoubleToString(value.AsDouble());
+    case Value::kTypeDuration:
+      return out << FormatDuration(value.AsDuration());
+    case Value::kTypeByteSize:
+      return out << FormatByteSize(value.AsByteSize());
     default:
       NOTREACHED();
       return out;
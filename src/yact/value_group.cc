@@ -2,84 +2,795 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include <yact.h>
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/lock.h"
 #include "base/logging.h"
+#include "base/scoped_ptr.h"
+#include "base/singleton.h"
+#include "base/string_piece.h"
+#include "base/string_util.h"
+#include "yact/string.h"
 
 namespace yact {
 
+namespace {
+
+#if defined(ARCH_CPU_64_BITS)
+base::subtle::Atomic64 g_last_generation = 0;
+#else
+// There is no 64-bit atomic increment, so the counter is guarded by a lock
+int64 g_last_generation = 0;
+#endif
+
+// Returns a stamp which no ValueGroup has had before.  Stamps are 64 bits wide
+// so that the counter never wraps around to a stamp a handle still holds.
+int64 NextGeneration() {
+#if defined(ARCH_CPU_64_BITS)
+  return base::subtle::NoBarrier_AtomicIncrement(&g_last_generation, 1);
+#else
+  AutoLock lock(*Singleton<Lock, LeakySingletonTraits<Lock> >::get());
+  return ++g_last_generation;
+#endif
+}
+
+}  // namespace
+
+// The contents of a group.  A Data on the heap is shared by every copy of the
+// group which created it and is not modified while it is shared.  A Data in
+// an arena belongs to a single group.
+class ValueGroup::Data {
+ public:
+  // Allocates an empty Data in `arena`, or on the heap if it is NULL
+  static Data * New(const StringType & name, Arena * arena) {
+    if (arena) {
+      return new(arena->Allocate(sizeof(Data))) Data(name, arena);
+    }
+    return new Data(name, NULL);
+  }
+
+  // Returns a reference to an unnamed, empty Data which is never freed, so
+  // that empty groups do not allocate
+  static Data * Empty() {
+    static Data * empty = New(kEmptyString, NULL);
+    empty->AddRef();
+    return empty;
+  }
+
+  // Copies a shared Data so that it can be modified.  The subgroups are
+  // copied as groups, and so are themselves shared.
+  static Data * Copy(const Data & other);
+
+  void AddRef() {
+    base::subtle::NoBarrier_AtomicIncrement(&ref_count_, 1);
+  }
+
+  bool HasOneRef() const {
+    return base::subtle::Acquire_Load(&ref_count_) == 1;
+  }
+
+  // Drops a reference to `data`, destroying it with the last one
+  static void Release(Data * data) {
+    if (base::subtle::Barrier_AtomicIncrement(&data->ref_count_, -1) != 0) {
+      return;
+    }
+    if (data->arena_) {
+      data->~Data();
+    } else {
+      delete data;
+    }
+  }
+
+  base::subtle::Atomic32 ref_count_;
+  Arena * arena_;
+  StringType name_;
+  ValueMap values_;
+  ValueGroupMap groups_;
+  Index value_index_;
+  Index group_index_;
+
+  // Set while the contents are still to be filled in by loader_.  The lock
+  // is created with the first loader and kept until the Data is destroyed,
+  // since threads may be waiting on it when the loader is done.
+  base::subtle::Atomic32 pending_;
+  scoped_ptr<Loader> loader_;
+  scoped_ptr<Lock> load_lock_;
+
+ private:
+  Data(const StringType & name, Arena * arena)
+    : ref_count_(1),
+      arena_(arena),
+      name_(name),
+      values_(ValueMap::key_compare(), ValueMap::allocator_type(arena)),
+      groups_(ValueGroupMap::key_compare(),
+        ValueGroupMap::allocator_type(arena)),
+      value_index_(Index::allocator_type(arena)),
+      group_index_(Index::allocator_type(arena)),
+      pending_(0) {
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+// Maintains the hash indexes of a ValueGroup.  The indexes are kept at most
+// half full so that probe sequences stay short.
+class ValueGroup::Internal {
+ public:
+  // Returns the entry of the map indexed by `index` named `name`, or NULL
+  template <typename Map>
+  static typename Map::value_type * Find(const Index & index,
+      const base::StringPiece & name, size_t hash) {
+    typedef typename Map::value_type Entry;
+    if (index.empty()) {
+      return NULL;
+    }
+    size_t mask = index.size() - 1;
+    for (size_t i = hash & mask; index[i].entry; i = (i + 1) & mask) {
+      if (index[i].hash != hash) {
+        continue;
+      }
+      Entry * entry = static_cast<Entry *>(const_cast<void *>(index[i].entry));
+      if (name == base::StringPiece(entry->first)) {
+        return entry;
+      }
+    }
+    return NULL;
+  }
+
+  template <typename Map>
+  static typename Map::value_type * Find(const Index & index,
+      const base::StringPiece & name) {
+    return Find<Map>(index, name, HashString(name));
+  }
+
+  // Adds an entry to an index which will then cover `count` entries
+  static void Insert(Index * index, size_t count, size_t hash,
+      const void * entry) {
+    if (count * 2 > index->size()) {
+      Index old_index(index->get_allocator());
+      old_index.swap(*index);
+      Reserve(index, count);
+      for (size_t i = 0; i < old_index.size(); ++i) {
+        if (old_index[i].entry) {
+          Place(index, old_index[i]);
+        }
+      }
+    }
+    IndexSlot slot = { hash, entry };
+    Place(index, slot);
+  }
+
+  // Indexes every entry of `map` from scratch
+  template <typename Map>
+  static void Rebuild(Index * index, const Map & map) {
+    index->clear();
+    if (map.empty()) {
+      return;
+    }
+    Reserve(index, map.size());
+    for (typename Map::const_iterator it = map.begin(); it != map.end();
+        ++it) {
+      IndexSlot slot = { HashString(it->first), &*it };
+      Place(index, slot);
+    }
+  }
+
+  static const Value & GetValue(const ValueGroup * this_,
+      const base::StringPiece & name) {
+    const ValueMap::value_type * entry = Find<ValueMap>(
+      this_->LoadedData()->value_index_, name);
+    DCHECK(entry && !entry->second.empty()) << "Cannot find value named " <<
+      name;
+    if (!entry || entry->second.empty()) {
+      static Value kNullValue;
+      return kNullValue;
+    }
+    return entry->second.front();
+  }
+
+  static const ValueList & GetValues(const ValueGroup * this_,
+      const base::StringPiece & name) {
+    const ValueMap::value_type * entry = Find<ValueMap>(
+      this_->LoadedData()->value_index_, name);
+    if (!entry) {
+      static ValueList kEmptyValueList;
+      return kEmptyValueList;
+    }
+    return entry->second;
+  }
+
+  static const ValueGroup & GetGroup(const ValueGroup * this_,
+      const base::StringPiece & name) {
+    const ValueGroupMap::value_type * entry = Find<ValueGroupMap>(
+      this_->LoadedData()->group_index_, name);
+    DCHECK(entry) << "Cannot find group named " << name;
+    if (!entry) {
+      static ValueGroup kEmptyGroup;
+      return kEmptyGroup;
+    }
+    return entry->second;
+  }
+
+  static ValueList & MutableValues(ValueGroup * this_,
+      const StringType & name) {
+    Data * data = this_->MutableData();
+    size_t hash = HashString(name);
+    ValueMap::value_type * entry = Find<ValueMap>(data->value_index_, name,
+      hash);
+    if (!entry) {
+      // Copying a list into the node would put it on the heap, so the list
+      // takes the arena by a swap instead
+      entry = &*data->values_.insert(
+        ValueMap::value_type(name, ValueList())).first;
+      ValueList(ValueList::allocator_type(data->arena_)).swap(entry->second);
+      Insert(&data->value_index_, data->values_.size(), hash, entry);
+      this_->generation_ = NextGeneration();
+    }
+    return entry->second;
+  }
+
+  // As MutableValues(), for a caller which is about to add to the list.  A
+  // name which gains its first value changes the stamp, as a new entry does,
+  // because it may now hide a value in a lower layer of a ValueOverlay.
+  static ValueList & GrowingValues(ValueGroup * this_,
+      const StringType & name) {
+    ValueList & values = MutableValues(this_, name);
+    if (values.empty()) {
+      this_->generation_ = NextGeneration();
+    }
+    return values;
+  }
+
+  // Copies the values and subgroups of `other` into the new, empty group
+  // this_.  The entries arrive in order, so each is inserted at the end of
+  // its map.
+  static void Copy(ValueGroup * this_, const ValueGroup & other) {
+    Data * data = this_->data_;
+    const Data * other_data = other.LoadedData();
+    ValueList::allocator_type allocator(data->arena_);
+    for (ValueMap::const_iterator it = other_data->values_.begin();
+        it != other_data->values_.end(); ++it) {
+      ValueMap::iterator entry = data->values_.insert(data->values_.end(),
+        ValueMap::value_type(it->first, ValueList()));
+      ValueList(it->second.begin(), it->second.end(), allocator).swap(
+        entry->second);
+    }
+    for (ValueGroupMap::const_iterator it = other_data->groups_.begin();
+        it != other_data->groups_.end(); ++it) {
+      ValueGroupMap::iterator entry = data->groups_.insert(
+        data->groups_.end(), ValueGroupMap::value_type(it->first,
+          ValueGroup()));
+      ValueGroup(it->second, data->arena_).swap(entry->second);
+    }
+    Rebuild(&data->value_index_, data->values_);
+    Rebuild(&data->group_index_, data->groups_);
+  }
+
+  // Fills in `data` from its loader, once however many threads ask.  The
+  // loader builds a group of its own, whose contents are then moved into
+  // `data` so that every group sharing it sees them.
+  static void Load(Data * data) {
+    AutoLock lock(*data->load_lock_);
+    if (!base::subtle::NoBarrier_Load(&data->pending_)) {
+      return;
+    }
+    ValueGroup contents(data->name_, data->arena_);
+    data->loader_->Load(&contents);
+    Data * loaded = contents.MutableData();
+    data->values_.swap(loaded->values_);
+    data->groups_.swap(loaded->groups_);
+    data->value_index_.swap(loaded->value_index_);
+    data->group_index_.swap(loaded->group_index_);
+    data->loader_.reset();
+    base::subtle::Release_Store(&data->pending_, 0);
+  }
+
+ private:
+  static void Reserve(Index * index, size_t count) {
+    size_t capacity = 8;
+    while (capacity < count * 2) {
+      capacity *= 2;
+    }
+    IndexSlot empty_slot = { 0, NULL };
+    index->assign(capacity, empty_slot);
+  }
+
+  static void Place(Index * index, const IndexSlot & slot) {
+    size_t mask = index->size() - 1;
+    size_t i = slot.hash & mask;
+    while ((*index)[i].entry) {
+      i = (i + 1) & mask;
+    }
+    (*index)[i] = slot;
+  }
+};
+
+// static
+ValueGroup::Data * ValueGroup::Data::Copy(const Data & other) {
+  DCHECK(!other.arena_) << "Groups in an arena are never shared";
+  DCHECK(!other.pending_) << "Groups are loaded before they are copied";
+  Data * data = New(other.name_, NULL);
+  data->values_ = other.values_;
+  data->groups_ = other.groups_;
+  Internal::Rebuild(&data->value_index_, data->values_);
+  Internal::Rebuild(&data->group_index_, data->groups_);
+  return data;
+}
+
 ValueGroup::ValueGroup(const StringType & name)
-  : name_(name) {
+  : data_(name.empty() ? Data::Empty() : Data::New(name, NULL)),
+    generation_(NextGeneration()) {
+}
+
+ValueGroup::ValueGroup(const StringType & name, Arena * arena)
+  : data_(name.empty() && !arena ? Data::Empty() : Data::New(name, arena)),
+    generation_(NextGeneration()) {
+}
+
+ValueGroup::ValueGroup(const ValueGroup & other)
+  : data_(NULL),
+    generation_(NextGeneration()) {
+  if (!other.data_->arena_) {
+    data_ = other.data_;
+    data_->AddRef();
+  } else {
+    data_ = Data::New(other.data_->name_, NULL);
+    Internal::Copy(this, other);
+  }
+}
+
+ValueGroup::ValueGroup(const ValueGroup & other, Arena * arena)
+  : data_(NULL),
+    generation_(NextGeneration()) {
+  if (!arena && !other.data_->arena_) {
+    data_ = other.data_;
+    data_->AddRef();
+  } else {
+    data_ = Data::New(other.data_->name_, arena);
+    Internal::Copy(this, other);
+  }
+}
+
+ValueGroup::~ValueGroup() {
+  Data::Release(data_);
+}
+
+ValueGroup & ValueGroup::operator=(const ValueGroup & other) {
+  if (this != &other) {
+    ValueGroup copy(other, data_->arena_);
+    swap(copy);
+  }
+  return *this;
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+ValueGroup::ValueGroup(ValueGroup && other)
+  : data_(other.data_),
+    generation_(NextGeneration()) {
+  other.data_ = Data::Empty();
+  other.generation_ = NextGeneration();
+}
+
+ValueGroup & ValueGroup::operator=(ValueGroup && other) {
+  if (data_->arena_ != other.data_->arena_) {
+    return *this = static_cast<const ValueGroup &>(other);
+  }
+  swap(other);
+  return *this;
 }
+#endif  // YACT_HAS_RVALUE_REFERENCES
 
 const StringType & ValueGroup::name() const {
-  return name_;
+  return data_->name_;
 }
 
 ValueGroup & ValueGroup::name(const StringType & name) {
-  name_ = name;
+  MutableData()->name_ = name;
   return *this;
 }
 
+Arena * ValueGroup::arena() const {
+  return data_->arena_;
+}
+
 const ValueGroup::ValueMap & ValueGroup::values() const {
-  return values_;
+  return LoadedData()->values_;
 }
 
 const Value & ValueGroup::value(const StringType & name) const {
-  ValueMap::const_iterator it = values_.find(name);
-  DCHECK(it != values_.end()) << "Cannot find value named " << name;
-  DCHECK(!it->second.empty()) << "Cannot find value named " << name;
-  return it->second.front();
+  return Internal::GetValue(this, name);
+}
+
+const Value & ValueGroup::value(const CharType * name) const {
+  return Internal::GetValue(this, name);
 }
 
 const ValueGroup::ValueList & ValueGroup::repeated_value(
     const StringType & name) const {
-  ValueMap::const_iterator it = values_.find(name);
-  if (it == values_.end()) {
-    static ValueList kEmptyValueList;
-    return kEmptyValueList;
-  } else {
-    return it->second;
-  }
+  return Internal::GetValues(this, name);
+}
+
+const ValueGroup::ValueList & ValueGroup::repeated_value(
+    const CharType * name) const {
+  return Internal::GetValues(this, name);
 }
 
 const ValueGroup::ValueGroupMap & ValueGroup::groups() const {
-  return groups_;
+  return LoadedData()->groups_;
 }
 
 const ValueGroup & ValueGroup::group(const StringType & name) const {
-  ValueGroupMap::const_iterator it = groups_.find(name);
-  DCHECK(it != groups_.end());
-  return it->second;
+  return Internal::GetGroup(this, name);
+}
+
+const ValueGroup & ValueGroup::group(const CharType * name) const {
+  return Internal::GetGroup(this, name);
 }
 
 bool ValueGroup::has_value(const StringType & name) const {
-  ValueMap::const_iterator it = values_.find(name);
-  return it != values_.end() && !it->second.empty();
+  return !Internal::GetValues(this, name).empty();
+}
+
+bool ValueGroup::has_value(const CharType * name) const {
+  return !Internal::GetValues(this, name).empty();
 }
 
 bool ValueGroup::has_group(const StringType & name) const {
-  ValueGroupMap::const_iterator it = groups_.find(name);
-  return it != groups_.end();
+  return Internal::Find<ValueGroupMap>(LoadedData()->group_index_, name) !=
+    NULL;
+}
+
+bool ValueGroup::has_group(const CharType * name) const {
+  return Internal::Find<ValueGroupMap>(LoadedData()->group_index_, name) !=
+    NULL;
 }
 
 void ValueGroup::SetValue(const StringType & name, const Value & value) {
-  values_[name].clear();
-  values_[name].push_back(value);
+  Internal::GrowingValues(this, name).assign(1, value);
 }
 
 void ValueGroup::AddRepeatedValue(const StringType & name, const Value & value) {
-  values_[name].push_back(value);
+  Internal::GrowingValues(this, name).push_back(value);
 }
 
 void ValueGroup::ClearValue(const StringType & name) {
-  values_[name].clear();
+  ValueList & values = Internal::MutableValues(this, name);
+  if (!values.empty()) {
+    values.clear();
+    generation_ = NextGeneration();
+  }
 }
 
 void ValueGroup::AddGroup(const ValueGroup & group) {
   DCHECK(!group.name().empty());
-  ValueGroupMap::const_iterator it = groups_.find(group.name());
-  DCHECK(it == groups_.end()) << "A group named '" << group.name()
+  DCHECK(!has_group(group.name())) << "A group named '" << group.name()
     << "' already exists";
-  groups_[group.name()] = group;
+  CreateGroup(group.name()) = group;
+}
+
+ValueGroup & ValueGroup::CreateGroup(const StringType & name) {
+  DCHECK(!name.empty());
+  Data * data = MutableData();
+  size_t hash = HashString(name);
+  ValueGroupMap::value_type * entry = Internal::Find<ValueGroupMap>(
+    data->group_index_, name, hash);
+  if (!entry) {
+    // As in Internal::MutableValues(), the new group takes the arena by a
+    // swap because copying it into the node would put it on the heap
+    entry = &*data->groups_.insert(
+      ValueGroupMap::value_type(name, ValueGroup())).first;
+    ValueGroup(name, data->arena_).swap(entry->second);
+    Internal::Insert(&data->group_index_, data->groups_.size(), hash, entry);
+    generation_ = NextGeneration();
+  }
+  return entry->second;
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+void ValueGroup::SetValue(const StringType & name, Value && value) {
+  ValueList & values = Internal::GrowingValues(this, name);
+  values.clear();
+  values.push_back(std::move(value));
+}
+
+void ValueGroup::AddRepeatedValue(const StringType & name, Value && value) {
+  Internal::GrowingValues(this, name).push_back(std::move(value));
+}
+
+void ValueGroup::AddGroup(ValueGroup && group) {
+  DCHECK(!group.name().empty());
+  DCHECK(!has_group(group.name())) << "A group named '" << group.name()
+    << "' already exists";
+  if (group.arena() != arena()) {
+    AddGroup(static_cast<const ValueGroup &>(group));
+    return;
+  }
+  CreateGroup(group.name()).swap(group);
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
+void ValueGroup::swap(ValueGroup & other) {
+  std::swap(data_, other.data_);
+  generation_ = NextGeneration();
+  other.generation_ = NextGeneration();
+}
+
+void ValueGroup::set_loader(Loader * loader) {
+  Data * data = MutableData();
+  DCHECK(data->values_.empty() && data->groups_.empty()) <<
+    "Only an empty group can be loaded";
+  data->loader_.reset(loader);
+  if (!data->load_lock_.get()) {
+    data->load_lock_.reset(new Lock);
+  }
+  base::subtle::Release_Store(&data->pending_, 1);
+}
+
+ValueGroup::Data * ValueGroup::MutableData() {
+  LoadedData();
+  if (!data_->HasOneRef()) {
+    Data * data = Data::Copy(*data_);
+    Data::Release(data_);
+    data_ = data;
+    generation_ = NextGeneration();
+  }
+  return data_;
+}
+
+const ValueGroup::Data * ValueGroup::LoadedData() const {
+  if (base::subtle::Acquire_Load(&data_->pending_)) {
+    Internal::Load(data_);
+  }
+  return data_;
+}
+
+ValueGroup::Loader::~Loader() {
+}
+
+ValueHandle::ValueHandle(const StringType & path)
+  : path_(path),
+    values_(NULL),
+    group_(NULL) {
+  SplitStringDontTrim(path_, '.', &names_);
+  DCHECK(!path_.empty()) << "Empty path";
+  hashes_.reserve(names_.size());
+  for (size_t i = 0; i < names_.size(); ++i) {
+    hashes_.push_back(HashString(names_[i]));
+  }
+  Level unresolved = { NULL, 0 };
+  levels_.assign(names_.size(), unresolved);
+}
+
+const StringType & ValueHandle::path() const {
+  return path_;
+}
+
+const Value & ValueHandle::value(const ValueGroup & root) const {
+  Resolve(root);
+  DCHECK(values_ && !values_->empty()) << "Cannot find value named " << path_;
+  if (!values_ || values_->empty()) {
+    static Value kNullValue;
+    return kNullValue;
+  }
+  return values_->front();
+}
+
+const ValueGroup::ValueList & ValueHandle::repeated_value(
+    const ValueGroup & root) const {
+  Resolve(root);
+  if (!values_) {
+    static ValueGroup::ValueList kEmptyValueList;
+    return kEmptyValueList;
+  }
+  return *values_;
+}
+
+const ValueGroup & ValueHandle::group(const ValueGroup & root) const {
+  Resolve(root);
+  DCHECK(group_) << "Cannot find group named " << path_;
+  if (!group_) {
+    static ValueGroup kEmptyGroup;
+    return kEmptyGroup;
+  }
+  return *group_;
+}
+
+bool ValueHandle::has_value(const ValueGroup & root) const {
+  Resolve(root);
+  return values_ && !values_->empty();
+}
+
+bool ValueHandle::has_group(const ValueGroup & root) const {
+  Resolve(root);
+  return group_ != NULL;
+}
+
+void ValueHandle::Resolve(const ValueGroup & root) const {
+  // The cache is good while every group on the path keeps its stamp.  Each
+  // level is checked before the next is dereferenced, because an unchanged
+  // group still owns the subgroup that was found in it.
+  if (levels_[0].group == &root) {
+    size_t i = 0;
+    while (i < levels_.size() && levels_[i].group &&
+        levels_[i].group->generation_ == levels_[i].generation) {
+      ++i;
+    }
+    if (i == levels_.size() || !levels_[i].group) {
+      return;
+    }
+  }
+
+  const ValueGroup * group = &root;
+  for (size_t i = 0; i < levels_.size(); ++i) {
+    levels_[i].group = group;
+    levels_[i].generation = group ? group->generation_ : 0;
+    if (group && i + 1 < levels_.size()) {
+      const ValueGroup::ValueGroupMap::value_type * entry =
+        ValueGroup::Internal::Find<ValueGroup::ValueGroupMap>(
+          group->LoadedData()->group_index_, names_[i], hashes_[i]);
+      group = entry ? &entry->second : NULL;
+    }
+  }
+
+  values_ = NULL;
+  group_ = NULL;
+  if (group) {
+    const ValueGroup::ValueMap::value_type * value_entry =
+      ValueGroup::Internal::Find<ValueGroup::ValueMap>(
+        group->LoadedData()->value_index_, names_.back(), hashes_.back());
+    const ValueGroup::ValueGroupMap::value_type * group_entry =
+      ValueGroup::Internal::Find<ValueGroup::ValueGroupMap>(
+        group->LoadedData()->group_index_, names_.back(), hashes_.back());
+    values_ = value_entry ? &value_entry->second : NULL;
+    group_ = group_entry ? &group_entry->second : NULL;
+  }
+}
+
+ValueOverlay::ValueOverlay()
+  : cache_lookups_(false),
+    cache_count_(0) {
+}
+
+ValueOverlay & ValueOverlay::AddLayer(const ValueGroup * layer) {
+  DCHECK(layer);
+  layers_.push_back(layer);
+  return *this;
+}
+
+size_t ValueOverlay::layer_count() const {
+  return layers_.size();
+}
+
+const ValueGroup & ValueOverlay::layer(size_t index) const {
+  DCHECK_LT(index, layers_.size());
+  return *layers_[index];
+}
+
+ValueOverlay & ValueOverlay::cache_lookups(bool cache_lookups) {
+  cache_lookups_ = cache_lookups;
+  cache_.clear();
+  cache_count_ = 0;
+  cache_generations_.clear();
+  return *this;
+}
+
+bool ValueOverlay::cache_lookups() const {
+  return cache_lookups_;
+}
+
+const Value & ValueOverlay::value(const StringType & name) const {
+  return value(name.c_str());
+}
+
+const Value & ValueOverlay::value(const CharType * name) const {
+  const ValueGroup::ValueMap::value_type * entry = Find(name,
+    std::char_traits<CharType>::length(name), NULL);
+  DCHECK(entry) << "Cannot find value named " << name;
+  if (!entry) {
+    static Value kNullValue;
+    return kNullValue;
+  }
+  return entry->second.front();
+}
+
+const ValueGroup::ValueList & ValueOverlay::repeated_value(
+    const StringType & name) const {
+  return repeated_value(name.c_str());
+}
+
+const ValueGroup::ValueList & ValueOverlay::repeated_value(
+    const CharType * name) const {
+  const ValueGroup::ValueMap::value_type * entry = Find(name,
+    std::char_traits<CharType>::length(name), NULL);
+  if (!entry) {
+    static ValueGroup::ValueList kEmptyValueList;
+    return kEmptyValueList;
+  }
+  return entry->second;
+}
+
+bool ValueOverlay::has_value(const StringType & name) const {
+  return Find(name.data(), name.size(), NULL) != NULL;
+}
+
+bool ValueOverlay::has_value(const CharType * name) const {
+  return Find(name, std::char_traits<CharType>::length(name), NULL) != NULL;
+}
+
+int ValueOverlay::value_layer(const StringType & name) const {
+  int layer = -1;
+  Find(name.data(), name.size(), &layer);
+  return layer;
+}
+
+bool ValueOverlay::has_group(const StringType & name) const {
+  size_t hash = HashString(name);
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    if (ValueGroup::Internal::Find<ValueGroup::ValueGroupMap>(
+        layers_[i]->LoadedData()->group_index_, name, hash)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ValueOverlay ValueOverlay::group(const StringType & name) const {
+  ValueOverlay overlay;
+  overlay.cache_lookups_ = cache_lookups_;
+  size_t hash = HashString(name);
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    const ValueGroup::ValueGroupMap::value_type * entry =
+      ValueGroup::Internal::Find<ValueGroup::ValueGroupMap>(
+        layers_[i]->LoadedData()->group_index_, name, hash);
+    if (entry) {
+      overlay.layers_.push_back(&entry->second);
+    }
+  }
+  return overlay;
+}
+
+const ValueGroup::ValueMap::value_type * ValueOverlay::Find(
+    const CharType * name, size_t length, int * layer) const {
+  typedef ValueGroup::ValueMap::value_type Entry;
+  base::StringPiece key(name, length);
+  size_t hash = HashString(key);
+
+  // A cached entry stays the winner while no layer has gained or lost a
+  // name, which a change of stamp would show.  Looking up the index of the
+  // winning layer needs a search of the layers, so it is never cached.
+  if (cache_lookups_ && !layer) {
+    bool valid = cache_generations_.size() == layers_.size();
+    for (size_t i = 0; valid && i < layers_.size(); ++i) {
+      valid = layers_[i]->generation_ == cache_generations_[i];
+    }
+    if (!valid) {
+      cache_.clear();
+      cache_count_ = 0;
+      cache_generations_.resize(layers_.size());
+      for (size_t i = 0; i < layers_.size(); ++i) {
+        cache_generations_[i] = layers_[i]->generation_;
+      }
+    }
+    const Entry * entry = ValueGroup::Internal::Find<ValueGroup::ValueMap>(
+      cache_, key, hash);
+    if (entry) {
+      return entry;
+    }
+  }
+
+  for (size_t i = layers_.size(); i-- > 0;) {
+    const Entry * entry = ValueGroup::Internal::Find<ValueGroup::ValueMap>(
+      layers_[i]->LoadedData()->value_index_, key, hash);
+    if (entry && !entry->second.empty()) {
+      if (layer) {
+        *layer = static_cast<int>(i);
+      } else if (cache_lookups_) {
+        ValueGroup::Internal::Insert(&cache_, ++cache_count_, hash, entry);
+      }
+      return entry;
+    }
+  }
+  return NULL;
 }
 
-} //  namespace yact
+}  //  namespace yact
@@ -3,6 +3,8 @@
 // found in the LICENSE file.
 #include "yact/test_common.h"
 #include <yact.h>
+#include "base/platform_thread.h"
+#include "base/string_number_conversions.h"
 
 namespace yact {
 
@@ -51,4 +53,347 @@ TEST_F(ValueGroupTest, Basics) {
   CheckGroup(vg3);
 }
 
+TEST_F(ValueGroupTest, BuildInPlace) {
+  ValueGroup vg;
+  vg.SetValue("someglobalswitch", Value(true));
+  vg.CreateGroup("alice@example.net").SetValue("name", Value("Alice"));
+  ValueGroup & bob = vg.CreateGroup("bob@example.com");
+  bob.SetValue("name", Value("Bob"));
+  EXPECT_EQ(&bob, &vg.CreateGroup("bob@example.com"));
+  CheckGroup(vg);
+
+  ValueGroup other;
+  other.swap(vg);
+  CheckGroup(other);
+  EXPECT_EQ(0, vg.groups().size());
+}
+
+TEST_F(ValueGroupTest, IndexedLookup) {
+  ValueGroup vg;
+  const int kCount = 1000;
+  for (int i = 0; i < kCount; ++i) {
+    std::string name = "a rather long value name number " +
+      base::IntToString(i);
+    vg.SetValue(name, Value(i));
+    vg.CreateGroup(name).SetValue("index", Value(i));
+  }
+  ValueGroup copy(vg);
+  vg = ValueGroup();
+  ASSERT_EQ(kCount, copy.values().size());
+  EXPECT_EQ("a rather long value name number 0", copy.values().begin()->first);
+  for (int i = 0; i < kCount; ++i) {
+    std::string name = "a rather long value name number " +
+      base::IntToString(i);
+    ASSERT_TRUE(copy.has_value(name));
+    EXPECT_EQ(Value(i), copy.value(name));
+    EXPECT_EQ(Value(i), copy.group(name).value("index"));
+  }
+  EXPECT_FALSE(copy.has_value("a rather long value name number 1000"));
+  EXPECT_FALSE(copy.has_group("a rather long value name number 1000"));
+  EXPECT_EQ(0, copy.repeated_value("missing").size());
+
+  // Looking up by a nul terminated name does not build a string
+  int allocations = AllocationCount();
+  EXPECT_EQ(Value(999), copy.value("a rather long value name number 999"));
+  EXPECT_TRUE(copy.has_group("a rather long value name number 999"));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+}
+
+TEST_F(ValueGroupTest, CopiesShareStructure) {
+  ValueGroup original;
+  for (int i = 0; i < 100; ++i) {
+    ValueGroup & group = original.CreateGroup("group " + base::IntToString(i));
+    for (int j = 0; j < 100; ++j) {
+      group.SetValue("value " + base::IntToString(j), Value(j));
+    }
+  }
+  const ValueHandle handle("group 7.value 7");
+  EXPECT_EQ(Value(7), handle.value(original));
+
+  // Copies share everything
+  int allocations = AllocationCount();
+  ValueGroup copy(original);
+  ValueGroup another;
+  another = copy;
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ(&original.values(), &copy.values());
+
+  // Changing a value copies the groups on the path to it, and no others
+  allocations = AllocationCount();
+  copy.CreateGroup("group 7").SetValue("value 7", Value(-7));
+  EXPECT_LT(AllocationCount() - allocations, 1000);
+  EXPECT_EQ(Value(-7), copy.group("group 7").value("value 7"));
+  EXPECT_EQ(Value(7), original.group("group 7").value("value 7"));
+  EXPECT_EQ(Value(7), another.group("group 7").value("value 7"));
+  EXPECT_NE(&original.group("group 7").values(),
+    &copy.group("group 7").values());
+  EXPECT_EQ(&original.group("group 8").values(),
+    &copy.group("group 8").values());
+  EXPECT_EQ(Value(7), handle.value(original));
+  EXPECT_EQ(Value(-7), handle.value(copy));
+
+  // Once copied, a group is modified in place
+  allocations = AllocationCount();
+  copy.CreateGroup("group 7").SetValue("value 8", Value(-8));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ(Value(8), original.group("group 7").value("value 8"));
+}
+
+TEST_F(ValueGroupTest, ReferencesFollowTheContents) {
+  ValueGroup config;
+  config.SetValue("limit", Value(10));
+  config.CreateGroup("cache").SetValue("size", Value(256));
+  const Value & limit = config.value("limit");
+  const ValueGroup & cache = config.group("cache");
+  {
+    ValueGroup backup(config);
+
+    // Modifying a shared group moves it onto contents of its own, so the
+    // references taken before then point into the copy
+    config.SetValue("verbose", Value(true));
+    EXPECT_EQ(&limit, &backup.value("limit"));
+    EXPECT_EQ(&cache, &backup.group("cache"));
+    EXPECT_NE(&limit, &config.value("limit"));
+    EXPECT_FALSE(backup.has_value("verbose"));
+    EXPECT_EQ(Value(10), limit);
+  }
+
+  // With the copy gone they must be taken again from the group
+  EXPECT_EQ(Value(10), config.value("limit"));
+  EXPECT_EQ(Value(256), config.group("cache").value("size"));
+  EXPECT_EQ(Value(true), config.value("verbose"));
+}
+
+TEST_F(ValueGroupTest, Handle) {
+  ValueGroup root;
+  root.CreateGroup("cache").CreateGroup("l2").SetValue("size", Value(256));
+  root.CreateGroup("cache").SetValue("l2", "a value named like a group");
+
+  const ValueHandle size("cache.l2.size");
+  const ValueHandle l2("cache.l2");
+  const ValueHandle missing("cache.l3.size");
+  EXPECT_EQ("cache.l2.size", size.path());
+  EXPECT_EQ(Value(256), size.value(root));
+  EXPECT_TRUE(l2.has_value(root));
+  EXPECT_TRUE(l2.has_group(root));
+  EXPECT_EQ(&root.group("cache").group("l2"), &l2.group(root));
+  EXPECT_FALSE(size.has_group(root));
+  EXPECT_FALSE(missing.has_value(root));
+  EXPECT_EQ(0, missing.repeated_value(root).size());
+
+  // Once resolved, reads follow the cached pointers
+  int allocations = AllocationCount();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(Value(256), size.value(root));
+    EXPECT_FALSE(missing.has_value(root));
+  }
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  // Changing a value in place is seen without resolving again
+  root.CreateGroup("cache").CreateGroup("l2").SetValue("size", Value(512));
+  EXPECT_EQ(Value(512), size.value(root));
+
+  // Adding the missing group is noticed
+  root.CreateGroup("cache").CreateGroup("l3").SetValue("size", Value(1));
+  EXPECT_EQ(Value(1), missing.value(root));
+
+  // Replacing the tree makes the handles resolve again
+  ValueGroup rebuilt;
+  rebuilt.CreateGroup("cache").CreateGroup("l2").SetValue("size", Value(64));
+  root = rebuilt;
+  EXPECT_EQ(Value(64), size.value(root));
+  EXPECT_FALSE(missing.has_value(root));
+  EXPECT_FALSE(l2.has_value(root));
+
+  ValueGroup other;
+  other.swap(root);
+  EXPECT_FALSE(size.has_value(root));
+  EXPECT_EQ(Value(64), size.value(other));
+  EXPECT_EQ(Value(64), size.value(rebuilt));
+}
+
+TEST_F(ValueGroupTest, Overlay) {
+  ValueGroup defaults;
+  defaults.SetValue("port", Value(80));
+  defaults.SetValue("host", "localhost");
+  defaults.CreateGroup("cache").SetValue("size", Value(10));
+  ValueGroup file;
+  file.SetValue("port", Value(8080));
+  file.CreateGroup("cache").SetValue("ttl", Value(60));
+  ValueGroup argv;
+  argv.AddRepeatedValue("verbose", Value(true));
+
+  for (int cached = 0; cached < 2; ++cached) {
+    ValueGroup user(argv);
+    ValueOverlay overlay;
+    overlay.cache_lookups(cached != 0);
+    overlay.AddLayer(&defaults).AddLayer(&file).AddLayer(&user);
+    EXPECT_EQ(3, overlay.layer_count());
+    EXPECT_EQ(&file, &overlay.layer(1));
+    EXPECT_EQ(Value(8080), overlay.value("port"));
+    EXPECT_STREQ("localhost", overlay.value(StringType("host")));
+    EXPECT_EQ(1, overlay.repeated_value("verbose").size());
+    EXPECT_FALSE(overlay.has_value("missing"));
+    EXPECT_TRUE(overlay.repeated_value("missing").empty());
+    EXPECT_EQ(1, overlay.value_layer("port"));
+    EXPECT_EQ(-1, overlay.value_layer("missing"));
+
+    // Changes to any layer are seen at once
+    user.SetValue("port", Value(1234));
+    EXPECT_EQ(Value(1234), overlay.value("port"));
+    EXPECT_EQ(2, overlay.value_layer("port"));
+    user.ClearValue("port");
+    EXPECT_EQ(Value(8080), overlay.value("port"));
+    user.AddRepeatedValue("port", Value(4321));
+    EXPECT_EQ(Value(4321), overlay.value("port"));
+    defaults.SetValue("host", "example.com");
+    EXPECT_STREQ("example.com", overlay.value("host"));
+    user = file;
+    EXPECT_EQ(Value(8080), overlay.value("port"));
+    EXPECT_FALSE(overlay.has_value("verbose"));
+    defaults.SetValue("host", "localhost");
+
+    // Subgroups are overlaid too
+    EXPECT_TRUE(overlay.has_group("cache"));
+    EXPECT_FALSE(overlay.has_group("missing"));
+    ValueOverlay cache = overlay.group("cache");
+    EXPECT_EQ(3, cache.layer_count());
+    EXPECT_EQ(cached != 0, cache.cache_lookups());
+    EXPECT_EQ(Value(10), cache.value("size"));
+    EXPECT_EQ(Value(60), cache.value("ttl"));
+    EXPECT_EQ(0, overlay.group("missing").layer_count());
+  }
+
+  // Cached lookups neither copy the layers nor allocate
+  ValueOverlay overlay;
+  overlay.cache_lookups(true).AddLayer(&defaults).AddLayer(&file)
+    .AddLayer(&argv);
+  EXPECT_EQ(Value(80), overlay.layer(0).value("port"));
+  overlay.value("host");
+  int allocations = AllocationCount();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_STREQ("localhost", overlay.value("host"));
+    EXPECT_TRUE(overlay.has_value("verbose"));
+  }
+  EXPECT_EQ(0, AllocationCount() - allocations);
+}
+
+namespace {
+
+// Fills in a group with one value, counting how often it is asked to
+class CountingLoader : public ValueGroup::Loader {
+ public:
+  explicit CountingLoader(int * loads) : loads_(loads) {}
+
+  virtual void Load(ValueGroup * group) {
+    ++*loads_;
+    group->SetValue("name", Value(group->name()));
+    group->CreateGroup("child").SetValue("age", Value(7));
+  }
+
+ private:
+  int * loads_;
+};
+
+// Reads a lazily loaded group
+class ReadThread : public PlatformThread::Delegate {
+ public:
+  ReadThread() : group_(NULL), failures_(0) {}
+
+  void Init(const ValueGroup * group) {
+    group_ = group;
+  }
+
+  virtual void ThreadMain() {
+    if (!(group_->value("name") == Value(group_->name())) ||
+        group_->group("child").value("age").AsInt() != 7) {
+      ++failures_;
+    }
+  }
+
+  int failures() const { return failures_; }
+
+ private:
+  const ValueGroup * group_;
+  int failures_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ValueGroupTest, Loader) {
+  int loads = 0;
+  ValueGroup root;
+  root.CreateGroup("alice").set_loader(new CountingLoader(&loads));
+  EXPECT_TRUE(root.has_group("alice"));
+  EXPECT_EQ(0, loads);
+
+  // Copies made before the group is read share the loaded contents
+  ValueGroup copy = root;
+  EXPECT_STREQ("alice", root.group("alice").value("name"));
+  EXPECT_EQ(1, loads);
+  EXPECT_EQ(1, copy.group("alice").values().size());
+  EXPECT_EQ(7, copy.group("alice").group("child").value("age").AsInt());
+  EXPECT_EQ(1, loads);
+
+  // Modifying a group loads it first
+  root.CreateGroup("bob").set_loader(new CountingLoader(&loads));
+  root.CreateGroup("bob").SetValue("age", Value(30));
+  EXPECT_EQ(2, loads);
+  EXPECT_STREQ("bob", root.group("bob").value("name"));
+  EXPECT_EQ(2, root.group("bob").values().size());
+
+  // So does copying it into an arena
+  Arena arena;
+  root.CreateGroup("carol").set_loader(new CountingLoader(&loads));
+  ValueGroup in_arena(root, &arena);
+  EXPECT_EQ(3, loads);
+  EXPECT_STREQ("carol", in_arena.group("carol").value("name"));
+
+  // A group read by several threads at once is loaded once
+  root.CreateGroup("dave").set_loader(new CountingLoader(&loads));
+  const ValueGroup & dave = root.group("dave");
+  const int kThreadCount = 4;
+  ReadThread threads[kThreadCount];
+  PlatformThreadHandle handles[kThreadCount];
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads[i].Init(&dave);
+    ASSERT_TRUE(PlatformThread::Create(0, &threads[i], &handles[i]));
+  }
+  for (int i = 0; i < kThreadCount; ++i) {
+    PlatformThread::Join(handles[i]);
+    EXPECT_EQ(0, threads[i].failures());
+  }
+  EXPECT_EQ(4, loads);
+}
+
+#if YACT_HAS_RVALUE_REFERENCES
+TEST_F(ValueGroupTest, MoveDoesNotCopy) {
+  ValueGroup small("small");
+  ValueGroup large("large");
+  for (int i = 0; i < 100; ++i) {
+    large.CreateGroup("child").AddRepeatedValue(
+      "a value which is stored out of line", Value(i));
+  }
+
+  // Adding a group costs the same however much it holds
+  ValueGroup vg;
+  vg.CreateGroup("first");
+  int allocations = AllocationCount();
+  vg.AddGroup(std::move(small));
+  int small_allocations = AllocationCount() - allocations;
+  allocations = AllocationCount();
+  vg.AddGroup(std::move(large));
+  EXPECT_EQ(small_allocations, AllocationCount() - allocations);
+  EXPECT_EQ(100, vg.group("large").group("child").repeated_value(
+    "a value which is stored out of line").size());
+
+  Value value("a string which does not fit inside a Value");
+  allocations = AllocationCount();
+  Value moved(std::move(value));
+  value = std::move(moved);
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ("a string which does not fit inside a Value", value.AsString());
+}
+#endif  // YACT_HAS_RVALUE_REFERENCES
+
 }  // namespace yact
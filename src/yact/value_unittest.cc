@@ -3,6 +3,8 @@
 // found in the LICENSE file.
 #include "yact/test_common.h"
 #include <yact.h>
+#include <sstream>
+#include "base/basictypes.h"
 
 namespace yact {
 
@@ -51,4 +53,237 @@ TEST_F(ValueTest, StringValue) {
   EXPECT_TRUE(value == another_value);
 }
 
+TEST_F(ValueTest, ShortAndLongStrings) {
+  if (sizeof(void *) == 8) {
+    EXPECT_EQ(16, sizeof(Value));
+  }
+
+  Value short_value("short");
+  Value long_value("a string which does not fit inside a Value");
+  EXPECT_EQ("short", short_value.AsString());
+  EXPECT_EQ("a string which does not fit inside a Value",
+    long_value.AsString());
+  EXPECT_FALSE(short_value == long_value);
+
+  // Copies of a long string share its storage
+  Value copy(long_value);
+  EXPECT_EQ(static_cast<const char *>(long_value),
+    static_cast<const char *>(copy));
+  EXPECT_TRUE(copy == long_value);
+  long_value.set("changed");
+  EXPECT_EQ("a string which does not fit inside a Value", copy.AsString());
+  EXPECT_EQ("changed", long_value.AsString());
+
+  copy = copy;
+  EXPECT_EQ("a string which does not fit inside a Value", copy.AsString());
+  copy.set(static_cast<const char *>(copy));
+  EXPECT_EQ("a string which does not fit inside a Value", copy.AsString());
+  copy.set(3);
+  EXPECT_EQ(3, copy.AsInt());
+
+  std::string with_nul("a\0b", 3);
+  Value nul_value(with_nul);
+  EXPECT_EQ(with_nul, nul_value.AsString());
+  EXPECT_FALSE(nul_value == Value("a"));
+}
+
+TEST_F(ValueTest, KeepsSwitch) {
+  Value value;
+  {
+    Switch switch_;
+    switch_.name("level").store().type(Value::kTypeInt);
+    value = Value(&switch_);
+  }
+  ASSERT_TRUE(value.switch_() != NULL);
+  EXPECT_EQ("level", value.switch_()->dest());
+  EXPECT_EQ(Value::kTypeInt, value.type());
+  value.set(3);
+  EXPECT_EQ(3, value.AsInt());
+  EXPECT_TRUE(value == Value(3));
+
+  // Copies share the Switch, and setting one leaves the others alone
+  Value copy(value);
+  EXPECT_EQ(value.switch_(), copy.switch_());
+  copy.set(4);
+  EXPECT_EQ(3, value.AsInt());
+  EXPECT_EQ(4, copy.AsInt());
+  ASSERT_TRUE(copy.switch_() != NULL);
+  EXPECT_EQ("level", copy.switch_()->dest());
+
+  // Assigning another Value replaces the Switch
+  copy = Value(5);
+  EXPECT_TRUE(NULL == copy.switch_());
+  copy.swap(value);
+  EXPECT_EQ(3, copy.AsInt());
+  EXPECT_TRUE(NULL == value.switch_());
+  ASSERT_TRUE(copy.switch_() != NULL);
+}
+
+TEST_F(ValueTest, AsStringReturnsReference) {
+  Value short_value("short");
+  Value long_value("a string which does not fit inside a Value");
+  const std::string & short_string = short_value.AsString();
+  const std::string & long_string = long_value.AsString();
+  EXPECT_EQ("short", short_string);
+  EXPECT_EQ(&short_string, &short_value.AsString());
+  EXPECT_EQ(&long_string, &long_value.AsString());
+
+  // Copies made afterwards refer to the same string
+  Value copy(short_value);
+  EXPECT_EQ(&short_string, &copy.AsString());
+
+  // The by value conversion does not copy a short string into a buffer
+  Value other("other");
+  int allocations = AllocationCount();
+  std::string by_value = other;
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_EQ("other", by_value);
+}
+
+TEST_F(ValueTest, CopyDoesNotAllocate) {
+  Switch switch_;
+  switch_.name("verbose").count().help("Be chatty");
+  Value from_switch(&switch_);
+  Value long_value("a string which does not fit inside a Value");
+  ValueGroup::ValueList values;
+  values.push_back(from_switch);
+  values.push_back(Value(3));
+  values.push_back(long_value);
+
+  int allocations = AllocationCount();
+  Value copy(from_switch);
+  copy = long_value;
+  copy = Value(true);
+  for (size_t i = 0; i < values.size(); ++i) {
+    copy = values[i];
+  }
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  // Copying a list allocates the vector storage but nothing per Value
+  allocations = AllocationCount();
+  ValueGroup::ValueList list_copy(values);
+  EXPECT_EQ(1, AllocationCount() - allocations);
+  EXPECT_TRUE(list_copy[2] == long_value);
+}
+
+TEST_F(ValueTest, AutoConversions) {
+  Switch switch_;
+  switch_.name("limit").store();
+  Value value(&switch_);
+  value.set("42");
+  EXPECT_EQ(Value::kTypeAuto, value.type());
+  EXPECT_EQ(42, value.AsInt());
+  EXPECT_TRUE(value == Value(42));
+  EXPECT_FALSE(value == Value(true));
+  EXPECT_EQ("42", value.AsString());
+
+  int allocations = AllocationCount();
+  int sum = 0;
+  for (int i = 0; i < 1000; ++i) {
+    sum += value;
+  }
+  EXPECT_EQ(42000, sum);
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  value.set("-1234567890");
+  EXPECT_EQ(-1234567890, value.AsInt());
+  Value copy(value);
+  EXPECT_EQ(-1234567890, copy.AsInt());
+
+  value.set("Yes");
+  EXPECT_TRUE(value.AsBool());
+  EXPECT_TRUE(value == Value(true));
+  EXPECT_FALSE(value == Value(1));
+  value.set("0");
+  EXPECT_EQ(0, value.AsInt());
+  EXPECT_FALSE(value.AsBool());
+  value.set("1");
+  EXPECT_EQ(1, value.AsInt());
+  EXPECT_TRUE(value.AsBool());
+
+  // Neither an int nor a bool
+  value.set("12 monkeys");
+  EXPECT_FALSE(value == Value(12));
+  EXPECT_FALSE(value == Value(false));
+  EXPECT_TRUE(value == Value("12 monkeys"));
+
+  // Explicit strings are not converted
+  Value string_value("42");
+  EXPECT_EQ(Value::kTypeString, string_value.type());
+  EXPECT_FALSE(string_value == Value(42));
+}
+
+TEST_F(ValueTest, ConversionsAreLazy) {
+  const std::string kLong = "a string which is much too long to be a number";
+  Value value;
+  int allocations = AllocationCount();
+  value.set("12");
+  EXPECT_EQ(0, AllocationCount() - allocations);
+  EXPECT_TRUE(value == Value(12));
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  // The first conversion is kept for every copy made after it
+  EXPECT_EQ(12, value.AsInt());
+  allocations = AllocationCount();
+  Value copy(value);
+  EXPECT_EQ(12, copy.AsInt64());
+  EXPECT_EQ(12.0, copy.AsDouble());
+  EXPECT_EQ(0, AllocationCount() - allocations);
+
+  // Assigning a new string forgets the conversions of the old one
+  copy.set(kLong);
+  EXPECT_FALSE(copy == Value(12));
+  copy.set("1");
+  EXPECT_TRUE(copy.AsBool());
+  EXPECT_EQ(1, copy.AsInt());
+  EXPECT_EQ(12, value.AsInt());
+  value.set("-0.5");
+  EXPECT_EQ(-0.5, value.AsDouble());
+  EXPECT_TRUE(value == Value(-0.5));
+}
+
+TEST_F(ValueTest, NumericValues) {
+  const int64 kBig = GG_INT64_C(10000000000);
+  Value int64_value(kBig);
+  EXPECT_EQ(Value::kTypeInt64, int64_value.type());
+  EXPECT_EQ(kBig, int64_value.AsInt64());
+  EXPECT_EQ(1e10, int64_value.AsDouble());
+  EXPECT_EQ(42, Value(42).AsInt64());
+
+  Value double_value(2.5);
+  EXPECT_EQ(Value::kTypeDouble, double_value.type());
+  EXPECT_EQ(2.5, double_value.AsDouble());
+  EXPECT_TRUE(double_value == Value(2.5));
+  EXPECT_FALSE(double_value == Value(static_cast<int64>(0)));
+
+  Value duration = Value::Duration(1500000);
+  EXPECT_EQ(Value::kTypeDuration, duration.type());
+  EXPECT_EQ(1500000, duration.AsDuration());
+  EXPECT_FALSE(duration == Value(static_cast<int64>(1500000)));
+  std::ostringstream out;
+  out << duration << " " << Value::ByteSize(GG_INT64_C(8) << 30) << " " <<
+    double_value;
+  EXPECT_EQ("1500ms 8GiB 2.5", out.str());
+
+  // kTypeAuto strings convert to the numeric types too
+  Switch switch_;
+  switch_.name("timeout").store();
+  Value auto_value(&switch_);
+  auto_value.set("1.5");
+  EXPECT_EQ(1.5, auto_value.AsDouble());
+  auto_value.set("10000000000");
+  EXPECT_EQ(kBig, auto_value.AsInt64());
+  EXPECT_EQ(1e10, auto_value.AsDouble());
+  auto_value.set("5m");
+  EXPECT_EQ(GG_INT64_C(300000000), auto_value.AsDuration());
+  EXPECT_TRUE(auto_value == Value::Duration(GG_INT64_C(300000000)));
+  auto_value.set("4KiB");
+  EXPECT_EQ(4096, auto_value.AsByteSize());
+  EXPECT_TRUE(Value::ByteSize(4096) == auto_value);
+
+  // A Switch with a type makes values of that type
+  switch_.type(Value::kTypeDuration);
+  EXPECT_EQ(Value::kTypeDuration, Value(&switch_).type());
+}
+
 }  // namespace yact
@@ -0,0 +1,906 @@
+// Copyright (c) 2010 Ross Kinder. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Benchmarks for argument parsing and value lookup over synthetic schemas and
+// inputs.  For each benchmark we report throughput, percentiles of the time
+// per operation and the number of heap allocations per operation, e.g.:
+//
+//   yact_bench --filter=parse
+//
+// The INI benchmarks write files from 1 KB up to --max_ini_size (1 GB by
+// default) to a temporary directory.  Parsing the largest of them into a
+// ValueGroup needs several times its size in memory.
+//
+#include "build/build_config.h"  // NOLINT
+#include <yact.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#if defined(OS_POSIX)
+#include <getopt.h>
+#include <unistd.h>
+#endif  // defined(OS_POSIX)
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/file_path.h"
+#include "base/file_util.h"
+#include "base/lock.h"
+#include "base/logging.h"
+#include "base/scoped_ptr.h"
+#include "base/string_number_conversions.h"
+#include "base/string_util.h"
+#include "base/time.h"
+#include "yact/ini_scanner.h"
+#include "yact/number.h"
+#include "yact/string.h"
+
+namespace {
+
+// Every allocation made by the benchmark binary goes through this counter.
+// The INI parsing benchmarks allocate from several threads at once.
+base::subtle::AtomicWord g_allocation_count = 0;
+
+int64 AllocationCount() {
+  return base::subtle::NoBarrier_Load(&g_allocation_count);
+}
+
+}  // anonymous namespace
+
+void * operator new(size_t size) {
+  void * p = operator new(size, std::nothrow);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void * operator new[](size_t size) {
+  return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) throw() {
+  base::subtle::NoBarrier_AtomicIncrement(&g_allocation_count, 1);
+  return malloc(size ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) throw() {
+  return operator new(size, std::nothrow);
+}
+
+// Every form of delete must be replaced along with new, or the library's
+// sized and nothrow versions would release memory they did not allocate.
+void operator delete(void * p) throw() {
+  free(p);
+}
+
+void operator delete[](void * p) throw() {
+  free(p);
+}
+
+void operator delete(void * p, size_t) throw() {
+  free(p);
+}
+
+void operator delete[](void * p, size_t) throw() {
+  free(p);
+}
+
+void operator delete(void * p, const std::nothrow_t &) throw() {
+  free(p);
+}
+
+void operator delete[](void * p, const std::nothrow_t &) throw() {
+  free(p);
+}
+
+namespace yact {
+namespace {
+
+// A single benchmark.  Run() performs one operation; SetUp() builds the
+// inputs and is not measured.
+class Benchmark {
+ public:
+  explicit Benchmark(const std::string & name) : name_(name) {}
+  virtual ~Benchmark() {}
+
+  const std::string & name() const { return name_; }
+  virtual void SetUp() {}
+  virtual void Run() = 0;
+
+  // The number of bytes of input an operation reads, to report throughput
+  // in MB/s, or zero
+  virtual int64 bytes() const { return 0; }
+
+  // Roughly the memory an operation needs, if it is enough to matter
+  virtual int64 memory() const { return 0; }
+
+ private:
+  std::string name_;
+};
+
+// The `percent` percentile of `sorted` by the nearest rank, so that with few
+// samples the higher percentiles are the slowest sample rather than the median
+double Percentile(const std::vector<double> & sorted, int percent) {
+  size_t rank = (sorted.size() * percent + 99) / 100;
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+// Runs `benchmark` in batches large enough to be timed accurately, taking
+// `samples` batches or as many as fit in `max_time`, and prints one line of
+// results.  An operation which takes long enough to time on its own is run
+// in batches of one, and the percentiles are of single operations ("op").
+// Otherwise they are of the mean time per operation in each batch ("batch"),
+// which hides the spread between operations.
+void RunBenchmark(Benchmark * benchmark, int samples,
+    const base::TimeDelta & max_time) {
+  const int kMinSamples = 3;
+  benchmark->SetUp();
+
+  // Choose a batch size which takes at least 200us
+  int64 batch = 1;
+  for (;;) {
+    base::TimeTicks start = base::TimeTicks::HighResNow();
+    for (int64 i = 0; i < batch; ++i) {
+      benchmark->Run();
+    }
+    if ((base::TimeTicks::HighResNow() - start).InMicroseconds() >= 200) {
+      break;
+    }
+    batch *= 2;
+  }
+
+  std::vector<double> nanoseconds_per_op;
+  nanoseconds_per_op.reserve(samples);
+  int64 allocations = AllocationCount();
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  base::TimeDelta elapsed;
+  while (static_cast<int>(nanoseconds_per_op.size()) < samples &&
+      (static_cast<int>(nanoseconds_per_op.size()) < kMinSamples ||
+       elapsed < max_time)) {
+    base::TimeTicks batch_start = base::TimeTicks::HighResNow();
+    for (int64 i = 0; i < batch; ++i) {
+      benchmark->Run();
+    }
+    base::TimeTicks batch_end = base::TimeTicks::HighResNow();
+    nanoseconds_per_op.push_back(
+      (batch_end - batch_start).InMicroseconds() * 1000.0 / batch);
+    elapsed = batch_end - start;
+  }
+  int64 ops = batch * nanoseconds_per_op.size();
+  allocations = AllocationCount() - allocations;
+  double ops_per_second =
+    ops * 1e6 / std::max<int64>(elapsed.InMicroseconds(), 1);
+
+  std::sort(nanoseconds_per_op.begin(), nanoseconds_per_op.end());
+  std::string throughput;
+  if (benchmark->bytes()) {
+    throughput = StringPrintf("  %9.1f MB/s",
+      ops_per_second * benchmark->bytes() / 1e6);
+  }
+  printf("%-44s %12.2f ops/s  %-5s p50 %12.1f ns  p90 %12.1f ns"
+    "  p99 %12.1f ns  %8.2f allocs/op%s\n",
+    benchmark->name().c_str(),
+    ops_per_second,
+    batch == 1 ? "op" : "batch",
+    Percentile(nanoseconds_per_op, 50),
+    Percentile(nanoseconds_per_op, 90),
+    Percentile(nanoseconds_per_op, 99),
+    static_cast<double>(allocations) / ops,
+    throughput.c_str());
+  fflush(stdout);
+}
+
+// Input generators ------------------------------------------------------------
+
+// Builds a schema with `count` switches named "switch-N".  The switches cycle
+// through the store, store_true, count and append actions, and the first 52
+// also have short flags.
+SwitchSet MakeSwitchSet(int count) {
+  const char kShortFlags[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  SwitchSet switch_set;
+  for (int i = 0; i < count; ++i) {
+    Switch switch_;
+    switch_.name(StringPrintf("switch-%d", i));
+    if (i < static_cast<int>(arraysize(kShortFlags)) - 1) {
+      switch_.short_flag(kShortFlags[i]);
+    }
+    switch (i % 4) {
+      case 0: switch_.store(); break;
+      case 1: switch_.store_true(); break;
+      case 2: switch_.count(); break;
+      case 3: switch_.append(); break;
+    }
+    switch_set.insert(switch_);
+  }
+  return switch_set;
+}
+
+// Builds a command line for a schema from MakeSwitchSet(switch_count) with
+// `arg_count` long switches, each used at most once, followed by free
+// arguments.
+std::vector<std::string> MakeCommandLine(int switch_count, int arg_count) {
+  std::vector<std::string> argv;
+  argv.push_back("program");
+  srand(1);
+  std::vector<bool> used(switch_count, false);
+  for (int i = 0; i < arg_count; ++i) {
+    int index = rand() % switch_count;
+    if (used[index]) {
+      argv.push_back(StringPrintf("/path/to/some/input/file-%d.txt", i));
+      continue;
+    }
+    used[index] = true;
+    switch (index % 4) {
+      case 0:
+      case 3:
+        argv.push_back(StringPrintf("--switch-%d=value-%d", index, i));
+        break;
+      default:
+        argv.push_back(StringPrintf("--switch-%d", index));
+        break;
+    }
+  }
+  return argv;
+}
+
+// Builds a chain of `depth` nested groups named "g0", "g1", ..., each with
+// `width` values named "v0", "v1", ...
+ValueGroup MakeValueGroup(int depth, int width, int level = 0) {
+  ValueGroup group(StringPrintf("g%d", level));
+  for (int i = 0; i < width; ++i) {
+    group.SetValue(StringPrintf("v%d", i), Value(i));
+  }
+  if (level + 1 < depth) {
+    group.AddGroup(MakeValueGroup(depth, width, level + 1));
+  }
+  return group;
+}
+
+// A temporary INI file of about `size` bytes, in the style of a routing
+// table: sections of ten keys each.  The file is written a section at a
+// time, so that even the largest is never held in memory.
+class IniFile {
+ public:
+  explicit IniFile(int64 size) : sections_(0) {
+    CHECK(file_util::CreateTemporaryFile(&path_));
+    FILE * file = file_util::OpenFile(path_, "wb");
+    CHECK(file);
+    std::string section = "; generated\nversion = 1\n";
+    int64 written = 0;
+    while (written < size) {
+      section += StringPrintf("\n[route-%d]\n", sections_);
+      for (int j = 0; j < 10; ++j) {
+        section += StringPrintf("key-%d = 10.%d.%d.0/24  # hop %d\n", j,
+          sections_ % 256, j, sections_);
+      }
+      ++sections_;
+      CHECK_EQ(section.size(), fwrite(section.data(), 1, section.size(),
+        file));
+      written += section.size();
+      section.clear();
+    }
+    CHECK(file_util::CloseFile(file));
+    size_ = written;
+  }
+
+  ~IniFile() {
+    file_util::Delete(path_, false);
+  }
+
+  const FilePath & path() const { return path_; }
+  int64 size() const { return size_; }
+  int sections() const { return sections_; }
+
+  StringType filename() const {
+#if defined(OS_WIN)
+    return WideToString(path_.value());
+#else  // !OS_WIN
+    return path_.value();
+#endif  // !OS_WIN
+  }
+
+ private:
+  FilePath path_;
+  int64 size_;
+  int sections_;
+
+  DISALLOW_COPY_AND_ASSIGN(IniFile);
+};
+
+// Benchmarks ------------------------------------------------------------------
+
+class ParseBenchmark : public Benchmark {
+ public:
+  ParseBenchmark(int switch_count, int arg_count)
+    : Benchmark(StringPrintf("parse/switches:%d/args:%d", switch_count,
+        arg_count)),
+      switch_count_(switch_count),
+      arg_count_(arg_count),
+      compiled_(NULL) {
+  }
+  ~ParseBenchmark() { delete compiled_; }
+
+  virtual void SetUp() {
+    compiled_ = new CompiledSwitchSet(MakeSwitchSet(switch_count_));
+    args_ = MakeCommandLine(switch_count_, arg_count_);
+    for (size_t i = 0; i < args_.size(); ++i) {
+      argv_.push_back(args_[i].c_str());
+    }
+  }
+
+  virtual void Run() {
+    bool ok = compiled_->Parse(argv_.size(), &argv_[0], &result_);
+    CHECK(ok) << result_.error();
+  }
+
+ private:
+  int switch_count_;
+  int arg_count_;
+  CompiledSwitchSet * compiled_;
+  std::vector<std::string> args_;
+  std::vector<const char *> argv_;
+  ParseResult result_;
+};
+
+#if defined(OS_POSIX)
+// The same work as ParseBenchmark, done with getopt_long(), as a baseline.
+class GetoptBenchmark : public Benchmark {
+ public:
+  GetoptBenchmark(int switch_count, int arg_count)
+    : Benchmark(StringPrintf("getopt_long/switches:%d/args:%d", switch_count,
+        arg_count)),
+      switch_count_(switch_count),
+      arg_count_(arg_count) {
+  }
+
+  virtual void SetUp() {
+    names_.resize(switch_count_);
+    for (int i = 0; i < switch_count_; ++i) {
+      names_[i] = StringPrintf("switch-%d", i);
+      struct option option = { names_[i].c_str(),
+        i % 4 == 0 || i % 4 == 3 ? required_argument : no_argument, NULL, i };
+      options_.push_back(option);
+    }
+    struct option end = { NULL, 0, NULL, 0 };
+    options_.push_back(end);
+    args_ = MakeCommandLine(switch_count_, arg_count_);
+    values_.resize(switch_count_);
+  }
+
+  virtual void Run() {
+    std::vector<char *> argv;
+    for (size_t i = 0; i < args_.size(); ++i) {
+      argv.push_back(const_cast<char *>(args_[i].c_str()));
+    }
+    argv.push_back(NULL);
+    optind = 0;
+    int index;
+    while ((index = getopt_long(argv.size() - 1, &argv[0], "", &options_[0],
+        NULL)) != -1) {
+      CHECK(index >= 0 && index < switch_count_);
+      values_[index] = optarg ? optarg : "1";
+    }
+  }
+
+ private:
+  int switch_count_;
+  int arg_count_;
+  std::vector<std::string> names_;
+  std::vector<struct option> options_;
+  std::vector<std::string> args_;
+  std::vector<std::string> values_;
+};
+#endif  // defined(OS_POSIX)
+
+class CompileBenchmark : public Benchmark {
+ public:
+  explicit CompileBenchmark(int switch_count)
+    : Benchmark(StringPrintf("compile/switches:%d", switch_count)),
+      switch_count_(switch_count) {
+  }
+
+  virtual void SetUp() {
+    switch_set_ = MakeSwitchSet(switch_count_);
+  }
+
+  virtual void Run() {
+    CompiledSwitchSet compiled(switch_set_);
+  }
+
+ private:
+  int switch_count_;
+  SwitchSet switch_set_;
+};
+
+// Reads every switch of a parse result by name or by index
+class ResultLookupBenchmark : public Benchmark {
+ public:
+  ResultLookupBenchmark(int switch_count, bool by_index)
+    : Benchmark(StringPrintf("result_lookup/%s/switches:%d",
+        by_index ? "index" : "name", switch_count)),
+      switch_count_(switch_count),
+      by_index_(by_index),
+      sum_(0) {
+  }
+
+  virtual void SetUp() {
+    CompiledSwitchSet compiled(MakeSwitchSet(switch_count_));
+    const char * argv[] = {"program"};
+    bool ok = compiled.Parse(arraysize(argv), argv, &result_);
+    CHECK(ok) << result_.error();
+    for (int i = 0; i < switch_count_; ++i) {
+      names_.push_back(StringPrintf("switch-%d", i));
+    }
+  }
+
+  virtual void Run() {
+    for (int i = 2; i < switch_count_; i += 4) {
+      if (by_index_) {
+        sum_ += result_.int_value(i);
+      } else {
+        sum_ += result_.value(names_[i]).AsInt();
+      }
+    }
+  }
+
+ private:
+  int switch_count_;
+  bool by_index_;
+  int64 sum_;
+  ParseResult result_;
+  std::vector<std::string> names_;
+};
+
+// Looks up a value at the bottom of a chain of nested groups, either by name
+// at each level or through a ValueHandle
+class ValueGroupBenchmark : public Benchmark {
+ public:
+  ValueGroupBenchmark(int depth, int width, bool by_handle)
+    : Benchmark(StringPrintf("value_group_%s/depth:%d/width:%d",
+        by_handle ? "handle" : "lookup", depth, width)),
+      depth_(depth),
+      width_(width),
+      sum_(0) {
+    if (by_handle) {
+      std::string path;
+      for (int i = 1; i < depth_; ++i) {
+        path += StringPrintf("g%d.", i);
+      }
+      handle_.reset(new ValueHandle(path + StringPrintf("v%d", width_ / 2)));
+    }
+  }
+
+  virtual void SetUp() {
+    root_ = MakeValueGroup(depth_, width_);
+    for (int i = 1; i < depth_; ++i) {
+      path_.push_back(StringPrintf("g%d", i));
+    }
+    key_ = StringPrintf("v%d", width_ / 2);
+  }
+
+  virtual void Run() {
+    if (handle_.get()) {
+      sum_ += handle_->value(root_).AsInt();
+      return;
+    }
+    const ValueGroup * group = &root_;
+    for (size_t i = 0; i < path_.size(); ++i) {
+      group = &group->group(path_[i]);
+    }
+    sum_ += group->value(key_).AsInt();
+  }
+
+ private:
+  int depth_;
+  int width_;
+  int64 sum_;
+  ValueGroup root_;
+  std::vector<std::string> path_;
+  std::string key_;
+  scoped_ptr<ValueHandle> handle_;
+};
+
+// Builds and then destroys a tree of groups and values, as loading a large
+// configuration file does, either on the heap or in an Arena
+class ValueGroupBuildBenchmark : public Benchmark {
+ public:
+  ValueGroupBuildBenchmark(int width, bool in_arena)
+    : Benchmark(StringPrintf("value_group_build/%s/width:%d",
+        in_arena ? "arena" : "heap", width)),
+      width_(width),
+      in_arena_(in_arena) {
+    for (int i = 0; i < width_; ++i) {
+      names_.push_back(StringPrintf("key%d", i));
+    }
+  }
+
+  virtual void Run() {
+    Arena arena;
+    ValueGroup root(kEmptyString, in_arena_ ? &arena : NULL);
+    for (int i = 0; i < width_; ++i) {
+      ValueGroup & group = root.CreateGroup(names_[i]);
+      for (int j = 0; j < width_; ++j) {
+        group.SetValue(names_[j], Value(j));
+      }
+    }
+  }
+
+ private:
+  int width_;
+  bool in_arena_;
+  std::vector<std::string> names_;
+};
+
+// Makes a new version of a configuration which differs in one value
+class ValueGroupVersionBenchmark : public Benchmark {
+ public:
+  explicit ValueGroupVersionBenchmark(int width)
+    : Benchmark(StringPrintf("value_group_version/width:%d", width)),
+      width_(width) {
+  }
+
+  virtual void SetUp() {
+    for (int i = 0; i < width_; ++i) {
+      ValueGroup & group = root_.CreateGroup(StringPrintf("group%d", i));
+      for (int j = 0; j < width_; ++j) {
+        group.SetValue(StringPrintf("key%d", j), Value(j));
+      }
+    }
+    group_ = StringPrintf("group%d", width_ / 2);
+    key_ = StringPrintf("key%d", width_ / 2);
+  }
+
+  virtual void Run() {
+    ValueGroup version(root_);
+    version.CreateGroup(group_).SetValue(key_, Value(-1));
+  }
+
+ private:
+  int width_;
+  ValueGroup root_;
+  std::string group_;
+  std::string key_;
+};
+
+// Looks up a value which only the bottom layer of a ValueOverlay has, as a
+// default which no file or switch overrides, with or without the cache of
+// winning layers
+class ValueOverlayBenchmark : public Benchmark {
+ public:
+  ValueOverlayBenchmark(int layers, bool cached)
+    : Benchmark(StringPrintf("value_overlay_%s/layers:%d",
+        cached ? "cached" : "search", layers)),
+      layers_(layers),
+      sum_(0) {
+    overlay_.cache_lookups(cached);
+  }
+
+  virtual void SetUp() {
+    for (int i = 0; i < layers_; ++i) {
+      groups_.push_back(MakeValueGroup(1, 100));
+    }
+    groups_[0].SetValue("default", Value(1));
+    for (int i = 0; i < layers_; ++i) {
+      overlay_.AddLayer(&groups_[i]);
+    }
+  }
+
+  virtual void Run() {
+    sum_ += overlay_.value("default").AsInt();
+  }
+
+ private:
+  int layers_;
+  int64 sum_;
+  std::vector<ValueGroup> groups_;
+  ValueOverlay overlay_;
+};
+
+// Splits an INI file into tokens without storing them, classifying the text
+// with one of the kernels of IniScanner
+class IniScanBenchmark : public Benchmark {
+ public:
+  IniScanBenchmark(int64 size, IniScanner::Kernel kernel)
+    : Benchmark(StringPrintf("ini_scan/%s/size:%s", kKernelNames[kernel],
+        FormatByteSize(size).c_str())),
+      size_(size),
+      kernel_(kernel),
+      tokens_(0) {
+  }
+
+  virtual void SetUp() {
+    file_.reset(new IniFile(size_));
+    CHECK(mapping_.Initialize(file_->path()));
+  }
+
+  virtual void Run() {
+    IniScanner scanner(base::StringPiece(
+      reinterpret_cast<const char *>(mapping_.data()), mapping_.length()));
+    scanner.set_kernel(kernel_);
+    IniToken token;
+    while (scanner.Next(&token)) {
+      ++tokens_;
+    }
+  }
+
+  virtual int64 bytes() const { return file_->size(); }
+
+ private:
+  static const char * const kKernelNames[];
+
+  int64 size_;
+  IniScanner::Kernel kernel_;
+  scoped_ptr<IniFile> file_;
+  file_util::MemoryMappedFile mapping_;
+  int64 tokens_;
+};
+
+const char * const IniScanBenchmark::kKernelNames[] = {"scalar", "sse2",
+  "avx2"};
+
+// Maps and parses an INI file into a ValueGroup, on the heap or in an Arena,
+// or streams it to a ConfigHandler which only counts one key.  On the heap
+// the file may be split between several threads, or parsed lazily, reading
+// only a few sections as most processes do.
+class IniParseBenchmark : public Benchmark {
+ public:
+  enum Mode {
+    kHeap,
+    kArena,
+    kStream,
+    kLazy
+  };
+
+  IniParseBenchmark(int64 size, Mode mode, int threads = 1)
+    : Benchmark(StringPrintf("ini_parse/%s/size:%s", kModeNames[mode],
+        FormatByteSize(size).c_str()) + (threads == 1 ? std::string() :
+        StringPrintf("/threads:%d", threads))),
+      size_(size),
+      mode_(mode),
+      threads_(threads) {
+  }
+
+  virtual void SetUp() {
+    file_.reset(new IniFile(size_));
+    filename_ = file_->filename();
+  }
+
+  virtual int64 bytes() const { return file_->size(); }
+
+  // Building values() takes about ten times the size of the file in an
+  // arena, and more on the heap
+  virtual int64 memory() const {
+    return mode_ == kHeap || mode_ == kArena ? size_ * 16 : 0;
+  }
+
+  virtual void Run() {
+    Arena arena;
+    IniConfigParser parser;
+    parser.threads(threads_);
+    if (mode_ == kStream) {
+      CHECK(parser.Parse(filename_, &counter_)) << parser.error();
+      return;
+    }
+    if (mode_ == kArena) {
+      parser.arena(&arena);
+    }
+    parser.lazy(mode_ == kLazy);
+    CHECK(parser.Parse(filename_)) << parser.error();
+    if (mode_ == kLazy) {
+      for (int i = 0; i < 4; ++i) {
+        CHECK(parser.values().group(StringPrintf("route-%d",
+          i * file_->sections() / 4)).has_value("key-3"));
+      }
+    }
+  }
+
+ private:
+  class KeyCounter : public ConfigHandler {
+   public:
+    KeyCounter() : count_(0) {}
+
+    virtual bool OnKeyValue(const Text & key, const Text & value, int line) {
+      if (key == "key-3") {
+        ++count_;
+      }
+      return true;
+    }
+
+   private:
+    int64 count_;
+  };
+
+  static const char * const kModeNames[];
+
+  int64 size_;
+  Mode mode_;
+  int threads_;
+  scoped_ptr<IniFile> file_;
+  StringType filename_;
+  KeyCounter counter_;
+};
+
+const char * const IniParseBenchmark::kModeNames[] = {"heap", "arena",
+  "stream", "lazy"};
+
+// Reads a value of the current configuration, either through a ConfigSnapshot
+// or while holding a lock as a server without snapshots would
+class ConfigReadBenchmark : public Benchmark {
+ public:
+  explicit ConfigReadBenchmark(bool by_snapshot)
+    : Benchmark(by_snapshot ? "config_read/snapshot" : "config_read/lock"),
+      by_snapshot_(by_snapshot),
+      config_(MakeValueGroup(1, 100)),
+      publisher_(config_),
+      reader_(&publisher_),
+      sum_(0) {
+  }
+
+  virtual void Run() {
+    if (by_snapshot_) {
+      ConfigSnapshot config(&reader_);
+      sum_ += config->value("v50").AsInt();
+    } else {
+      AutoLock lock(lock_);
+      sum_ += config_.value("v50").AsInt();
+    }
+  }
+
+ private:
+  bool by_snapshot_;
+  ValueGroup config_;
+  Lock lock_;
+  ConfigPublisher publisher_;
+  ConfigPublisher::Reader reader_;
+  int64 sum_;
+};
+
+// Reads a kTypeAuto value, as a service consulting its configuration would
+class AutoConversionBenchmark : public Benchmark {
+ public:
+  explicit AutoConversionBenchmark(const std::string & value)
+    : Benchmark("auto_conversion/" + value),
+      sum_(0) {
+    value_.set(value);
+  }
+
+  virtual void Run() {
+    sum_ += value_.AsInt();
+  }
+
+ private:
+  Value value_;
+  int64 sum_;
+};
+
+}  // anonymous namespace
+}  // namespace yact
+
+// The physical memory of the machine, or zero if it is not known
+int64 PhysicalMemory() {
+#if defined(OS_POSIX)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && page_size > 0) {
+    return static_cast<int64>(pages) * page_size;
+  }
+#endif  // defined(OS_POSIX)
+  return 0;
+}
+
+int main(int argc, const char ** argv) {
+  yact::ArgumentParser parser;
+  parser
+    .usage("yact_bench [--filter=SUBSTRING] [--samples=N] [--max_time=TIME]"
+      " [--max_ini_size=SIZE]")
+    .enable_parse_environment(false)
+    .AddSwitch(yact::Switch().name("filter").store().default_(
+      yact::Value(yact::kEmptyString))
+      .help("Only run benchmarks whose name contains SUBSTRING"))
+    .AddSwitch(yact::Switch().name("samples").store().default_(
+      yact::Value("100"))
+      .help("The number of timed batches per benchmark"))
+    .AddSwitch(yact::Switch().name("max_time").store()
+      .type(yact::Value::kTypeDuration)
+      .default_(yact::Value::Duration(GG_INT64_C(10000000)))
+      .help("Stop taking samples of a benchmark after TIME, e.g. 30s, once "
+        "it has three"))
+    .AddSwitch(yact::Switch().name("max_ini_size").store()
+      .type(yact::Value::kTypeByteSize)
+      .default_(yact::Value::ByteSize(GG_INT64_C(1) << 30))
+      .help("The size of the largest INI file to benchmark, e.g. 64MiB"));
+  if (!parser.Parse(argc, argv)) {
+    fprintf(stderr, "%s\n%s\n", parser.error().c_str(),
+      parser.usage().c_str());
+    return 1;
+  }
+  std::string filter = parser.value("filter").AsString();
+  int samples;
+  if (!base::StringToInt(parser.value("samples").AsString(), &samples) ||
+      samples < 1) {
+    fprintf(stderr, "--samples must be a positive integer\n");
+    return 1;
+  }
+  base::TimeDelta max_time = base::TimeDelta::FromMicroseconds(
+    parser.value("max_time").AsDuration());
+  int64 max_ini_size = parser.value("max_ini_size").AsByteSize();
+
+  std::vector<yact::Benchmark *> benchmarks;
+  const int kSwitchCounts[] = {10, 100, 1000, 10000};
+  for (size_t i = 0; i < arraysize(kSwitchCounts); ++i) {
+    benchmarks.push_back(new yact::CompileBenchmark(kSwitchCounts[i]));
+  }
+  for (size_t i = 0; i < arraysize(kSwitchCounts); ++i) {
+    benchmarks.push_back(new yact::ParseBenchmark(kSwitchCounts[i], 200));
+#if defined(OS_POSIX)
+    benchmarks.push_back(new yact::GetoptBenchmark(kSwitchCounts[i], 200));
+#endif  // defined(OS_POSIX)
+  }
+  for (size_t i = 0; i < arraysize(kSwitchCounts); ++i) {
+    benchmarks.push_back(new yact::ResultLookupBenchmark(kSwitchCounts[i],
+      false));
+    benchmarks.push_back(new yact::ResultLookupBenchmark(kSwitchCounts[i],
+      true));
+  }
+  const int kGroupShapes[][2] = {{1, 10000}, {8, 10}, {8, 1000}, {64, 10}};
+  for (size_t i = 0; i < arraysize(kGroupShapes); ++i) {
+    benchmarks.push_back(new yact::ValueGroupBenchmark(kGroupShapes[i][0],
+      kGroupShapes[i][1], false));
+    benchmarks.push_back(new yact::ValueGroupBenchmark(kGroupShapes[i][0],
+      kGroupShapes[i][1], true));
+  }
+  benchmarks.push_back(new yact::ValueGroupBuildBenchmark(100, false));
+  benchmarks.push_back(new yact::ValueGroupBuildBenchmark(100, true));
+  benchmarks.push_back(new yact::ValueGroupVersionBenchmark(100));
+  benchmarks.push_back(new yact::ValueOverlayBenchmark(5, false));
+  benchmarks.push_back(new yact::ValueOverlayBenchmark(5, true));
+  benchmarks.push_back(new yact::ConfigReadBenchmark(false));
+  benchmarks.push_back(new yact::ConfigReadBenchmark(true));
+
+  // Every 16x from 1 KB to 1 GB.  The threads sweep starts where a file is
+  // large enough to be split between all of them.
+  const int kThreadCounts[] = {2, 4, 8};
+  for (int64 size = 1 << 10; size <= max_ini_size; size <<= 4) {
+    for (int kernel = yact::IniScanner::kKernelScalar;
+        kernel <= yact::IniScanner::best_kernel(); ++kernel) {
+      benchmarks.push_back(new yact::IniScanBenchmark(size,
+        static_cast<yact::IniScanner::Kernel>(kernel)));
+    }
+    benchmarks.push_back(new yact::IniParseBenchmark(size,
+      yact::IniParseBenchmark::kHeap));
+    if (size >= 16 << 20) {
+      for (size_t i = 0; i < arraysize(kThreadCounts); ++i) {
+        benchmarks.push_back(new yact::IniParseBenchmark(size,
+          yact::IniParseBenchmark::kHeap, kThreadCounts[i]));
+      }
+    }
+    benchmarks.push_back(new yact::IniParseBenchmark(size,
+      yact::IniParseBenchmark::kArena));
+    benchmarks.push_back(new yact::IniParseBenchmark(size,
+      yact::IniParseBenchmark::kStream));
+    benchmarks.push_back(new yact::IniParseBenchmark(size,
+      yact::IniParseBenchmark::kLazy));
+  }
+  benchmarks.push_back(new yact::AutoConversionBenchmark("42"));
+  benchmarks.push_back(new yact::AutoConversionBenchmark("1234567890"));
+
+  // A benchmark which would not fit in memory is skipped rather than have
+  // the whole run killed
+  int64 memory = PhysicalMemory();
+  for (size_t i = 0; i < benchmarks.size(); ++i) {
+    if (benchmarks[i]->name().find(filter) != std::string::npos) {
+      if (memory && benchmarks[i]->memory() > memory) {
+        printf("%-44s skipped, needs about %s of memory\n",
+          benchmarks[i]->name().c_str(),
+          yact::FormatByteSize(benchmarks[i]->memory()).c_str());
+      } else {
+        yact::RunBenchmark(benchmarks[i], samples, max_time);
+      }
+    }
+    delete benchmarks[i];
+  }
+  return 0;
+}